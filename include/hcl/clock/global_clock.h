@@ -13,6 +13,7 @@
 #ifndef INCLUDE_HCL_CLOCK_GLOBAL_CLOCK_H_
 #define INCLUDE_HCL_CLOCK_GLOBAL_CLOCK_H_
 
+#include <hcl/common/container.h>
 #include <hcl/common/data_structures.h>
 #include <hcl/common/debug.h>
 #include <hcl/common/singleton.h>
@@ -44,10 +45,14 @@ class global_clock {
   int num_servers;
   uint16_t my_server;
   bip::managed_mapped_file segment;
+  /** Holds start and mutex instead of segment if NODE_SEGMENT_SIZE is set **/
+  std::shared_ptr<node_segment> node;
   std::string name, func_prefix;
   uint16_t port;
   bool server_on_node;
   CharStruct backed_file;
+  /** Remote procedures **/
+  container::rpc_handle<HTime()> get_time_rpc;
 
  public:
   /*
@@ -48,6 +48,35 @@ class ConfigurationManager {
   CharStruct SERVER_LIST_PATH;
   std::vector<CharStruct> SERVER_LIST;
   CharStruct BACKED_FILE_DIR;
+  really_long RDMA_THRESHOLD;
+  really_long BATCH_SIZE;
+  uint32_t BATCH_WINDOW_MS;
+  int RPC_TIMEOUT_MS;
+  bool ENDPOINT_PREFETCH;
+  bool WRITE_BEHIND;
+  uint32_t LOCK_STRIPES;
+  really_long MAX_MEMORY_ALLOCATED;
+  bool PERSISTENT_SEGMENTS;
+  bool SEGMENT_HUGE_PAGES;
+  bool SEGMENT_PREFAULT;
+  int SEGMENT_NUMA_NODE;
+  SegmentBacking SEGMENT_BACKING;
+  really_long NODE_SEGMENT_SIZE;
+  uint32_t COMPACTION_INTERVAL_MS;
+  double COMPACTION_FRAGMENTATION;
+  really_long COMPACTION_SLICE;
+  PartitionScheme PARTITIONER;
+  uint32_t PARTITION_SLOTS;
+  uint16_t ACTIVE_SERVERS;
+  uint32_t MIGRATION_RETRY_MS;
+  uint16_t REPLICATION_FACTOR;
+  ReplicationMode REPLICATION_MODE;
+  uint32_t READ_HEDGE_MS;
+  uint32_t HOT_KEY_THRESHOLD;
+  uint32_t HOT_KEY_WINDOW_MS;
+  uint32_t HOT_KEY_MAX;
+  really_long NEAR_CACHE_BYTES;
+  uint32_t NEAR_CACHE_LEASE_MS;
 
   bool DYN_CONFIG;  // Does not do anything (yet)
 
@@ -20,6 +20,13 @@
 
 const uint16_t RPC_PORT = 8080;
 const uint16_t RPC_THREADS = 1;
+const size_t HCL_CACHE_LINE = 64;
+/** Bump when the layout of container segments changes **/
+const uint32_t HCL_SEGMENT_LAYOUT_VERSION = 4;
+/** Counters per row of the sketch that finds hot keys **/
+const uint32_t HCL_HOT_KEY_SKETCH_WIDTH = 4096;
+/** Buckets of keys a server tracks read leases for **/
+const uint32_t HCL_LEASE_BUCKETS = 4096;
 const int TEST_REQUEST_SIZE = 1024;
 const CharStruct PATH_SEPARATOR = "/";
 const CharStruct HCL_THALLIUM_URI_ENV = "HCL_THALLIUM_URI";
@@ -14,12 +14,33 @@
 #define HCL_CONTAINER_H
 
 #include <hcl/common/logging.h>
+#include <hcl/common/node_segment.h>
+#include <hcl/common/partitioner.h>
 #include <hcl/common/profiler.h>
+#include <hcl/common/rw_lock.h>
+#include <hcl/common/slab_allocator.h>
 #include <hcl/communication/rpc_lib.h>
 
+#include <boost/interprocess/managed_external_buffer.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <hcl/hcl_config.hpp>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
 
 #include "data_structures.h"
 #include "typedefs.h"
@@ -27,17 +48,728 @@
 namespace hcl {
 class container {
  protected:
+  /**
+   * Managed memory placed in the mapped backing file. It shares the
+   * segment_manager of managed_mapped_file, so the containers' allocators
+   * work unchanged, but the mapping can be larger than the file.
+   */
+  typedef boost::interprocess::basic_managed_external_buffer<
+      char,
+      boost::interprocess::rbtree_best_fit<boost::interprocess::mutex_family>,
+      boost::interprocess::iset_index>
+      managed_segment;
+  static_assert(
+      std::is_same<managed_segment::segment_manager,
+                   boost::interprocess::managed_mapped_file::segment_manager>::
+          value,
+      "segment allocators must match managed_mapped_file");
+  /**
+   * Allocator of the data held by the servers. Built with
+   * HCL_ENABLE_HEAP_SEGMENTS it is the heap, which saves the offset_ptr
+   * arithmetic on every access, but on-node clients cannot map the data.
+   */
+#if defined(HCL_ENABLE_HEAP_SEGMENTS)
+  template <typename T>
+  using segment_allocator = std::allocator<T>;
+#else
+  template <typename T>
+  using segment_allocator =
+      boost::interprocess::allocator<T, managed_segment::segment_manager>;
+#endif
+  /**
+   * Allocator of a container's own nodes: the slab pool if the container
+   * was given a slab_allocator as its Allocator, else segment_allocator.
+   */
+  template <typename Allocator, typename T>
+  using node_allocator =
+      typename std::conditional<is_slab_allocator<Allocator>::value,
+                                slab_allocator<T>, segment_allocator<T>>::type;
+  /**
+   * Written at the start of the backing file, ahead of the segment. A file
+   * is only reopened if magic and layout_version match this build.
+   */
+  struct segment_header {
+    char magic[8];
+    uint32_t layout_version;
+    /** Set once a persistent server flushed and closed the segment **/
+    uint32_t clean;
+    really_long reserved;
+    /** Hash of the type of the container that built the segment **/
+    uint64_t type_hash;
+  };
+  /** Offset of the managed segment in the backing file **/
+  static constexpr really_long SEGMENT_OFFSET = 4096;
+  static constexpr const char SEGMENT_MAGIC[8] = "HCLSEG";
+  /** Keeps stripe_of apart from partitioner::slot_of **/
+  static constexpr uint64_t STRIPE_SEED = 0x9e3779b97f4a7c15ULL;
+
   int num_servers;
   uint16_t my_server_idx;
+  /** Assigns keys to servers, chosen by PARTITIONER **/
+  partitioner partition;
   really_long memory_allocated;
   bool is_server;
-  boost::interprocess::managed_mapped_file segment;
+  /** Keep the backing file across restarts and reattach to it **/
+  bool persistent;
+  /** The server reopened the segment of a previous run **/
+  bool reattached;
+  /**
+   * Lets mapped_region map a plain descriptor, whichever backing it refers
+   * to.
+   */
+  struct fd_mappable {
+    int fd;
+    boost::interprocess::mapping_handle_t get_mapping_handle() const {
+      return boost::interprocess::ipcdetail::mapping_handle_from_file_handle(
+          fd);
+    }
+  };
+  SegmentBacking backing;
+  /** Descriptor of the backing file, shm object or memfd **/
+  int segment_fd;
+  /**
+   * The backing object is mapped over the whole reserved size, so the
+   * segment grows in place and every process sees the new pages without a
+   * remap.
+   */
+  boost::interprocess::mapped_region segment_region;
+  /** With NODE_SEGMENT_SIZE, the region of the node segment used instead **/
+  std::shared_ptr<node_segment> node;
+  char *node_region;
+  really_long node_region_size;
+  managed_segment segment;
   CharStruct name, func_prefix;
-  boost::interprocess::interprocess_mutex *mutex;
+  rw_lock *mutex;
+  /**
+   * Lock stripe in the segment, padded so that the locks of neighbouring
+   * stripes do not share a cache line.
+   */
+  struct lock_stripe {
+    rw_lock mutex;
+    char padding[HCL_CACHE_LINE - sizeof(rw_lock) % HCL_CACHE_LINE];
+  };
+  lock_stripe *stripes;
+  uint32_t num_stripes;
+  /** Size classes for slab_allocator, built in every segment **/
+  slab_pool *slabs;
+#if defined(HCL_ENABLE_HEAP_SEGMENTS)
+  /** Objects built by construct_named, freed with the container **/
+  std::vector<std::shared_ptr<void>> heap_objects;
+#endif
   CharStruct backed_file;
   uint16_t port;
+  std::shared_ptr<RPC> rpc;
+  /** Background drain of request batches **/
+  std::thread write_behind;
+  std::mutex write_behind_mutex;
+  std::condition_variable write_behind_cv;
+  bool write_behind_stop;
+  std::atomic<bool> write_behind_failed;
+  /** Background compaction of the segment **/
+  std::thread compaction;
+  std::mutex compaction_mutex;
+  std::condition_variable compaction_cv;
+  std::atomic<bool> compaction_stop;
+  /** Held for a whole pass, so that passes never interleave **/
+  std::mutex compaction_pass;
+  /**
+   * Route locks of an elastic server, one per group of slots (slot modulo
+   * num_route_groups). A keyed procedure holds the groups of its keys shared
+   * while it checks that their slots are still here and runs; moving slots
+   * holds their group exclusively. They are on the heap: the routing table
+   * is not shared with on-node clients.
+   */
+  std::unique_ptr<lock_stripe[]> route_stripes;
+  uint32_t num_route_groups;
+  /** Serializes changes to the routing table of partition **/
+  std::mutex routing_mutex;
+  /** Background migration of slots to the servers that own them next **/
+  std::thread migration;
+  std::mutex migration_mutex;
+  std::condition_variable migration_cv;
+  bool migration_stop;
+  /** Servers that own slots once the requested rebalance is done **/
+  uint16_t active_servers;
+  /** Rebalances requested and the last one whose slots all moved **/
+  uint64_t migration_requested, migration_finished;
+  /** Copies of each key: on its owner and on the servers after it **/
+  uint16_t replication;
+  /** Spreads reads over the replicas of a key **/
+  std::atomic<uint32_t> read_turn;
+  /** Writes forwarded to replicas in REPLICATION_ASYNC mode, not yet done **/
+  std::mutex replication_mutex;
+  std::vector<RPCFuture<bool>> replica_writes;
+  std::atomic<bool> replication_failed;
+
+  /**
+   * Starts a thread that calls drain every interval_ms until
+   * stop_write_behind(). Failures are kept for write_behind_succeeded().
+   */
+  void start_write_behind(uint32_t interval_ms, std::function<bool()> drain);
+  void stop_write_behind();
+  /**
+   * @return bool, false if a background drain failed since the last call.
+   */
+  bool write_behind_succeeded();
+
+  /**
+   * Starts a thread that checks the segment every interval_ms and runs
+   * Compact() once its fragmentation reaches COMPACTION_FRAGMENTATION.
+   * Does nothing if interval_ms is 0. A container that starts it must call
+   * stop_compaction() in its destructor.
+   */
+  void start_compaction(uint32_t interval_ms);
+  void stop_compaction();
+  /**
+   * Copies the live entries of the next slice into newly allocated memory
+   * and frees the old copies, so that the blocks they held merge with the
+   * free space around them. It takes its own locks, only for this slice.
+   * @param restart, start over from the first slice
+   * @return bool, true if slices remain.
+   */
+  virtual bool compact_slice(bool restart);
+  /**
+   * Asks the migration thread to move every slot this server owns to the
+   * jump hash of the slot over the first active servers, and starts the
+   * thread if needed. A container that starts it must call stop_migration()
+   * in its destructor.
+   */
+  void start_rebalance(uint16_t active);
+  void stop_migration();
+  /** Blocks until the slots of every requested rebalance have moved. */
+  void wait_for_migration();
+  /**
+   * Moves the slots of one route group that are here but should be on
+   * another server. The group's route lock is held meanwhile.
+   * @return bool, false if some could not be handed over and must be
+   * retried.
+   */
+  virtual bool migrate_group(uint32_t group);
+  /** @return uint16_t, the server that owns slot once the rebalance is done. */
+  uint16_t target_of(uint32_t slot) const {
+    return partitioner::jump(slot, active_servers);
+  }
+  /** Merges routes learned from a server into the routing table. */
+  void learn_routes(const std::vector<slot_route> &routes);
+
+  /** @return uint16_t, the i-th replica of the keys of primary, 0 for itself. */
+  uint16_t replica_of(uint16_t primary, uint16_t i) const {
+    return static_cast<uint16_t>((primary + i) % num_servers);
+  }
+  /**
+   * @return bool, true if a write for key_int is applied here directly. An
+   * on-node client sends writes through its server if the server forwards
+   * them to replicas or to copies of hot keys, or holds them for leases.
+   */
+  bool writes_locally(uint16_t &key_int) {
+    return is_local(key_int) &&
+           (is_server || (replication < 2 && HCL_CONF->HOT_KEY_THRESHOLD == 0 &&
+                          HCL_CONF->NEAR_CACHE_BYTES == 0));
+  }
+  /**
+   * Forwards a write applied on this server to the other replicas of its
+   * keys. In REPLICATION_SYNC mode it waits for them.
+   * @param send, sends the write to one replica
+   * @return bool, false if a replica failed to apply it.
+   */
+  bool replicate(std::function<RPCFuture<bool>(uint16_t)> send);
+  /**
+   * Waits for the writes still being forwarded to replicas.
+   * @return bool, false if one failed since the last call.
+   */
+  bool wait_for_replicas();
+  /**
+   * Reads from one of the replicas of primary's keys: locally if this
+   * process maps one, else from the next replica in turn. With
+   * READ_HEDGE_MS, a read still pending after that long is sent to the
+   * following replica too and the first reply is taken, and a read that
+   * failed is sent to the following replica instead. The waits sleep
+   * through rpc and end after RPC_TIMEOUT_MS if it is set.
+   * @param local, reads from the segment mapped here
+   * @param send, sends the read to one replica
+   */
+  template <typename Response>
+  Response read_replica(uint16_t primary, std::function<Response()> local,
+                        std::function<RPCFuture<Response>(uint16_t)> send) {
+    HCL_LOG_TRACE();
+    HCL_CPP_FUNCTION()
+    for (uint16_t i = 0; i < replication; ++i) {
+      uint16_t replica = replica_of(primary, i);
+      if (is_local(replica)) return local();
+    }
+    uint16_t first = static_cast<uint16_t>(
+        read_turn.fetch_add(1, std::memory_order_relaxed) % replication);
+    RPCFuture<Response> reply = send(replica_of(primary, first));
+    if (HCL_CONF->READ_HEDGE_MS == 0 || replication < 2) return reply.get();
+    uint16_t next = replica_of(primary, (first + 1) % replication);
+    std::vector<RPCFuture<Response> *> pending(1, &reply);
+    if (rpc->wait_any(pending,
+                      std::chrono::milliseconds(HCL_CONF->READ_HEDGE_MS)) ==
+        0) {
+      try {
+        return reply.get();
+      } catch (const std::exception &) {
+        /* That replica failed before the hedge was due, ask the next. */
+        return send(next).get();
+      }
+    }
+    RPCFuture<Response> hedge = send(next);
+    pending.push_back(&hedge);
+    std::chrono::microseconds timeout = std::chrono::microseconds::max();
+    if (HCL_CONF->RPC_TIMEOUT_MS > 0)
+      timeout = std::chrono::milliseconds(HCL_CONF->RPC_TIMEOUT_MS);
+    size_t done = rpc->wait_any(pending, timeout);
+    if (done == pending.size()) {
+      HCL_LOG_ERROR("Replicas of server %d did not answer in %d ms\n",
+                    primary, HCL_CONF->RPC_TIMEOUT_MS);
+      throw std::runtime_error("RPC timed out.");
+    }
+    try {
+      return pending[done]->get();
+    } catch (const std::exception &) {
+      /* That replica failed, the other one may still answer. */
+      return pending[1 - done]->get();
+    }
+  }
+
+  /**
+   * The segment manager cannot list its free blocks, so each one is taken
+   * whole, largest first, and then given back. Every lock of the segment is
+   * held meanwhile, so no operation sees the segment as full.
+   * @param all, take every free block instead of only the largest
+   * @return std::vector<really_long>, the sizes of the blocks taken.
+   */
+  std::vector<really_long> free_block_sizes(bool all);
+
+  /**
+   * Extends the backing file and the segment, doubling it up to the
+   * reserved size. Every lock of the segment is held while it grows.
+   * @param seen_size, segment size when the allocation failed
+   * @return bool, true if the segment grew since seen_size.
+   */
+  bool grow_segment(really_long seen_size);
+  void resize_backed_file(really_long size);
+  /**
+   * Opens the backing object into segment_fd, creating an empty one if
+   * create is set. For a memfd the server publishes its process and
+   * descriptor in backed_file, through which clients open it.
+   * @return bool, false if it does not exist and create is not set.
+   */
+  bool open_backing(bool create);
+  void remove_backing();
+  void close_backing();
+  std::string shm_name() const { return "/" + std::string(name.c_str()); }
+  /**
+   * Applies the huge page and NUMA options to the whole mapping, so pages
+   * added by growth get them too.
+   */
+  void place_segment();
+  /** Faults in [from, to) of the mapping if SEGMENT_PREFAULT is set. */
+  void prefault_segment(really_long from, really_long to);
+  void create_segment();
+  void construct_common_objects();
+  void open_segment();
+  void check_header(const segment_header *found);
+  /** Writes back the first bytes of the segment, or all of it if 0. */
+  void flush_segment(really_long bytes);
+  /** Flushes a persistent segment and marks it as cleanly closed. */
+  void close_segment();
+  char *segment_base() {
+    return node != nullptr ? node_region
+                           : static_cast<char *>(segment_region.get_address());
+  }
+  segment_header *header() {
+    return reinterpret_cast<segment_header *>(segment_base());
+  }
+  /**
+   * Records the derived container type in a new segment, or checks it
+   * against a reattached one. Called by the server constructors.
+   * @return bool, true if the segment already holds the container's objects
+   * and they only have to be found.
+   */
+  bool attach_type(const char *type_name);
+
+  /**
+   * Runs op and, if the segment runs out of memory, grows it and runs op
+   * again. op must take its own locks and either leave the data unchanged
+   * when it throws or resume where it stopped.
+   */
+  template <typename Op>
+  auto growing(Op op) -> decltype(op()) {
+#if defined(HCL_ENABLE_HEAP_SEGMENTS)
+    return op();
+#else
+    while (true) {
+      really_long seen_size = segment.get_size();
+      try {
+        return op();
+      } catch (const boost::interprocess::bad_alloc &) {
+        if (!grow_segment(seen_size)) throw;
+      }
+    }
+#endif
+  }
+
+  /**
+   * @return bool, true if copy is at a lower address than original. Only
+   * such copies are kept by compaction, so that live data moves towards
+   * the start of the segment and the free space at its end only grows.
+   */
+  static bool moved_down(const void *copy, const void *original) {
+    return std::less<const void *>()(copy, original);
+  }
+
+  /**
+   * compact_slice() of the ordered containers: copies up to
+   * COMPACTION_SLICE entries after cursor into a new tree, keeps the copies
+   * that moved down, erases their originals and splices the copies back in.
+   * Entries with equal keys move together or not at all, and a slice ends
+   * on a key boundary, so they keep their order.
+   * @param key_of, returns the key of an entry
+   * @return bool, true if entries remain after the slice.
+   */
+  template <typename Tree, typename Key, typename KeyOf>
+  bool compact_tree_slice(Tree &tree, Key &cursor, bool restart,
+                          KeyOf key_of) {
+    HCL_LOG_TRACE();
+    HCL_CPP_FUNCTION()
+    really_long slice = std::max<really_long>(1, HCL_CONF->COMPACTION_SLICE);
+    std::unique_lock<rw_lock> lock(*mutex);
+    auto next = restart ? tree.begin() : tree.upper_bound(cursor);
+    Tree fresh(tree.key_comp(), tree.get_allocator());
+    bool full = false;
+    for (really_long examined = 0;
+         !full && next != tree.end() && examined < slice;) {
+      cursor = key_of(*next);
+      auto group = next;
+      auto copies = fresh.end();
+      bool down = true;
+      try {
+        for (; next != tree.end() && !tree.key_comp()(cursor, key_of(*next));
+             ++next, ++examined) {
+          auto copy = fresh.insert(fresh.end(), *next);
+          if (copies == fresh.end()) copies = copy;
+          down = down && moved_down(&*copy, &*next);
+        }
+      } catch (const boost::interprocess::bad_alloc &) {
+        HCL_LOG_INFO("No room to compact %s\n", backed_file.c_str());
+        full = true;
+        down = false;
+      }
+      if (down)
+        tree.erase(group, next);
+      else
+        fresh.erase(copies, fresh.end());
+    }
+    tree.merge(fresh);
+    return !full && next != tree.end();
+  }
+
+  template <typename T, typename Allocator = nullptr_t>
+  typename std::enable_if_t<!is_slab_allocator<Allocator>::value,
+                            node_allocator<Allocator, T>>
+  allocator_of() {
+#if defined(HCL_ENABLE_HEAP_SEGMENTS)
+    return segment_allocator<T>();
+#else
+    return segment.get_allocator<T>();
+#endif
+  }
+  template <typename T, typename Allocator = nullptr_t>
+  typename std::enable_if_t<is_slab_allocator<Allocator>::value,
+                            node_allocator<Allocator, T>>
+  allocator_of() {
+    return slab_allocator<T>(slabs);
+  }
+
+  /**
+   * Builds count objects of type T from the same args, under the name
+   * object in the segment or on the heap.
+   */
+  template <typename T, typename... Args>
+  T *construct_named_array(const char *object, size_t count,
+                           const Args &...args) {
+#if defined(HCL_ENABLE_HEAP_SEGMENTS)
+    std::allocator<T> heap;
+    T *built = heap.allocate(count);
+    for (size_t i = 0; i < count; ++i) new (built + i) T(args...);
+    heap_objects.emplace_back(built, [count](void *objects) {
+      T *typed = static_cast<T *>(objects);
+      for (size_t i = 0; i < count; ++i) typed[i].~T();
+      std::allocator<T>().deallocate(typed, count);
+    });
+    return built;
+#else
+    return segment.construct<T>(object)[count](args...);
+#endif
+  }
+  template <typename T, typename... Args>
+  T *construct_named(const char *object, const Args &...args) {
+    return construct_named_array<T>(object, 1, args...);
+  }
+
+  /** @return uint16_t, the server that owns a key. */
+  uint16_t server_of(size_t key_hash) const {
+    return partition.server_of(key_hash);
+  }
+
+  /**
+   * Server side of a keyed procedure: runs op while the route groups of
+   * key_hashes are held, unless the slot of one of the keys is no longer
+   * here. Only elastic servers have route groups; elsewhere op runs
+   * straight away and key_hashes may be left empty.
+   * @return routed<Response>, the result of op or the routes of the moved
+   * slots.
+   */
+  template <typename Response, typename Op>
+  routed<Response> serve_routed(const size_t *key_hashes, size_t count,
+                                Op op) {
+    if (route_stripes == nullptr) return routed<Response>(op());
+    std::vector<uint32_t> groups;
+    groups.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+      groups.push_back(partition.slot_of(key_hashes[i]) % num_route_groups);
+    std::sort(groups.begin(), groups.end());
+    groups.erase(std::unique(groups.begin(), groups.end()), groups.end());
+    for (uint32_t group : groups) route_stripes[group].mutex.lock_shared();
+    std::vector<slot_route> moved;
+    for (size_t i = 0; i < count; ++i) {
+      slot_route route = partition.route_of(partition.slot_of(key_hashes[i]));
+      if (route.owner != my_server_idx) moved.push_back(route);
+    }
+    routed<Response> reply;
+    try {
+      reply = moved.empty() ? routed<Response>(op())
+                            : routed<Response>(std::move(moved));
+    } catch (...) {
+      for (uint32_t group : groups) route_stripes[group].mutex.unlock_shared();
+      throw;
+    }
+    for (uint32_t group : groups) route_stripes[group].mutex.unlock_shared();
+    return reply;
+  }
+  template <typename Response, typename Op>
+  routed<Response> serve_routed(size_t key_hash, Op op) {
+    return serve_routed<Response>(&key_hash, 1, op);
+  }
+  template <typename Response, typename Op>
+  routed<Response> serve_routed(const std::vector<size_t> &key_hashes,
+                                Op op) {
+    return serve_routed<Response>(key_hashes.data(), key_hashes.size(), op);
+  }
+
+  /**
+   * Client side of a keyed procedure: while the reply says that the key's
+   * slot has moved, learns the routes and sends the request again to the
+   * server that owns it now.
+   * @param resend, sends the request to a server
+   * @return Response, the result from the server that owns the key.
+   */
+  template <typename Response>
+  Response follow_routes(size_t key_hash, routed<Response> reply,
+                         std::function<routed<Response>(uint16_t)> resend) {
+    while (!reply.moved.empty()) {
+      learn_routes(reply.moved);
+      reply = resend(server_of(key_hash));
+    }
+    return std::move(reply.value);
+  }
+  template <typename Response>
+  RPCFuture<Response> follow_routes(
+      size_t key_hash, RPCFuture<routed<Response>> reply,
+      std::function<routed<Response>(uint16_t)> resend) {
+    return RPCFuture<Response>(
+        [reply]() { return reply.ready(); },
+        [this, key_hash, reply, resend]() mutable {
+          return follow_routes(key_hash, reply.get(), resend);
+        });
+  }
+  /**
+   * @return uint32_t, the lock stripe of a key. The hash is mixed with a
+   * seed of its own, so the stripe does not depend on the bits that picked
+   * the server or slot under any partitioner and one server uses all its
+   * stripes.
+   */
+  uint32_t stripe_of(size_t key_hash) const {
+    return static_cast<uint32_t>(
+        partitioner::mix(key_hash ^ STRIPE_SEED) % num_stripes);
+  }
+  rw_lock &stripe_mutex(uint32_t stripe) {
+    return stripes[stripe].mutex;
+  }
+
+  /**
+   * Holds every lock stripe for operations over the whole table, shared for
+   * scans. Stripes are taken in index order, so it cannot deadlock with a
+   * single stripe.
+   */
+  class all_stripes_lock {
+   private:
+    container *owner;
+    bool shared;
+
+   public:
+    all_stripes_lock(container *_owner, bool _shared)
+        : owner(_owner), shared(_shared) {
+      for (uint32_t i = 0; i < owner->num_stripes; ++i) {
+        if (shared)
+          owner->stripes[i].mutex.lock_shared();
+        else
+          owner->stripes[i].mutex.lock();
+      }
+    }
+    ~all_stripes_lock() {
+      for (uint32_t i = owner->num_stripes; i > 0; --i) {
+        if (shared)
+          owner->stripes[i - 1].mutex.unlock_shared();
+        else
+          owner->stripes[i - 1].mutex.unlock();
+      }
+    }
+  };
 
  public:
+  /**
+   * Typed handle to one of the container's remote procedures. The procedure
+   * is resolved once when the container is built and reused on every call.
+   *
+   * @tparam Signature, Ret(Args...) of the remote procedure
+   */
+  template <typename Signature>
+  class rpc_handle;
+
+  template <typename Ret, typename... Args>
+  class rpc_handle<Ret(Args...)> {
+   private:
+    std::shared_ptr<RPC> rpc;
+    RPC::Procedure procedure;
+
+   public:
+    rpc_handle() : rpc(), procedure() {}
+    rpc_handle(std::shared_ptr<RPC> _rpc, CharStruct const &func_name)
+        : rpc(_rpc), procedure(_rpc->define(func_name)) {}
+
+    template <typename... CallArgs>
+    Ret call(uint16_t server_index, CallArgs &&...args) {
+      static_assert(sizeof...(CallArgs) == sizeof...(Args),
+                    "wrong number of arguments for remote procedure");
+      static_assert(std::conjunction<std::is_same<
+                        typename std::decay<CallArgs>::type, Args>...>::value,
+                    "wrong argument types for remote procedure");
+      return rpc->call<Ret>(server_index, procedure,
+                            std::forward<CallArgs>(args)...);
+    }
+
+    template <typename... CallArgs>
+    RPCFuture<Ret> async_call(uint16_t server_index, CallArgs &&...args) {
+      static_assert(sizeof...(CallArgs) == sizeof...(Args),
+                    "wrong number of arguments for remote procedure");
+      static_assert(std::conjunction<std::is_same<
+                        typename std::decay<CallArgs>::type, Args>...>::value,
+                    "wrong argument types for remote procedure");
+      return rpc->async_call<Ret>(server_index, procedure,
+                                  std::forward<CallArgs>(args)...);
+    }
+  };
+
+  /**
+   * Client side buffer that groups operations by destination server so they
+   * can be shipped as one batch RPC. A batch is due once it holds max_size
+   * operations or its oldest operation is older than window_ms. The window
+   * is checked when an operation is added and, when timed(), by a
+   * background thread that drains the buffers every window_ms, so an idle
+   * buffer is not left waiting for the next operation. In write-behind mode
+   * only the size is checked when adding and repeated operations on the
+   * same target coalesce.
+   *
+   * @tparam Request, the buffered operation
+   */
+  template <typename Request>
+  class request_batch {
+   private:
+    std::mutex batch_mutex;
+    std::unique_ptr<std::mutex[]> send_mutexes;
+    std::vector<std::vector<Request>> pending;
+    std::vector<std::chrono::steady_clock::time_point> opened;
+    really_long max_size;
+    uint32_t window_ms;
+    bool background;
+
+   public:
+    request_batch()
+        : batch_mutex(),
+          send_mutexes(),
+          pending(),
+          opened(),
+          max_size(0),
+          window_ms(0),
+          background(false) {}
+
+    void configure(uint16_t servers, really_long _max_size,
+                   uint32_t _window_ms, bool _background = false) {
+      std::lock_guard<std::mutex> guard(batch_mutex);
+      send_mutexes.reset(new std::mutex[servers]);
+      pending.resize(servers);
+      opened.resize(servers);
+      max_size = _max_size;
+      window_ms = _window_ms;
+      background = _background;
+    }
+
+    bool enabled() const { return max_size > 1; }
+    bool write_behind() const { return enabled() && background; }
+    /** @return bool, true if a background thread should drain the buffers. */
+    bool timed() const {
+      return write_behind() || (enabled() && window_ms > 0);
+    }
+
+    /**
+     * Buffers request for server_index. In write-behind mode it replaces
+     * the latest buffered request for which same returns true.
+     * @return bool, true if the batch is due and should be sent.
+     */
+    template <typename Same>
+    bool add(uint16_t server_index, Request &&request, Same same) {
+      std::lock_guard<std::mutex> guard(batch_mutex);
+      auto now = std::chrono::steady_clock::now();
+      auto &batch = pending[server_index];
+      if (batch.empty()) opened[server_index] = now;
+      auto previous = batch.rend();
+      if (background)
+        previous = std::find_if(batch.rbegin(), batch.rend(), same);
+      if (previous != batch.rend())
+        *previous = std::move(request);
+      else
+        batch.push_back(std::move(request));
+      return batch.size() >= max_size ||
+             (!background && now - opened[server_index] >=
+                                 std::chrono::milliseconds(window_ms));
+    }
+    bool add(uint16_t server_index, Request &&request) {
+      return add(server_index, std::move(request),
+                 [](const Request &) { return false; });
+    }
+
+    /**
+     * Removes everything buffered for server_index.
+     * @return std::vector<Request>, the buffered operations in order.
+     */
+    std::vector<Request> take(uint16_t server_index) {
+      std::vector<Request> batch;
+      std::lock_guard<std::mutex> guard(batch_mutex);
+      if (server_index < pending.size()) batch.swap(pending[server_index]);
+      return batch;
+    }
+
+    /**
+     * Held from take() until the batch was sent, so batches for a server
+     * are applied in the order they were taken.
+     */
+    std::mutex &sending(uint16_t server_index) {
+      return send_mutexes[server_index];
+    }
+  };
+
   bool server_on_node;
   virtual void construct_shared_memory() = 0;
   virtual void open_shared_memory() = 0;
@@ -45,6 +777,41 @@ class container {
 
   bool is_local(uint16_t &key_int);
   bool is_local();
+  /** @return uint64_t, the number of routes learned since start. */
+  uint64_t RoutingVersion();
+
+  /**
+   * Free memory of a server's segment. free_blocks[i] counts the free blocks
+   * of at least 2^i and less than 2^(i+1) bytes, if they were asked for.
+   */
+  struct segment_usage {
+    really_long size;
+    really_long free_memory;
+    really_long largest_free_block;
+    std::vector<really_long> free_blocks;
+    /** @return double, share of the free memory outside the largest block. */
+    double fragmentation() const {
+      return free_memory == 0 ? 0.0
+                              : 1.0 - static_cast<double>(largest_free_block) /
+                                          static_cast<double>(free_memory);
+    }
+  };
+  /**
+   * Measures the local segment. Finding the largest free block holds every
+   * lock of the segment while that one block is taken and given back.
+   * @param histogram, also count every free block into free_blocks. This
+   * takes all the free memory, one block at a time, and stalls every
+   * operation on the segment until it is done.
+   */
+  segment_usage GetSegmentUsage(bool histogram = false);
+  /**
+   * Runs a full compaction pass over the local segment, one slice at a
+   * time, so operations only wait for the slice they touch. Entries are
+   * copied within the same segment, never into a fresh one. Only servers
+   * have anything to compact.
+   * @return std::pair<segment_usage, segment_usage>, usage before and after.
+   */
+  std::pair<segment_usage, segment_usage> Compact();
 
   template <typename Allocator, typename MappedType, typename SharedType>
   typename std::enable_if_t<std::is_same<Allocator, nullptr_t>::value,
@@ -61,12 +828,94 @@ class container {
   GetData(MappedType &data) {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
-    Allocator allocator(segment.get_segment_manager());
-    SharedType value(allocator);
+    SharedType value(value_allocator<Allocator>());
     value.assign(data);
     return value;
   }
 
+  template <typename Allocator>
+  typename std::enable_if_t<!is_slab_allocator<Allocator>::value, Allocator>
+  value_allocator() {
+    return Allocator(segment.get_segment_manager());
+  }
+  template <typename Allocator>
+  typename std::enable_if_t<is_slab_allocator<Allocator>::value, Allocator>
+  value_allocator() {
+    return Allocator(slabs);
+  }
+
+  /**
+   * Resolves the remote procedure func_prefix + func_name into handle.
+   * @param handle, handle to initialize
+   * @param func_name, suffix under which the procedure was bound
+   */
+  template <typename Signature>
+  void define_rpc_handle(rpc_handle<Signature> &handle,
+                         CharStruct const &func_name) {
+    HCL_LOG_TRACE();
+    HCL_CPP_FUNCTION()
+    handle = rpc_handle<Signature>(rpc, func_prefix + func_name);
+  }
+
+  /**
+   * Runs an operation over all servers as a scatter-gather: the request to
+   * every other server is sent at once, the local part runs while they are
+   * in flight, and each result goes to gather as soon as it has arrived.
+   * @param scatter, sends the request to one server
+   * @param local, produces the part held by my_server_idx
+   * @param gather, consumes the result of one server
+   */
+  template <typename Response>
+  void scatter_gather(std::function<RPCFuture<Response>(uint16_t)> scatter,
+                      std::function<Response()> local,
+                      std::function<void(Response &)> gather) {
+    HCL_LOG_TRACE();
+    HCL_CPP_FUNCTION()
+    std::vector<RPCFuture<Response>> pending;
+    pending.reserve(num_servers);
+    for (int i = 0; i < num_servers; ++i) {
+      if (i != my_server_idx) pending.push_back(scatter(i));
+    }
+    Response current_server = local();
+    gather(current_server);
+    std::vector<RPCFuture<Response> *> waiting;
+    waiting.reserve(pending.size());
+    for (auto &request : pending) waiting.push_back(&request);
+    std::chrono::microseconds timeout = std::chrono::microseconds::max();
+    if (HCL_CONF->RPC_TIMEOUT_MS > 0)
+      timeout = std::chrono::milliseconds(HCL_CONF->RPC_TIMEOUT_MS);
+    while (!waiting.empty()) {
+      size_t done = rpc->wait_any(waiting, timeout);
+      if (done == waiting.size()) {
+        HCL_LOG_ERROR("%zu servers did not answer in %d ms\n", waiting.size(),
+                      HCL_CONF->RPC_TIMEOUT_MS);
+        throw std::runtime_error("RPC timed out.");
+      }
+      Response server = waiting[done]->get();
+      waiting.erase(waiting.begin() + done);
+      gather(server);
+    }
+  }
+
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+  /**
+   * Binds the member func as func_prefix + func_name of this instance's
+   * server for the loopback RPC implementation.
+   * @param func, Local* method taking its arguments by reference
+   */
+  template <typename Self, typename Ret, typename... Args>
+  void bind_loopback(CharStruct const &func_name, Ret (Self::*func)(Args...)) {
+    HCL_LOG_TRACE();
+    HCL_CPP_FUNCTION()
+    Self *self = static_cast<Self *>(this);
+    std::function<Ret(typename std::decay<Args>::type &...)> handler(
+        [self, func](typename std::decay<Args>::type &...args) {
+          return (self->*func)(args...);
+        });
+    rpc->bind_loopback(my_server_idx, func_prefix + func_name, handler);
+  }
+#endif
+
   virtual ~container();
   container(CharStruct _name, uint16_t _port, uint16_t _num_servers,
             uint16_t _my_server_idx, really_long _memory_allocated,
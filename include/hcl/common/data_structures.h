@@ -38,7 +38,9 @@
 #include <boost/interprocess/containers/vector.hpp>
 #include <chrono>
 #include <cstdint>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace bip = boost::interprocess;
@@ -76,8 +78,42 @@ struct CharStruct {
   bool operator>=(const CharStruct &o) const;
   bool operator<(const CharStruct &o) const;
   bool operator<=(const CharStruct &o) const;
+
+  /**
+   * Length-prefixed encoding used by RPC archives, so that only size()
+   * bytes are sent instead of the whole buffer.
+   */
+  template <typename A>
+  void save(A &ar) const {
+    size_t length = size();
+    ar.write(&length);
+    ar.write(value, length);
+  }
+  template <typename A>
+  void load(A &ar) {
+    size_t length = 0;
+    ar.read(&length);
+    if (length >= sizeof(value)) {
+      throw std::length_error("CharStruct does not fit its buffer.");
+    }
+    ar.read(value, length);
+    value[length] = '\0';
+  }
 };
 
+namespace hcl {
+/**
+ * True for types whose bytes can be sent over the wire as they are. RPC
+ * arguments built from such types are copied in one piece instead of
+ * element by element. Specialize it to std::false_type for trivially
+ * copyable types that hold pointers or handles.
+ */
+template <typename T>
+struct is_wire_pod
+    : std::integral_constant<bool, std::is_trivially_copyable<T>::value &&
+                                       !std::is_pointer<T>::value> {};
+}  // namespace hcl
+
 struct URI {
   uint16_t server_idx;
   CharStruct protocol;
@@ -99,7 +135,7 @@ struct URI {
 template <typename T>
 class CalculateSize {
  public:
-  really_long GetSize(T value) {
+  really_long GetSize(const T &value) {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
     return sizeof(value);
@@ -108,7 +144,7 @@ class CalculateSize {
 template <>
 class CalculateSize<std::string> {
  public:
-  really_long GetSize(std::string value) {
+  really_long GetSize(const std::string &value) {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
     return strlen(value.c_str()) + 1;
@@ -117,11 +153,69 @@ class CalculateSize<std::string> {
 template <>
 class CalculateSize<bip::string> {
  public:
-  really_long GetSize(bip::string value) {
+  really_long GetSize(const bip::string &value) {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
     return strlen(value.c_str()) + 1;
   }
 };
 
+/**
+ * Describes the memory a value occupies so that it can be exposed for RDMA
+ * instead of being serialized. Only trivially copyable values and vectors of
+ * trivially copyable elements are contiguous; IsFixed tells whether the size
+ * is known before the value is received, in which case a table stores the
+ * value inside its node rather than in storage of its own.
+ */
+template <typename T, typename Enable = void>
+class BulkBuffer {
+ public:
+  static constexpr bool IsContiguous = false;
+  static constexpr bool IsFixed = false;
+  void *Data(T &value) { return nullptr; }
+  really_long GetSize(T &value) { return 0; }
+  void Resize(T &value, really_long size) {}
+};
+template <typename T>
+class BulkBuffer<
+    T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+ public:
+  static constexpr bool IsContiguous = true;
+  static constexpr bool IsFixed = true;
+  void *Data(T &value) { return &value; }
+  really_long GetSize(T &value) { return sizeof(T); }
+  void Resize(T &value, really_long size) {}
+};
+template <typename T, typename A>
+class BulkBuffer<
+    std::vector<T, A>,
+    typename std::enable_if<std::is_trivially_copyable<T>::value &&
+                            !std::is_same<T, bool>::value>::type> {
+ public:
+  static constexpr bool IsContiguous = true;
+  static constexpr bool IsFixed = false;
+  void *Data(std::vector<T, A> &value) { return value.data(); }
+  really_long GetSize(std::vector<T, A> &value) {
+    return value.size() * sizeof(T);
+  }
+  void Resize(std::vector<T, A> &value, really_long size) {
+    value.resize(size / sizeof(T));
+  }
+};
+template <typename T, typename A>
+class BulkBuffer<
+    bip::vector<T, A>,
+    typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+ public:
+  static constexpr bool IsContiguous = true;
+  static constexpr bool IsFixed = false;
+  void *Data(bip::vector<T, A> &value) { return value.data(); }
+  really_long GetSize(bip::vector<T, A> &value) {
+    return value.size() * sizeof(T);
+  }
+  void Resize(bip::vector<T, A> &value, really_long size) {
+    value.resize(size / sizeof(T));
+  }
+};
+
 #endif  // INCLUDE_HCL_COMMON_DATA_STRUCTURES_H_
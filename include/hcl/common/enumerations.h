@@ -16,6 +16,25 @@
 #include <hcl/hcl_config.hpp>
 typedef enum RPCImplementation {
   THALLIUM = 1,
+  LOOPBACK = 2,
 } RPCImplementation;
 
+typedef enum SegmentBacking {
+  BACKING_FILE = 1,
+  BACKING_POSIX_SHM = 2,
+  BACKING_MEMFD = 3,
+} SegmentBacking;
+
+typedef enum PartitionScheme {
+  PARTITION_MODULO = 1,
+  PARTITION_JUMP = 2,
+  PARTITION_SLOTS = 3,
+  PARTITION_RANGE = 4,
+} PartitionScheme;
+
+typedef enum ReplicationMode {
+  REPLICATION_SYNC = 1,
+  REPLICATION_ASYNC = 2,
+} ReplicationMode;
+
 #endif  // INCLUDE_HCL_COMMON_ENUMERATIONS_H
@@ -0,0 +1,57 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef INCLUDE_HCL_COMMON_FREQUENCY_SKETCH_H_
+#define INCLUDE_HCL_COMMON_FREQUENCY_SKETCH_H_
+
+#include <atomic>
+#include <cstdint>
+#include <hcl/hcl_config.hpp>
+#include <memory>
+
+namespace hcl {
+/**
+ * Count-min sketch of how often keys are accessed, in a fixed amount of
+ * memory whatever the number of keys. Each key hash bumps one counter in
+ * each of DEPTH rows, and its estimate is the smallest of them: it never
+ * undercounts, and only overcounts when every row collides.
+ *
+ * decay() halves all counters, so estimates follow recent accesses and a
+ * key that is no longer read cools down. Counters are updated with relaxed
+ * atomics, so handler threads count without a lock.
+ */
+class frequency_sketch {
+ private:
+  static constexpr uint32_t DEPTH = 4;
+  uint32_t width;
+  std::unique_ptr<std::atomic<uint32_t>[]> counters;
+
+  std::atomic<uint32_t> &counter(uint32_t row, uint64_t key_hash) const;
+
+ public:
+  /** @param _width, counters per row; more means fewer collisions */
+  explicit frequency_sketch(uint32_t _width);
+
+  /**
+   * Counts accesses to key_hash.
+   * @return uint32_t, the estimate including them.
+   */
+  uint32_t add(uint64_t key_hash, uint32_t count = 1);
+  /** @return uint32_t, the estimated accesses to key_hash. */
+  uint32_t estimate(uint64_t key_hash) const;
+  /** Halves every counter. */
+  void decay();
+};
+}  // namespace hcl
+
+#endif  // INCLUDE_HCL_COMMON_FREQUENCY_SKETCH_H_
@@ -0,0 +1,295 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef INCLUDE_HCL_COMMON_HOT_KEYS_H_
+#define INCLUDE_HCL_COMMON_HOT_KEYS_H_
+
+#include <hcl/common/frequency_sketch.h>
+#include <hcl/common/rw_lock.h>
+#include <hcl/hcl_config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace hcl {
+/**
+ * Which keys are hot, for the server that owns them and for its clients.
+ * The container keeps the copies and sends them; this only decides which
+ * keys have copies and when they must be sent again.
+ *
+ * A server counts the reads of its keys in a frequency_sketch and promotes
+ * a key once it is read threshold times in a window. Writes of a hot key
+ * mark it dirty and get a ticket; a sharer thread calls share with the
+ * dirty keys and publishes the tickets once the copies were sent, so a
+ * write can wait until every copy has its value. At the end of each window
+ * the thread calls end_window, which reports the reads of copies and calls
+ * cool_down().
+ *
+ * A client only remembers the keys it was told are hot, to read them from
+ * any server.
+ *
+ * @tparam Key, the key of the container
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class hot_keys {
+ public:
+  /** Sends the copies of keys, @return bool, false if one was not stored. */
+  typedef std::function<bool(std::vector<Key> &)> share_function;
+
+ private:
+  Hash hash;
+  uint32_t threshold;
+  uint32_t max_keys;
+  size_t max_seen;
+  /** Waits until the predicate holds, yielding to the other handlers **/
+  std::function<void(std::function<bool()>)> wait_until;
+  /** Reads served here, once start() was called **/
+  std::unique_ptr<frequency_sketch> reads;
+  /**
+   * Keys owned here that every server holds a copy of, and those of them
+   * written since their copies were sent. mutex is only held for
+   * bookkeeping, never across a call to share.
+   */
+  std::mutex mutex;
+  std::unordered_set<Key, Hash> owned;
+  std::atomic<size_t> owned_count;
+  std::unordered_set<Key, Hash> dirty;
+  /** Tickets handed to writes of hot keys and the last one sent **/
+  uint64_t requested;
+  std::atomic<uint64_t> published;
+  /** Tickets (from, to] of the last pass whose copies were not all sent **/
+  uint64_t failed_from, failed_to;
+  std::thread sharer;
+  std::condition_variable cv;
+  bool stopped;
+  /** Keys this client was told are hot **/
+  rw_lock seen_lock;
+  std::unordered_set<Key, Hash> seen_keys;
+
+  /**
+   * Shares the latest value of every marked key that is still hot. Only
+   * the sharer calls it, so copies arrive in the order the values were
+   * read and the last one sent is the latest.
+   */
+  void share_dirty(const share_function &share) {
+    std::vector<Key> keys;
+    uint64_t from, to;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      for (auto &key : dirty)
+        if (owned.count(key)) keys.push_back(key);
+      dirty.clear();
+      from = published;
+      to = requested;
+    }
+    bool success = keys.empty() || share(keys);
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!success) {
+      failed_from = from;
+      failed_to = to;
+    }
+    published = to;
+  }
+
+ public:
+  hot_keys(uint32_t _threshold, uint32_t _max_keys, size_t _max_seen,
+           std::function<void(std::function<bool()>)> _wait_until)
+      : hash(),
+        threshold(_threshold),
+        max_keys(_max_keys),
+        max_seen(_max_seen),
+        wait_until(std::move(_wait_until)),
+        reads(),
+        mutex(),
+        owned(),
+        owned_count(0),
+        dirty(),
+        requested(0),
+        published(0),
+        failed_from(0),
+        failed_to(0),
+        sharer(),
+        cv(),
+        stopped(false),
+        seen_lock(),
+        seen_keys() {}
+  ~hot_keys() { stop(); }
+
+  /**
+   * Starts counting reads and the sharer, which wakes up when keys are
+   * marked and at the end of every window_ms window. Must be followed by
+   * stop() before what the callbacks use goes away.
+   */
+  void start(uint32_t sketch_width, uint32_t window_ms,
+             std::function<void()> end_window, share_function share) {
+    reads.reset(new frequency_sketch(sketch_width));
+    stopped = false;
+    sharer = std::thread([this, window_ms, end_window, share]() {
+      auto window = std::chrono::milliseconds(std::max<uint32_t>(window_ms, 1));
+      auto window_end = std::chrono::steady_clock::now() + window;
+      std::unique_lock<std::mutex> guard(mutex);
+      while (!stopped) {
+        if (dirty.empty() &&
+            cv.wait_until(guard, window_end) == std::cv_status::no_timeout)
+          continue;
+        guard.unlock();
+        if (std::chrono::steady_clock::now() >= window_end) {
+          end_window();
+          window_end = std::chrono::steady_clock::now() + window;
+        }
+        share_dirty(share);
+        guard.lock();
+      }
+    });
+  }
+
+  void stop() {
+    if (!sharer.joinable()) return;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      stopped = true;
+    }
+    cv.notify_one();
+    sharer.join();
+  }
+
+  /** @return bool, true if reads are counted here. */
+  bool counting() const { return reads != nullptr; }
+
+  /**
+   * Counts a read of a key owned here and promotes the key once it is read
+   * threshold times in a window. Only reads that find the key are counted,
+   * and a key is promoted only while fewer than max_keys are hot. The key
+   * is published as hot before the sharer reads its value, so a copy never
+   * misses a write.
+   * @return bool, true if the key is hot.
+   */
+  bool count_read(const Key &key, uint64_t key_hash) {
+    if (reads == nullptr) return false;
+    uint32_t count = reads->add(key_hash);
+    /* Hot keys read less than this are dropped at the end of the window. */
+    if (count < (threshold + 1) / 2) return false;
+    std::lock_guard<std::mutex> guard(mutex);
+    if (owned.count(key)) return true;
+    if (count < threshold || owned.size() >= max_keys) return false;
+    owned.insert(key);
+    owned_count = owned.size();
+    dirty.insert(key);
+    ++requested;
+    cv.notify_one();
+    return true;
+  }
+
+  /** Counts reads served from a copy here, or reported by another server. */
+  void add_reads(uint64_t key_hash, uint32_t count = 1) {
+    if (reads != nullptr) reads->add(key_hash, count);
+  }
+  /** @return uint32_t, the reads of key_hash counted in this window. */
+  uint32_t estimate(uint64_t key_hash) const {
+    return reads == nullptr ? 0 : reads->estimate(key_hash);
+  }
+
+  /**
+   * Marks the hot ones among keys to have their copies sent again, or
+   * dropped if they are gone. Called after writes, with no wait. A write
+   * that sees no hot key was applied before a key was promoted, so the
+   * promotion reads its value.
+   * @return uint64_t, ticket to pass to wait(), 0 if none is hot.
+   */
+  uint64_t refresh(const std::vector<Key> &keys) {
+    if (reads == nullptr || owned_count == 0) return 0;
+    std::lock_guard<std::mutex> guard(mutex);
+    bool marked = false;
+    for (auto &key : keys) {
+      if (!owned.count(key)) continue;
+      dirty.insert(key);
+      marked = true;
+    }
+    if (!marked) return 0;
+    cv.notify_one();
+    return ++requested;
+  }
+
+  /**
+   * Waits until the copies written under ticket were sent. Must not be
+   * called with route or stripe locks held.
+   * @return bool, false if they could not be sent to every server.
+   */
+  bool wait(uint64_t ticket) {
+    if (ticket == 0) return true;
+    wait_until([&]() { return published.load() >= ticket; });
+    std::lock_guard<std::mutex> guard(mutex);
+    return ticket <= failed_from || ticket > failed_to;
+  }
+
+  /** Demotes a key that share found gone. */
+  void demote(const Key &key) {
+    std::lock_guard<std::mutex> guard(mutex);
+    owned.erase(key);
+    owned_count = owned.size();
+  }
+
+  /**
+   * Demotes the hot keys read less than half the threshold in the window,
+   * then halves every count.
+   * @return std::vector<Key>, the keys whose copies must be dropped.
+   */
+  std::vector<Key> cool_down() {
+    std::vector<Key> cooled;
+    std::lock_guard<std::mutex> guard(mutex);
+    for (auto key = owned.begin(); key != owned.end();) {
+      if (reads->estimate(hash(*key)) < threshold / 2) {
+        cooled.push_back(*key);
+        key = owned.erase(key);
+      } else {
+        ++key;
+      }
+    }
+    owned_count = owned.size();
+    reads->decay();
+    return cooled;
+  }
+
+  /** @return bool, true if this client was told that key is hot. */
+  bool seen(const Key &key) {
+    if (threshold == 0) return false;
+    std::shared_lock<rw_lock> lock(seen_lock);
+    return seen_keys.count(key) > 0;
+  }
+  /**
+   * Remembers or forgets that key is hot. The set is bounded by max_seen,
+   * the most hot keys all servers can have, and starts over once full.
+   */
+  void learn(const Key &key, bool hot) {
+    std::unique_lock<rw_lock> lock(seen_lock);
+    if (!hot) {
+      seen_keys.erase(key);
+      return;
+    }
+    if (seen_keys.size() >= max_seen) seen_keys.clear();
+    seen_keys.insert(key);
+  }
+};
+}  // namespace hcl
+
+#endif  // INCLUDE_HCL_COMMON_HOT_KEYS_H_
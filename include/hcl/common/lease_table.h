@@ -0,0 +1,114 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef INCLUDE_HCL_COMMON_LEASE_TABLE_H_
+#define INCLUDE_HCL_COMMON_LEASE_TABLE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <hcl/hcl_config.hpp>
+#include <memory>
+#include <vector>
+
+namespace hcl {
+/**
+ * Read leases granted by a server, so that clients may keep what they read
+ * until the lease ends. Keys are hashed into a fixed number of buckets,
+ * each with the end of the latest lease on its keys and the number of
+ * writes waiting on it; keys sharing a bucket only make writes wait longer.
+ *
+ * A write holds its buckets with a lease_hold before it changes anything.
+ * That stops new leases on them and waits until the granted ones end, so
+ * no client reads a value from its cache after it was overwritten.
+ *
+ * Writes run in RPC handlers, so the table waits through the sleep it is
+ * given, which must yield to the other handlers rather than block the
+ * thread that runs them.
+ */
+class lease_table {
+ private:
+  uint32_t buckets;
+  /** End of the latest lease, in steady clock ticks **/
+  std::unique_ptr<std::atomic<int64_t>[]> ends;
+  std::unique_ptr<std::atomic<uint32_t>[]> writers;
+  /** Number of suspend() calls not yet resumed **/
+  std::atomic<uint32_t> suspended;
+  std::function<void(std::chrono::microseconds)> sleep;
+
+  friend class lease_hold;
+
+  void sleep_until(int64_t end) const;
+
+ public:
+  lease_table(uint32_t _buckets,
+              std::function<void(std::chrono::microseconds)> _sleep);
+
+  uint32_t bucket_of(uint64_t key_hash) const;
+  /**
+   * Grants a lease before the key is read. The read must be followed by
+   * still_valid, since a write may have started in between.
+   * @return bool, false if a write of the bucket is waiting.
+   */
+  bool grant(uint64_t key_hash, uint32_t lease_ms);
+  /** @return bool, true if no write of key_hash started since grant. */
+  bool still_valid(uint64_t key_hash) const;
+  /**
+   * Stops granting leases on every bucket until resume(), as a write of
+   * all of them would. Must be followed by wait_all() before the keys
+   * change.
+   */
+  void suspend();
+  void resume();
+  /** Waits for every lease granted so far to end. */
+  void wait_all() const;
+};
+
+/**
+ * Holds the buckets of key_hashes for the lifetime of the object. Does
+ * nothing if table is null, i.e. if the server grants no leases.
+ */
+class lease_hold {
+ private:
+  lease_table *table;
+  std::vector<uint32_t> held;
+
+ public:
+  lease_hold(lease_table *_table, uint64_t key_hash);
+  lease_hold(lease_table *_table, const std::vector<uint64_t> &key_hashes);
+  lease_hold(const lease_hold &) = delete;
+  lease_hold &operator=(const lease_hold &) = delete;
+  ~lease_hold();
+
+ private:
+  void hold();
+};
+
+/**
+ * Suspends the table and waits for its leases to end, then resumes it when
+ * the object goes away. Does nothing if table is null.
+ */
+class lease_pause {
+ private:
+  lease_table *table;
+
+ public:
+  explicit lease_pause(lease_table *_table);
+  lease_pause(const lease_pause &) = delete;
+  lease_pause &operator=(const lease_pause &) = delete;
+  ~lease_pause();
+};
+}  // namespace hcl
+
+#endif  // INCLUDE_HCL_COMMON_LEASE_TABLE_H_
@@ -57,12 +57,32 @@
 #define RPC_CALL_WRAPPER_THALLIUM(funcname, serverVar, ret, ...)
 #endif
 
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+#define RPC_CALL_WRAPPER_LOOPBACK_ENUM() case LOOPBACK:
+#define RPC_CALL_WRAPPER_LOOPBACK1(funcname, serverVar, ret)  \
+  {                                                           \
+    return rpc->call<ret>(serverVar, func_prefix + funcname); \
+  }
+#define RPC_CALL_WRAPPER_LOOPBACK(funcname, serverVar, ret, ...)           \
+  {                                                                        \
+    return rpc->call<ret>(serverVar, func_prefix + funcname, __VA_ARGS__); \
+  }
+#else
+#define RPC_CALL_WRAPPER_LOOPBACK_ENUM()
+#define RPC_CALL_WRAPPER_LOOPBACK1(funcname, serverVar, ret)
+#define RPC_CALL_WRAPPER_LOOPBACK(funcname, serverVar, ret, ...)
+#endif
+
 #define RPC_CALL_WRAPPER1(funcname, serverVar, ret)         \
   [&]() -> ret {                                            \
     auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);  \
     switch (HCL_CONF->RPC_IMPLEMENTATION) {                 \
       RPC_CALL_WRAPPER_THALLIUM_ENUM()                      \
       RPC_CALL_WRAPPER_THALLIUM1(funcname, serverVar, ret)  \
+      RPC_CALL_WRAPPER_LOOPBACK_ENUM()                      \
+      RPC_CALL_WRAPPER_LOOPBACK1(funcname, serverVar, ret)  \
+      default:                                              \
+        break;                                              \
     }                                                       \
     HCL_LOG_ERROR("RPC Implmentation unknown %d",           \
                   (int)HCL_CONF->RPC_IMPLEMENTATION)        \
@@ -74,6 +94,10 @@
     switch (HCL_CONF->RPC_IMPLEMENTATION) {                            \
       RPC_CALL_WRAPPER_THALLIUM_ENUM()                                 \
       RPC_CALL_WRAPPER_THALLIUM(funcname, serverVar, ret, __VA_ARGS__) \
+      RPC_CALL_WRAPPER_LOOPBACK_ENUM()                                 \
+      RPC_CALL_WRAPPER_LOOPBACK(funcname, serverVar, ret, __VA_ARGS__) \
+      default:                                                         \
+        break;                                                         \
     }                                                                  \
     HCL_LOG_ERROR("RPC Implmentation unknown %d",                      \
                   (int)HCL_CONF->RPC_IMPLEMENTATION)                   \
@@ -85,6 +109,10 @@
     switch (HCL_CONF->RPC_IMPLEMENTATION) {                 \
       RPC_CALL_WRAPPER_THALLIUM_ENUM()                      \
       RPC_CALL_WRAPPER_THALLIUM1(funcname, serverVar, ret)  \
+      RPC_CALL_WRAPPER_LOOPBACK_ENUM()                      \
+      RPC_CALL_WRAPPER_LOOPBACK1(funcname, serverVar, ret)  \
+      default:                                              \
+        break;                                              \
     }                                                       \
     HCL_LOG_ERROR("RPC Implmentation unknown %d",           \
                   (int)HCL_CONF->RPC_IMPLEMENTATION)        \
@@ -97,6 +125,10 @@
     switch (HCL_CONF->RPC_IMPLEMENTATION) {                            \
       RPC_CALL_WRAPPER_THALLIUM_ENUM()                                 \
       RPC_CALL_WRAPPER_THALLIUM(funcname, serverVar, ret, __VA_ARGS__) \
+      RPC_CALL_WRAPPER_LOOPBACK_ENUM()                                 \
+      RPC_CALL_WRAPPER_LOOPBACK(funcname, serverVar, ret, __VA_ARGS__) \
+      default:                                                         \
+        break;                                                         \
     }                                                                  \
     HCL_LOG_ERROR("RPC Implmentation unknown %d",                      \
                   (int)HCL_CONF->RPC_IMPLEMENTATION)                   \
@@ -0,0 +1,164 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#ifndef INCLUDE_HCL_COMMON_NEAR_CACHE_H_
+#define INCLUDE_HCL_COMMON_NEAR_CACHE_H_
+
+#include <hcl/common/rw_lock.h>
+#include <hcl/hcl_config.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace hcl {
+/**
+ * Client side cache of values read from servers, each kept until the end
+ * of the lease it was read under. It holds at most capacity bytes, as
+ * counted by the caller for each entry.
+ *
+ * Eviction is CLOCK: a hit only sets the entry's referenced bit, under the
+ * shared lock, and the hand sweeping the slots gives referenced entries a
+ * second chance and takes expired or unreferenced ones. That is close to
+ * LRU without moving anything on a hit.
+ *
+ * @tparam Key, the key of the entries
+ * @tparam Value, the cached value
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class near_cache {
+ private:
+  typedef std::chrono::steady_clock clock;
+
+  struct entry {
+    Key key;
+    Value value;
+    clock::time_point expires;
+    size_t bytes;
+    bool used;
+    std::atomic<bool> referenced;
+
+    entry() : key(), value(), expires(), bytes(0), used(false),
+              referenced(false) {}
+  };
+
+  size_t capacity;
+  size_t bytes_used;
+  rw_lock lock;
+  /** A deque does not move its entries as it grows **/
+  std::deque<entry> slots;
+  std::vector<size_t> free_slots;
+  std::unordered_map<Key, size_t, Hash> index;
+  size_t hand;
+
+  void remove(size_t slot) {
+    entry &victim = slots[slot];
+    index.erase(victim.key);
+    bytes_used -= victim.bytes;
+    victim.used = false;
+    victim.value = Value();
+    free_slots.push_back(slot);
+  }
+
+  /** Sweeps at most two laps, the second finding every bit cleared. */
+  void evict_one() {
+    clock::time_point now = clock::now();
+    for (size_t step = 0; step < 2 * slots.size(); ++step) {
+      size_t slot = hand;
+      hand = (hand + 1) % slots.size();
+      entry &candidate = slots[slot];
+      if (!candidate.used) continue;
+      if (candidate.expires <= now ||
+          !candidate.referenced.exchange(false, std::memory_order_relaxed)) {
+        remove(slot);
+        return;
+      }
+    }
+  }
+
+ public:
+  explicit near_cache(size_t _capacity)
+      : capacity(_capacity),
+        bytes_used(0),
+        lock(),
+        slots(),
+        free_slots(),
+        index(),
+        hand(0) {}
+
+  /**
+   * @return bool, true if key is cached under a lease that has not ended,
+   * in which case value is set.
+   */
+  bool find(const Key &key, Value &value) {
+    std::shared_lock<rw_lock> guard(lock);
+    auto found = index.find(key);
+    if (found == index.end()) return false;
+    entry &hit = slots[found->second];
+    if (hit.expires <= clock::now()) return false;
+    hit.referenced.store(true, std::memory_order_relaxed);
+    value = hit.value;
+    return true;
+  }
+
+  /**
+   * Caches value for key until expires, evicting entries until bytes fit.
+   * Values larger than the whole cache are not kept.
+   */
+  void insert(const Key &key, const Value &value, size_t bytes,
+              clock::time_point expires) {
+    std::unique_lock<rw_lock> guard(lock);
+    auto found = index.find(key);
+    if (found != index.end()) remove(found->second);
+    if (bytes > capacity) return;
+    while (bytes_used + bytes > capacity && !index.empty()) evict_one();
+    size_t slot;
+    if (free_slots.empty()) {
+      slot = slots.size();
+      slots.emplace_back();
+    } else {
+      slot = free_slots.back();
+      free_slots.pop_back();
+    }
+    entry &added = slots[slot];
+    added.key = key;
+    added.value = value;
+    added.expires = expires;
+    added.bytes = bytes;
+    added.used = true;
+    added.referenced.store(false, std::memory_order_relaxed);
+    index.emplace(key, slot);
+    bytes_used += bytes;
+  }
+
+  void erase(const Key &key) {
+    std::unique_lock<rw_lock> guard(lock);
+    auto found = index.find(key);
+    if (found != index.end()) remove(found->second);
+  }
+
+  /** @return size_t, bytes held by the cached entries. */
+  size_t size() {
+    std::shared_lock<rw_lock> guard(lock);
+    return bytes_used;
+  }
+};
+}  // namespace hcl
+
+#endif  // INCLUDE_HCL_COMMON_NEAR_CACHE_H_
@@ -0,0 +1,84 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef INCLUDE_HCL_COMMON_NODE_SEGMENT_H_
+#define INCLUDE_HCL_COMMON_NODE_SEGMENT_H_
+
+#include <hcl/common/data_structures.h>
+#include <hcl/common/typedefs.h>
+
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
+#include <hcl/hcl_config.hpp>
+#include <string>
+#include <utility>
+
+namespace hcl {
+/**
+ * One mapped segment shared by all containers of a server and its on-node
+ * clients, used when NODE_SEGMENT_SIZE is set. Each container carves a
+ * named region out of it and builds its own segment manager inside, so
+ * memory is still accounted per container while the node keeps a single
+ * mapping and descriptor.
+ */
+class node_segment {
+ private:
+  /** Directory entry of a region, found by the container's name **/
+  struct region_entry {
+    boost::interprocess::offset_ptr<char> base;
+    really_long size;
+  };
+
+  bool is_server;
+  bool persistent;
+  CharStruct backed_file;
+  boost::interprocess::managed_mapped_file segment;
+
+ public:
+  node_segment(bool _is_server, CharStruct _backed_file, really_long size,
+               bool _persistent);
+  ~node_segment();
+  node_segment(const node_segment &) = delete;
+  node_segment &operator=(const node_segment &) = delete;
+
+  /**
+   * Allocates a region of size bytes for object. Its contents are left
+   * uninitialized.
+   * @return char *, start of the region, aligned to a cache line.
+   */
+  char *create_region(const std::string &object, really_long size);
+  /**
+   * @return std::pair<char *, really_long>, start and size of the region of
+   * object, or nullptr if it has none.
+   */
+  std::pair<char *, really_long> find_region(const std::string &object);
+  void remove_region(const std::string &object);
+
+  /** Named objects for users of the node segment that need no region. */
+  template <typename T, typename... Args>
+  T *construct(const std::string &object, const Args &...args) {
+    return segment.construct<T>(object.c_str())(args...);
+  }
+  template <typename T>
+  T *find(const std::string &object) {
+    return segment.find<T>(object.c_str()).first;
+  }
+  template <typename T>
+  void destroy(const std::string &object) {
+    segment.destroy<T>(object.c_str());
+  }
+
+  void flush();
+};
+}  // namespace hcl
+
+#endif  // INCLUDE_HCL_COMMON_NODE_SEGMENT_H_
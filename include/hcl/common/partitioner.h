@@ -0,0 +1,177 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef INCLUDE_HCL_COMMON_PARTITIONER_H_
+#define INCLUDE_HCL_COMMON_PARTITIONER_H_
+
+#include <hcl/common/enumerations.h>
+
+#include <atomic>
+#include <cstdint>
+#include <hcl/hcl_config.hpp>
+#include <utility>
+#include <vector>
+
+namespace hcl {
+/**
+ * Owner of a slot as one server knows it. The epoch grows each time the
+ * slot moves, so of two routes for a slot the newer one wins.
+ */
+struct slot_route {
+  uint32_t slot;
+  uint16_t owner;
+  uint32_t epoch;
+
+  template <typename A>
+  void serialize(A &ar) {
+    ar &slot;
+    ar &owner;
+    ar &epoch;
+  }
+};
+
+/**
+ * Reply of a keyed remote procedure of an elastic container. If a key's
+ * slot has moved, nothing was done and moved holds the routes of the
+ * slots that did, else value is the procedure's result. hot tells that the
+ * key is copied to every server, which may then answer reads of it, and
+ * lease_ms how long the server holds writes of it back, so that the value
+ * may be cached until then.
+ *
+ * @tparam Response, the result of the procedure
+ */
+template <typename Response>
+struct routed {
+  std::vector<slot_route> moved;
+  Response value;
+  bool hot;
+  uint32_t lease_ms;
+
+  routed() : moved(), value(), hot(false), lease_ms(0) {}
+  explicit routed(Response _value)
+      : moved(), value(std::move(_value)), hot(false), lease_ms(0) {}
+  explicit routed(std::vector<slot_route> _moved)
+      : moved(std::move(_moved)), value(), hot(false), lease_ms(0) {}
+
+  template <typename A>
+  void serialize(A &ar) {
+    ar &moved;
+    ar &value;
+    ar &hot;
+    ar &lease_ms;
+  }
+};
+
+/**
+ * Maps the hash of a key to the server that owns it. Every container routes
+ * through one, so clients and servers built with the same scheme and
+ * server count agree on where a key lives.
+ *
+ * PARTITION_MODULO takes the hash modulo the server count. PARTITION_JUMP is
+ * jump consistent hashing: adding a server only moves the keys it takes
+ * over. PARTITION_SLOTS hashes keys into a fixed number of logical slots
+ * and looks their owner up in a table, which starts out as the jump hash of
+ * the slot. PARTITION_RANGE splits the hash space into contiguous ranges,
+ * so keys keep their hash order across servers.
+ *
+ * Only the slot table can change while keys are live: it is the routing
+ * table of elastic containers. Slots are reassigned one route at a time and
+ * the version counts the changes. Lookups may run while routes are learned,
+ * but learn() calls must be serialized by the caller.
+ */
+class partitioner {
+ private:
+  PartitionScheme scheme;
+  uint16_t num_servers;
+  /** Size of the space split by PARTITION_RANGE, 0 for all 64 bit hashes **/
+  uint64_t domain;
+  /** Owner and epoch of each slot for PARTITION_SLOTS **/
+  std::vector<std::atomic<uint16_t>> slot_owner;
+  std::vector<std::atomic<uint32_t>> slot_epoch;
+  /** Routes learned since the table was built **/
+  uint64_t version;
+
+ public:
+  partitioner(PartitionScheme _scheme, uint16_t _num_servers,
+              uint32_t num_slots, uint64_t _domain = 0);
+
+  PartitionScheme get_scheme() const { return scheme; }
+  uint16_t servers() const { return num_servers; }
+  /** @return bool, true if slots can move between servers. */
+  bool elastic() const { return scheme == PARTITION_SLOTS; }
+  /** @return uint32_t, the number of slots, 0 unless PARTITION_SLOTS. */
+  uint32_t slots() const { return static_cast<uint32_t>(slot_owner.size()); }
+  uint64_t get_version() const { return version; }
+
+  /** @return uint16_t, the server that owns key_hash. */
+  uint16_t server_of(uint64_t key_hash) const {
+    switch (scheme) {
+      case PARTITION_JUMP:
+        return jump(key_hash, num_servers);
+      case PARTITION_SLOTS:
+        return slot_owner[slot_of(key_hash)].load(std::memory_order_relaxed);
+      case PARTITION_RANGE:
+        return range_of(key_hash);
+      case PARTITION_MODULO:
+      default:
+        return static_cast<uint16_t>(key_hash % num_servers);
+    }
+  }
+  /** @return uint32_t, the slot of key_hash for PARTITION_SLOTS. */
+  uint32_t slot_of(uint64_t key_hash) const {
+    return static_cast<uint32_t>(mix(key_hash) % slot_owner.size());
+  }
+  /**
+   * @return uint64_t, first point of the range owned by server for
+   * PARTITION_RANGE. The range ends where that of server + 1 begins.
+   */
+  uint64_t range_begin(uint16_t server) const;
+
+  /** @return slot_route, the owner and epoch of slot. */
+  slot_route route_of(uint32_t slot) const {
+    return slot_route{slot, slot_owner[slot].load(std::memory_order_relaxed),
+                      slot_epoch[slot].load(std::memory_order_relaxed)};
+  }
+  /**
+   * Takes route if it is newer than the one the table holds for its slot.
+   * @return bool, true if the table changed.
+   */
+  bool learn(const slot_route &route);
+  /**
+   * Gives slot s to the jump hash of s over the first active servers, at
+   * epoch 0. The others hold no slots until a rebalance moves some to them.
+   */
+  void reset_slots(uint16_t active);
+
+  /**
+   * Jump consistent hash of Lamping and Veach.
+   * @return uint16_t, a bucket in [0, buckets).
+   */
+  static uint16_t jump(uint64_t key, uint16_t buckets);
+  /** 64 bit finalizer that spreads skewed hashes over all bits. */
+  static uint64_t mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+  }
+
+ private:
+  /** Points per range for PARTITION_RANGE and how many ranges hold one more. */
+  void range_split(uint64_t &local, uint64_t &extra) const;
+  uint16_t range_of(uint64_t key_hash) const;
+};
+}  // namespace hcl
+
+#endif  // INCLUDE_HCL_COMMON_PARTITIONER_H_
@@ -0,0 +1,123 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef INCLUDE_HCL_COMMON_RW_LOCK_H_
+#define INCLUDE_HCL_COMMON_RW_LOCK_H_
+
+#include <atomic>
+#include <cstdint>
+#include <hcl/hcl_config.hpp>
+
+namespace hcl {
+/**
+ * Reader-writer lock that lives in a shared segment, so that server handler
+ * threads and on-node clients in other processes can share it. It holds no
+ * pointers and only one 32 bit word is waited on.
+ *
+ * Both sides spin for a while before they park. The spin limit adapts to
+ * how long the lock was recently held, so short critical sections are never
+ * put to sleep and long ones stop burning CPU. Parked threads wait on the
+ * state word with a shared futex. A writer that has to park stops new
+ * readers from entering, so a steady stream of readers cannot starve it.
+ *
+ * Meets the Lockable and SharedLockable requirements, so std::unique_lock
+ * and std::shared_lock work with it.
+ */
+class rw_lock {
+ private:
+  static constexpr uint32_t WRITER = 1u << 31;
+  static constexpr uint32_t WAITERS = 1u << 30;
+  static constexpr uint32_t WRITER_PENDING = 1u << 29;
+  static constexpr uint32_t READERS = WRITER_PENDING - 1;
+  static constexpr uint32_t MIN_SPIN = 16;
+  static constexpr uint32_t MAX_SPIN = 4096;
+
+  /** Writer, waiter and pending writer bits followed by the reader count **/
+  std::atomic<uint32_t> state;
+  /** Moving average of the spins it took to get the lock **/
+  std::atomic<uint32_t> spin_estimate;
+
+  static_assert(std::atomic<uint32_t>::is_always_lock_free,
+                "rw_lock needs address free atomics to live in a segment");
+
+  static void relax();
+  /** Blocks while state is still expected or until woken. */
+  void park(uint32_t expected);
+  void wake_all();
+  uint32_t spin_limit() const {
+    uint32_t limit = 2 * spin_estimate.load(std::memory_order_relaxed);
+    return limit < MIN_SPIN ? MIN_SPIN : limit > MAX_SPIN ? MAX_SPIN : limit;
+  }
+  void learn(uint32_t spins) {
+    uint32_t estimate = spin_estimate.load(std::memory_order_relaxed);
+    spin_estimate.store(estimate + (static_cast<int32_t>(spins - estimate) / 8),
+                        std::memory_order_relaxed);
+  }
+  bool try_lock_shared(uint32_t &current) {
+    return !(current & (WRITER | WRITER_PENDING)) &&
+           state.compare_exchange_weak(current, current + 1,
+                                       std::memory_order_acquire);
+  }
+  bool try_lock(uint32_t &current) {
+    return !(current & (WRITER | READERS)) &&
+           state.compare_exchange_weak(
+               current, (current | WRITER) & ~WRITER_PENDING,
+               std::memory_order_acquire);
+  }
+
+ public:
+  rw_lock() : state(0), spin_estimate(MIN_SPIN) {}
+  rw_lock(const rw_lock &) = delete;
+  rw_lock &operator=(const rw_lock &) = delete;
+
+  bool try_lock() {
+    uint32_t current = state.load(std::memory_order_relaxed);
+    return try_lock(current);
+  }
+  bool try_lock_shared() {
+    uint32_t current = state.load(std::memory_order_relaxed);
+    return try_lock_shared(current);
+  }
+
+  void lock() {
+    uint32_t current = state.load(std::memory_order_relaxed);
+    if (try_lock(current)) return;
+    lock_slow();
+  }
+  void lock_shared() {
+    uint32_t current = state.load(std::memory_order_relaxed);
+    if (try_lock_shared(current)) return;
+    lock_shared_slow();
+  }
+
+  /** Readers only ever enter while no writer holds it, so none are left. */
+  void unlock() {
+    if (state.exchange(0, std::memory_order_release) & WAITERS) wake_all();
+  }
+  void unlock_shared() {
+    uint32_t previous = state.fetch_sub(1, std::memory_order_release);
+    if ((previous & READERS) == 1 && (previous & WAITERS)) {
+      uint32_t expected = previous - 1;
+      /* A reader that entered since will wake them when it leaves. */
+      if (state.compare_exchange_strong(expected, expected & ~WAITERS,
+                                        std::memory_order_relaxed))
+        wake_all();
+    }
+  }
+
+ private:
+  void lock_slow();
+  void lock_shared_slow();
+};
+}  // namespace hcl
+
+#endif  // INCLUDE_HCL_COMMON_RW_LOCK_H_
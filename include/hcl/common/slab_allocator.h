@@ -0,0 +1,186 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef INCLUDE_HCL_COMMON_SLAB_ALLOCATOR_H_
+#define INCLUDE_HCL_COMMON_SLAB_ALLOCATOR_H_
+
+#include <hcl/common/constants.h>
+#include <hcl/common/rw_lock.h>
+#include <hcl/common/typedefs.h>
+
+#include <algorithm>
+#include <boost/interprocess/managed_mapped_file.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <hcl/hcl_config.hpp>
+#include <type_traits>
+
+namespace hcl {
+/**
+ * Size-class allocator placed in a segment and layered over its segment
+ * manager. Blocks of up to MAX_BLOCK bytes are cut from slabs and kept on
+ * one free list per size class, so most allocations never take the segment
+ * manager's lock or search its tree. Each thread also keeps a small cache
+ * of blocks per class, so the free lists are only locked to move blocks in
+ * batches. Larger requests go to the segment manager, or to the heap if
+ * the pool has none.
+ *
+ * The free lists are linked with offset_ptr, so every process that maps
+ * the segment can use the pool. A process must attach() before allocating
+ * and detach() before unmapping it.
+ *
+ * A freed block goes back to the free list of its class, never to the
+ * segment manager, so memory freed in one class is not reused by another.
+ * Slabs are only given back upstream when the pool itself is destroyed,
+ * which heap segments do with their container; a mapped segment keeps them
+ * for as long as it exists.
+ */
+class slab_pool {
+ public:
+  typedef boost::interprocess::managed_mapped_file::segment_manager
+      segment_manager;
+  static constexpr size_t MIN_BLOCK = 16;
+  static constexpr size_t MAX_BLOCK = 4096;
+  static constexpr uint32_t NUM_CLASSES = 9;
+  /** Blocks moved between a thread cache and a free list at once **/
+  static constexpr uint32_t BATCH = 32;
+  static constexpr size_t SLAB_SIZE = 64 * 1024;
+
+  explicit slab_pool(segment_manager *_upstream);
+  /** Gives every slab back upstream; no block may still be in use. */
+  ~slab_pool();
+  slab_pool(const slab_pool &) = delete;
+  slab_pool &operator=(const slab_pool &) = delete;
+
+  void *allocate(size_t bytes);
+  void deallocate(void *block, size_t bytes);
+
+  /** Registers the pool, so that thread caches may return blocks to it. */
+  void attach();
+  /**
+   * Returns the blocks every thread of this process caches and unregisters
+   * the pool.
+   */
+  void detach();
+  /**
+   * Called by the server that reattached a segment. Resets the locks a
+   * crashed holder may have left taken, and renews id so that stale thread
+   * caches are not used.
+   */
+  void reset();
+
+  static uint32_t class_of(size_t bytes) {
+    uint32_t size_class = 0;
+    while ((MIN_BLOCK << size_class) < bytes) ++size_class;
+    return size_class;
+  }
+
+ private:
+  friend struct slab_cache;
+  struct free_block {
+    boost::interprocess::offset_ptr<free_block> next;
+  };
+  /** Placed after the blocks of each slab, to find it again **/
+  struct slab_link {
+    boost::interprocess::offset_ptr<slab_link> next;
+  };
+  struct size_class {
+    rw_lock mutex;
+    boost::interprocess::offset_ptr<free_block> head;
+    /** Slabs cut for this class, null in segments built before it **/
+    boost::interprocess::offset_ptr<slab_link> slabs;
+    char padding[HCL_CACHE_LINE -
+                 (sizeof(rw_lock) +
+                  sizeof(boost::interprocess::offset_ptr<free_block>) +
+                  sizeof(boost::interprocess::offset_ptr<slab_link>)) %
+                     HCL_CACHE_LINE];
+  };
+
+  /** Tells the pools apart in the per-process registry of thread caches **/
+  uint64_t id;
+  boost::interprocess::offset_ptr<segment_manager> upstream;
+  size_class classes[NUM_CLASSES];
+
+  static size_t blocks_per_slab(uint32_t size_class) {
+    return std::max<size_t>(SLAB_SIZE / (MIN_BLOCK << size_class), BATCH);
+  }
+  void *upstream_allocate(size_t bytes);
+  void upstream_deallocate(void *block);
+  /**
+   * Moves up to count blocks of size_class into out, cutting a new slab
+   * when the free list is empty.
+   * @return uint32_t, the number of blocks moved.
+   */
+  uint32_t take(uint32_t size_class, void **out, uint32_t count);
+  void give(uint32_t size_class, void **blocks, uint32_t count);
+};
+
+/**
+ * Allocator over a slab_pool, usable in shared memory like
+ * boost::interprocess::allocator. Passed as the Allocator argument of a
+ * container, it also allocates the container's own nodes.
+ *
+ * @tparam T, the allocated type
+ */
+template <typename T>
+class slab_allocator {
+ private:
+  template <typename U>
+  friend class slab_allocator;
+  boost::interprocess::offset_ptr<slab_pool> pool;
+
+ public:
+  typedef T value_type;
+  typedef boost::interprocess::offset_ptr<T> pointer;
+  typedef boost::interprocess::offset_ptr<const T> const_pointer;
+  typedef boost::interprocess::offset_ptr<void> void_pointer;
+  typedef boost::interprocess::offset_ptr<const void> const_void_pointer;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  template <typename U>
+  struct rebind {
+    typedef slab_allocator<U> other;
+  };
+
+  explicit slab_allocator(slab_pool *_pool) : pool(_pool) {}
+  template <typename U>
+  slab_allocator(const slab_allocator<U> &other) : pool(other.pool) {}
+
+  pointer allocate(size_type count) {
+    return pointer(static_cast<T *>(pool->allocate(count * sizeof(T))));
+  }
+  void deallocate(const pointer &block, size_type count) {
+    pool->deallocate(boost::interprocess::ipcdetail::to_raw_pointer(block),
+                     count * sizeof(T));
+  }
+  size_type max_size() const { return size_type(-1) / sizeof(T); }
+
+  template <typename U>
+  bool operator==(const slab_allocator<U> &other) const {
+    return pool == other.pool;
+  }
+  template <typename U>
+  bool operator!=(const slab_allocator<U> &other) const {
+    return pool != other.pool;
+  }
+};
+
+template <typename Allocator>
+struct is_slab_allocator : std::false_type {};
+template <typename T>
+struct is_slab_allocator<slab_allocator<T>> : std::true_type {};
+}  // namespace hcl
+
+#endif  // INCLUDE_HCL_COMMON_SLAB_ALLOCATOR_H_
@@ -34,7 +34,6 @@
 #include <thallium/serialization/proc_input_archive.hpp>
 #include <thallium/serialization/proc_output_archive.hpp>
 #include <thallium/serialization/serialize.hpp>
-#include <thallium/serialization/stl/array.hpp>
 #include <thallium/serialization/stl/complex.hpp>
 #include <thallium/serialization/stl/deque.hpp>
 #include <thallium/serialization/stl/forward_list.hpp>
@@ -64,20 +63,141 @@
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/containers/vector.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <exception>
 #include <fstream>
+#include <functional>
 #include <future>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <typeindex>
 #include <utility>
 #include <vector>
 
 namespace bip = boost::interprocess;
 #if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
 namespace tl = thallium;
+
+/**
+ * std::array serialization, used instead of thallium's stl/array.hpp so
+ * that arrays of hcl::is_wire_pod elements take a single copy. Both define
+ * the same overloads, so whichever is seen first takes thallium's include
+ * guard: if the application included stl/array.hpp before HCL, its
+ * element by element copy is kept, and if it includes it later, the header
+ * is skipped.
+ */
+#if !defined(__THALLIUM_ARRAY_SERIALIZATION_HPP)
+#define __THALLIUM_ARRAY_SERIALIZATION_HPP
+namespace thallium {
+namespace detail {
+template <class A, typename T, std::size_t N>
+inline void save_wire_array(A &ar, std::array<T, N> &v,
+                            const std::true_type &) {
+  ar.write(v.data(), N);
+}
+
+template <class A, typename T, std::size_t N>
+inline void save_wire_array(A &ar, std::array<T, N> &v,
+                            const std::false_type &) {
+  for (auto &elem : v) {
+    ar &elem;
+  }
+}
+
+template <class A, typename T, std::size_t N>
+inline void load_wire_array(A &ar, std::array<T, N> &v,
+                            const std::true_type &) {
+  ar.read(v.data(), N);
+}
+
+template <class A, typename T, std::size_t N>
+inline void load_wire_array(A &ar, std::array<T, N> &v,
+                            const std::false_type &) {
+  for (auto &elem : v) {
+    ar &elem;
+  }
+}
+}  // namespace detail
+
+template <class A, typename T, std::size_t N>
+inline void save(A &ar, std::array<T, N> &v) {
+  detail::save_wire_array(ar, v, hcl::is_wire_pod<T>());
+}
+
+template <class A, typename T, std::size_t N>
+inline void load(A &ar, std::array<T, N> &v) {
+  detail::load_wire_array(ar, v, hcl::is_wire_pod<T>());
+}
+}  // namespace thallium
+#endif  // __THALLIUM_ARRAY_SERIALIZATION_HPP
+#endif
+
+/**
+ * Waitable handle returned by RPC::async_call and the Async* container
+ * operations. It either wraps a request that is still in flight or holds a
+ * value that was already produced locally. Copies share the same result.
+ *
+ * @tparam Response, the return type of the remote procedure
+ */
+template <typename Response>
+class RPCFuture {
+ private:
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+  std::shared_ptr<tl::async_response> thallium_response;
+#endif
+  std::shared_ptr<Response> value;
+  /** Produces the value from the requests it depends on, once ready **/
+  std::function<bool()> deferred_ready;
+  std::function<Response()> deferred;
+
+ public:
+  RPCFuture() : value() {}
+  explicit RPCFuture(Response _value)
+      : value(std::make_shared<Response>(std::move(_value))) {}
+  /**
+   * Handle whose value is computed by complete, which may wait on other
+   * requests; ready reports whether the first of them has arrived.
+   */
+  RPCFuture(std::function<bool()> ready, std::function<Response()> complete)
+      : value(),
+        deferred_ready(std::move(ready)),
+        deferred(std::move(complete)) {}
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+  explicit RPCFuture(tl::async_response &&_response)
+      : thallium_response(
+            std::make_shared<tl::async_response>(std::move(_response))),
+        value() {}
 #endif
 
+  /**
+   * @return bool, true if the handle refers to a request or a value.
+   */
+  bool valid() const;
+  /**
+   * Non-blocking check for completion.
+   * @return bool, true if get() will not block.
+   */
+  bool ready() const;
+  /**
+   * Blocks until the response has arrived.
+   */
+  void wait();
+  /**
+   * Blocks until the response has arrived and returns it.
+   * @return Response, the value returned by the remote procedure
+   */
+  Response get();
+};
+
 class RPC {
  private:
   bool is_server;
@@ -89,13 +209,119 @@ class RPC {
   std::shared_ptr<tl::engine> thallium_server;
   std::shared_ptr<tl::engine> thallium_client;
   CharStruct engine_init_str;
-  std::vector<tl::endpoint> thallium_endpoints;
+  /**
+   * Endpoints of uris, each looked up on first use. A slot is written once
+   * under its once_flag and is only read after that.
+   */
+  std::vector<std::shared_ptr<tl::endpoint>> thallium_endpoints;
+  std::unique_ptr<std::once_flag[]> endpoint_resolved;
+  std::thread endpoint_prefetch;
+  std::atomic<bool> stop_prefetch{false};
   tl::endpoint get_endpoint(URI server_uri);
+  tl::endpoint &resolve_endpoint(uint16_t server_index);
   void init_engine_and_endpoints();
+  void prefetch_endpoints();
+  void join_prefetch();
 
+  /**
+   * Wraps a handler so that it receives the caller's time budget first.
+   * The wrapper runs on the progress pool, where it notes when the request
+   * arrived, and passes the handler on to the handler pool. A request that
+   * waited there longer than its budget is dropped without running. Only
+   * requests with a budget pay for this; bind() also registers the bare
+   * handler for the others.
+   */
+  template <typename... Args>
+  std::function<void(const tl::request &, uint64_t, Args...)> with_deadline(
+      CharStruct const &func_name,
+      std::function<void(const tl::request &, Args...)> func);
+  /** @return tl::remote_procedure, func_name as called with timeout_ms. */
+  tl::remote_procedure define_timed(CharStruct const &func_name,
+                                    int timeout_ms);
+  /**
+   * Sends a request and waits for the response. With a positive timeout_ms
+   * the request carries its budget and the wait is bounded; callable must
+   * then come from define_timed().
+   */
+  template <typename... Args>
+  tl::packed_data invoke(const tl::callable_remote_procedure &callable,
+                         int timeout_ms, Args &&...args);
+  /**
+   * Sends a request without waiting. With a positive timeout_ms the request
+   * carries its budget and waiting on the response is bounded.
+   */
+  template <typename... Args>
+  tl::async_response invoke_async(
+      const tl::callable_remote_procedure &callable, int timeout_ms,
+      Args &&...args);
+#endif
+  /** @return CharStruct, the name of func_name for requests with a budget. */
+  static CharStruct deadline_name(CharStruct const &func_name);
+  /**
+   * @return uint64_t, timeout_ms in microseconds, or 0 (no deadline) if
+   * timeout_ms is not positive. Clocks of client and server are never
+   * compared, so only the remaining time travels with a request.
+   */
+  static uint64_t budget_of(int timeout_ms);
+  /**
+   * @return bool, true if more than budget_us passed since received on the
+   * steady clock of this process.
+   */
+  static bool expired(std::chrono::steady_clock::time_point received,
+                      uint64_t budget_us);
+
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+  /**
+   * Handler bound in this process, stored with the type of its
+   * std::function so that a call with other argument types is caught.
+   */
+  struct LoopbackFunction {
+    std::type_index type;
+    std::shared_ptr<void> function;
+  };
+  std::mutex loopback_mutex;
+  std::map<std::pair<uint16_t, std::string>, LoopbackFunction>
+      loopback_functions;
+  /**
+   * Runs the handler bound as func_name by server_index on the calling
+   * thread. Arguments are passed by reference and never serialized.
+   */
+  template <typename Response, typename... Args>
+  Response loopback_call(uint16_t server_index, CharStruct const &func_name,
+                         Args &&...args);
+  /**
+   * Runs call at once for an async_call. An exception it throws is kept in
+   * the future and rethrown by get(), as a failed remote call would be.
+   */
+  template <typename Response, typename Call>
+  static RPCFuture<Response> loopback_async(Call call);
+  /**
+   * @return uint16_t, index of the server listed with server and port.
+   * Throws if no server matches.
+   */
+  uint16_t loopback_server(CharStruct const &server, uint16_t port);
 #endif
 
  public:
+  /**
+   * Remote procedure resolved once by define() so that it can be reused for
+   * every call instead of being looked up by name each time.
+   */
+  struct Procedure {
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+    std::shared_ptr<tl::remote_procedure> thallium_procedure;
+    /** The same procedure for requests that carry a budget **/
+    std::shared_ptr<tl::remote_procedure> thallium_deadline_procedure;
+    tl::remote_procedure &timed(int timeout_ms) {
+      return timeout_ms > 0 ? *thallium_deadline_procedure
+                            : *thallium_procedure;
+    }
+#endif
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+    CharStruct loopback_name;
+#endif
+  };
+
   void Stop();
   ~RPC();
 
@@ -107,6 +333,26 @@ class RPC {
 
   void run();
 
+  Procedure define(CharStruct const &func_name);
+
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+  /**
+   * Registers a contiguous buffer for RDMA. The returned handle can be sent
+   * as an argument of a remote procedure and must outlive the transfer.
+   */
+  tl::bulk expose(void *data, really_long size, tl::bulk_mode mode);
+#endif
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+  /**
+   * Registers func as func_name of server server_index. Every container
+   * instance binds under its own index, so one process can simulate all
+   * servers by building one server instance per index.
+   */
+  template <typename Ret, typename... Args>
+  void bind_loopback(uint16_t server_index, CharStruct const &func_name,
+                     std::function<Ret(Args &...)> func);
+#endif
+
   template <typename Response, typename... Args>
   Response call(uint16_t server_index, CharStruct const &func_name,
                 Args... args);
@@ -115,14 +361,43 @@ class RPC {
   Response call(CharStruct &server, uint16_t &port, CharStruct const &func_name,
                 Args... args);
   template <typename Response, typename... Args>
+  Response call(uint16_t server_index, Procedure &procedure, Args &&...args);
+  template <typename Response, typename... Args>
   Response callWithTimeout(uint16_t server_index, int timeout_ms,
                            CharStruct const &func_name, Args... args);
   template <typename Response, typename... Args>
-  std::future<Response> async_call(uint16_t server_index,
-                                   CharStruct const &func_name, Args... args);
+  RPCFuture<Response> async_call(uint16_t server_index,
+                                 CharStruct const &func_name, Args... args);
+  template <typename Response, typename... Args>
+  RPCFuture<Response> async_call(CharStruct &server, uint16_t &port,
+                                 CharStruct const &func_name, Args... args);
   template <typename Response, typename... Args>
-  std::future<Response> async_call(CharStruct &server, uint16_t &port,
-                                   CharStruct const &func_name, Args... args);
+  RPCFuture<Response> async_call(uint16_t server_index, Procedure &procedure,
+                                 Args &&...args);
+
+  /**
+   * Sleeps for duration. With Thallium the sleep goes through the engine's
+   * timers, so inside a handler only the calling ULT waits and its
+   * execution stream keeps running the others.
+   */
+  void sleep(std::chrono::microseconds duration);
+  /**
+   * Waits until done returns true or timeout has passed, sleeping between
+   * checks instead of spinning. The pause doubles from 20 us up to a
+   * millisecond. A timeout of microseconds::max() waits for as long as it
+   * takes.
+   * @return bool, true if done returned true in time.
+   */
+  bool wait_until(std::function<bool()> done,
+                  std::chrono::microseconds timeout);
+  /**
+   * Waits as wait_until() for one of futures to be ready.
+   * @return size_t, the index of a ready future, or futures.size() if none
+   * was ready in time.
+   */
+  template <typename Response>
+  size_t wait_any(std::vector<RPCFuture<Response> *> const &futures,
+                  std::chrono::microseconds timeout);
 };
 
 #include "rpc_lib_int.cpp"
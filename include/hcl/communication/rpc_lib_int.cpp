@@ -24,12 +24,130 @@ void RPC::bind(CharStruct str, F func) {
 #endif
 #if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
     {
-      thallium_server->define(str.string(), func);
+      /* Untimed requests run inline on the handler pool. Only those with a
+       * budget stop on the progress pool to note when they arrived. */
+      thallium_server->define(str.string(), func, 0,
+                              thallium_server->get_handler_pool());
+      thallium_server->define(deadline_name(str).string(),
+                              with_deadline(str, func), 0,
+                              thallium_server->get_progress_pool());
       break;
     }
 #endif
+    default:
+      break;
+  }
+}
+
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+template <typename... Args>
+std::function<void(const tl::request &, uint64_t, Args...)>
+RPC::with_deadline(CharStruct const &func_name,
+                   std::function<void(const tl::request &, Args...)> func) {
+  tl::pool handlers = thallium_server->get_handler_pool();
+  return [func_name, func, handlers](const tl::request &thallium_req,
+                                     uint64_t budget_us,
+                                     Args... args) mutable {
+    auto received = std::chrono::steady_clock::now();
+    auto packed =
+        std::make_shared<std::tuple<typename std::decay<Args>::type...>>(
+            std::move(args)...);
+    handlers.make_thread(
+        [func_name, func, thallium_req, budget_us, received, packed]() {
+          if (expired(received, budget_us)) {
+            /* The caller has already given up, so nobody waits for a
+             * response. */
+            HCL_LOG_WARN("Dropping expired request %s\n", func_name.c_str());
+            return;
+          }
+          std::apply(
+              [&](typename std::decay<Args>::type &...unpacked) {
+                func(thallium_req, std::forward<Args>(unpacked)...);
+              },
+              *packed);
+        },
+        tl::anonymous());
+  };
+}
+
+template <typename... Args>
+tl::packed_data RPC::invoke(const tl::callable_remote_procedure &callable,
+                            int timeout_ms, Args &&...args) {
+  if (timeout_ms <= 0) return callable(std::forward<Args>(args)...);
+  try {
+    return callable.timed(std::chrono::milliseconds(timeout_ms),
+                          budget_of(timeout_ms), std::forward<Args>(args)...);
+  } catch (const tl::timeout &) {
+    HCL_LOG_ERROR("RPC timed out after %d ms\n", timeout_ms);
+    throw std::runtime_error("RPC timed out.");
+  }
+}
+
+template <typename... Args>
+tl::async_response RPC::invoke_async(
+    const tl::callable_remote_procedure &callable, int timeout_ms,
+    Args &&...args) {
+  if (timeout_ms <= 0) return callable.async(std::forward<Args>(args)...);
+  /* RPCFuture::wait() turns the expired wait into an error. */
+  return callable.timed_async(std::chrono::milliseconds(timeout_ms),
+                              budget_of(timeout_ms),
+                              std::forward<Args>(args)...);
+}
+#endif
+
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+template <typename Ret, typename... Args>
+void RPC::bind_loopback(uint16_t server_index, CharStruct const &func_name,
+                        std::function<Ret(Args &...)> func) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  typedef std::function<Ret(Args &...)> function_type;
+  std::lock_guard<std::mutex> guard(loopback_mutex);
+  loopback_functions.insert_or_assign(
+      std::make_pair(server_index, func_name.string()),
+      LoopbackFunction{std::type_index(typeid(function_type)),
+                       std::make_shared<function_type>(std::move(func))});
+}
+
+template <typename Response, typename... Args>
+Response RPC::loopback_call(uint16_t server_index, CharStruct const &func_name,
+                            Args &&...args) {
+  typedef std::function<Response(typename std::decay<Args>::type &...)>
+      function_type;
+  std::shared_ptr<void> function;
+  {
+    std::lock_guard<std::mutex> guard(loopback_mutex);
+    auto iter = loopback_functions.find(
+        std::make_pair(server_index, func_name.string()));
+    if (iter == loopback_functions.end()) {
+      HCL_LOG_ERROR("Procedure %s is not bound by server %d\n",
+                    func_name.c_str(), server_index);
+      throw std::logic_error("Remote procedure is not bound.");
+    }
+    if (iter->second.type != std::type_index(typeid(function_type))) {
+      HCL_LOG_ERROR("Procedure %s called with mismatching types\n",
+                    func_name.c_str());
+      throw std::logic_error("Remote procedure called with wrong types.");
+    }
+    function = iter->second.function;
   }
+  return (*std::static_pointer_cast<function_type>(function))(args...);
 }
+
+template <typename Response, typename Call>
+RPCFuture<Response> RPC::loopback_async(Call call) {
+  try {
+    return RPCFuture<Response>(call());
+  } catch (const std::exception &) {
+    std::exception_ptr error = std::current_exception();
+    return RPCFuture<Response>([]() { return true; },
+                               [error]() -> Response {
+                                 std::rethrow_exception(error);
+                               });
+  }
+}
+#endif
+
 template <typename Response, typename... Args>
 Response RPC::callWithTimeout(uint16_t server_index, int timeout_ms,
                               CharStruct const &func_name, Args... args) {
@@ -38,16 +156,22 @@ Response RPC::callWithTimeout(uint16_t server_index, int timeout_ms,
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
     case THALLIUM: {
       tl::remote_procedure remote_procedure =
-          thallium_client->define(func_name.c_str());
-      // Setup args for RDMA bulk transfer
-      // std::vector<std::pair<void*,std::size_t>> segments(num_args);
-
-      return remote_procedure.on(thallium_endpoints[server_index])(
-          std::forward<Args>(args)...);
+          define_timed(func_name, timeout_ms);
+      return invoke(remote_procedure.on(resolve_endpoint(server_index)),
+                    timeout_ms, std::forward<Args>(args)...);
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      /* Handlers run on the calling thread, so there is nothing to time. */
+      return loopback_call<Response>(server_index, func_name, args...);
+    }
+#endif
+    default:
+      break;
   }
+  throw std::logic_error("Function not implemented error.");
 }
 template <typename Response, typename... Args>
 Response RPC::call(uint16_t server_index, CharStruct const &func_name,
@@ -57,12 +181,45 @@ Response RPC::call(uint16_t server_index, CharStruct const &func_name,
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
     case THALLIUM: {
       tl::remote_procedure remote_procedure =
-          thallium_client->define(func_name.c_str());
-      return remote_procedure.on(thallium_endpoints[server_index])(
-          std::forward<Args>(args)...);
+          define_timed(func_name, HCL_CONF->RPC_TIMEOUT_MS);
+      return invoke(remote_procedure.on(resolve_endpoint(server_index)),
+                    HCL_CONF->RPC_TIMEOUT_MS, std::forward<Args>(args)...);
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      return loopback_call<Response>(server_index, func_name, args...);
+    }
+#endif
+    default:
+      break;
+  }
+  throw std::logic_error("Function not implemented error.");
+}
+
+template <typename Response, typename... Args>
+Response RPC::call(uint16_t server_index, Procedure &procedure,
+                   Args &&...args) {
+  HCL_LOG_TRACE_FORMAT("(%d)", server_index);
+  switch (HCL_CONF->RPC_IMPLEMENTATION) {
+#ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
+    case THALLIUM: {
+      return invoke(
+          procedure.timed(HCL_CONF->RPC_TIMEOUT_MS)
+              .on(resolve_endpoint(server_index)),
+          HCL_CONF->RPC_TIMEOUT_MS, std::forward<Args>(args)...);
+      break;
+    }
+#endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      return loopback_call<Response>(server_index, procedure.loopback_name,
+                                     std::forward<Args>(args)...);
+    }
+#endif
+    default:
+      break;
   }
   throw std::logic_error("Function not implemented error.");
 }
@@ -75,47 +232,187 @@ Response RPC::call(CharStruct &server, uint16_t &port,
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
     case THALLIUM: {
       tl::remote_procedure remote_procedure =
-          thallium_client->define(func_name.c_str());
+          define_timed(func_name, HCL_CONF->RPC_TIMEOUT_MS);
       auto new_uri = URI(0, uris[0].user_uri, server, port);
       auto end_point = get_endpoint(new_uri);
-      return remote_procedure.on(end_point)(std::forward<Args>(args)...);
+      return invoke(remote_procedure.on(end_point), HCL_CONF->RPC_TIMEOUT_MS,
+                    std::forward<Args>(args)...);
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      return loopback_call<Response>(loopback_server(server, port), func_name,
+                                     args...);
+    }
+#endif
+    default:
+      break;
   }
   throw std::logic_error("Function not implemented error.");
 }
 
 template <typename Response, typename... Args>
-std::future<Response> RPC::async_call(uint16_t server_index,
-                                      CharStruct const &func_name,
-                                      Args... args) {
+RPCFuture<Response> RPC::async_call(uint16_t server_index,
+                                    CharStruct const &func_name,
+                                    Args... args) {
   HCL_LOG_TRACE_FORMAT("(%d, %s)", server_index, func_name.c_str());
 
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
     case THALLIUM: {
-      // TODO:NotImplemented error
+      tl::remote_procedure remote_procedure =
+          define_timed(func_name, HCL_CONF->RPC_TIMEOUT_MS);
+      return RPCFuture<Response>(
+          invoke_async(remote_procedure.on(resolve_endpoint(server_index)),
+                       HCL_CONF->RPC_TIMEOUT_MS, std::forward<Args>(args)...));
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      return loopback_async<Response>([&]() {
+        return loopback_call<Response>(server_index, func_name, args...);
+      });
+    }
+#endif
+    default:
+      break;
   }
+  throw std::logic_error("Function not implemented error.");
 }
 
 template <typename Response, typename... Args>
-std::future<Response> RPC::async_call(CharStruct &server, uint16_t &port,
-                                      CharStruct const &func_name,
-                                      Args... args) {
+RPCFuture<Response> RPC::async_call(CharStruct &server, uint16_t &port,
+                                    CharStruct const &func_name,
+                                    Args... args) {
   HCL_LOG_TRACE_FORMAT("(%d, %d, %s)", server, port, func_name.c_str());
 
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
     case THALLIUM: {
-      // TODO:NotImplemented error
+      tl::remote_procedure remote_procedure =
+          define_timed(func_name, HCL_CONF->RPC_TIMEOUT_MS);
+      auto new_uri = URI(0, uris[0].user_uri, server, port);
+      auto end_point = get_endpoint(new_uri);
+      return RPCFuture<Response>(invoke_async(remote_procedure.on(end_point),
+                                              HCL_CONF->RPC_TIMEOUT_MS,
+                                              std::forward<Args>(args)...));
+      break;
+    }
+#endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      return loopback_async<Response>([&]() {
+        return loopback_call<Response>(loopback_server(server, port),
+                                       func_name, args...);
+      });
+    }
+#endif
+    default:
+      break;
+  }
+  throw std::logic_error("Function not implemented error.");
+}
+
+template <typename Response, typename... Args>
+RPCFuture<Response> RPC::async_call(uint16_t server_index,
+                                    Procedure &procedure, Args &&...args) {
+  HCL_LOG_TRACE_FORMAT("(%d)", server_index);
+
+  switch (HCL_CONF->RPC_IMPLEMENTATION) {
+#ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
+    case THALLIUM: {
+      return RPCFuture<Response>(invoke_async(
+          procedure.timed(HCL_CONF->RPC_TIMEOUT_MS)
+              .on(resolve_endpoint(server_index)),
+          HCL_CONF->RPC_TIMEOUT_MS, std::forward<Args>(args)...));
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      /* The handler has already run when the future is returned. */
+      return loopback_async<Response>([&]() {
+        return loopback_call<Response>(server_index, procedure.loopback_name,
+                                       std::forward<Args>(args)...);
+      });
+    }
+#endif
+    default:
+      break;
   }
+  throw std::logic_error("Function not implemented error.");
+}
+
+template <typename Response>
+size_t RPC::wait_any(std::vector<RPCFuture<Response> *> const &futures,
+                     std::chrono::microseconds timeout) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t found = futures.size();
+  wait_until(
+      [&]() {
+        for (found = 0; found < futures.size(); ++found) {
+          if (futures[found]->ready()) return true;
+        }
+        return false;
+      },
+      timeout);
+  return found;
+}
+
+template <typename Response>
+bool RPCFuture<Response>::valid() const {
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+  if (thallium_response != nullptr) return true;
+#endif
+  return value != nullptr || deferred != nullptr;
+}
+
+template <typename Response>
+bool RPCFuture<Response>::ready() const {
+  if (value != nullptr) return true;
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+  if (thallium_response != nullptr) return thallium_response->received();
+#endif
+  if (deferred != nullptr) return deferred_ready();
+  return false;
+}
+
+template <typename Response>
+void RPCFuture<Response>::wait() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (value != nullptr) return;
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+  if (thallium_response != nullptr) {
+    try {
+      value = std::make_shared<Response>(
+          thallium_response->wait().template as<Response>());
+    } catch (const tl::timeout &) {
+      HCL_LOG_ERROR("RPC timed out after %d ms\n", HCL_CONF->RPC_TIMEOUT_MS);
+      throw std::runtime_error("RPC timed out.");
+    }
+    thallium_response.reset();
+    return;
+  }
+#endif
+  if (deferred != nullptr) {
+    value = std::make_shared<Response>(deferred());
+    deferred = nullptr;
+    deferred_ready = nullptr;
+    return;
+  }
+  throw std::logic_error("Waiting on an empty RPCFuture.");
+}
+
+template <typename Response>
+Response RPCFuture<Response>::get() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  wait();
+  return *value;
 }
 
 #endif  // INCLUDE_HCL_COMMUNICATION_RPC_LIB_CPP_
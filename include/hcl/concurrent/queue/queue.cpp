@@ -20,7 +20,7 @@ bool concurrent_queue<ValueT>::Push(uint64_t &s, ValueT &data) {
   uint16_t key_int = static_cast<uint16_t>(s);
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
-  return RPC_CALL_WRAPPER("_Push", key_int, bool, data);
+  return push_rpc.call(key_int, data);
 }
 
 template <typename ValueT>
@@ -28,10 +28,30 @@ std::pair<bool, ValueT> concurrent_queue<ValueT>::Pop(uint64_t &s) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   uint16_t key_int = static_cast<uint16_t>(s);
-  typedef std::pair<bool, ValueT> ret_type;
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
-  return RPC_CALL_WRAPPER1("_Pop", key_int, ret_type);
+  return pop_rpc.call(key_int);
+}
+
+template <typename ValueT>
+RPCFuture<bool> concurrent_queue<ValueT>::AsyncPush(uint64_t &s, ValueT &data) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(s);
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return push_rpc.async_call(key_int, data);
+}
+
+template <typename ValueT>
+RPCFuture<std::pair<bool, ValueT>> concurrent_queue<ValueT>::AsyncPop(
+    uint64_t &s) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(s);
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return pop_rpc.async_call(key_int);
 }
 
 #endif
@@ -51,6 +51,9 @@ class concurrent_queue : public container {
 
  private:
   queue_type *queue;
+  /** Remote procedures **/
+  rpc_handle<bool(ValueT)> push_rpc;
+  rpc_handle<std::pair<bool, ValueT>()> pop_rpc;
 
  public:
   ~concurrent_queue() {
@@ -69,7 +72,6 @@ class concurrent_queue : public container {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
 
-    auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
     switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
       case THALLIUM:
@@ -89,6 +91,15 @@ class concurrent_queue : public container {
         break;
       }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+      case LOOPBACK: {
+        bind_loopback("_Push", &concurrent_queue::LocalPush);
+        bind_loopback("_Pop", &concurrent_queue::LocalPop);
+        break;
+      }
+#endif
+      default:
+        break;
     }
   }
 
@@ -111,6 +122,8 @@ class concurrent_queue : public container {
       bind_functions();
     } else if (!is_server && server_on_node) {
     }
+    define_rpc_handle(push_rpc, "_Push");
+    define_rpc_handle(pop_rpc, "_Pop");
   }
 
   queue_type *data() {
@@ -144,6 +157,8 @@ class concurrent_queue : public container {
 
   bool Push(uint64_t &s, ValueT &v);
   std::pair<bool, ValueT> Pop(uint64_t &s);
+  RPCFuture<bool> AsyncPush(uint64_t &s, ValueT &v);
+  RPCFuture<std::pair<bool, ValueT>> AsyncPop(uint64_t &s);
 };
 
 #include "queue.cpp"
@@ -22,7 +22,7 @@ bool concurrent_skiplist<T, HashFcn, Comp, NodeAlloc, MAX_HEIGHT>::Insert(
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
 
-  return RPC_CALL_WRAPPER("_Insert", key_int, bool, key);
+  return insert_rpc.call(key_int, key);
 }
 
 template <typename T, typename HashFcn, typename Comp, typename NodeAlloc,
@@ -34,7 +34,7 @@ bool concurrent_skiplist<T, HashFcn, Comp, NodeAlloc, MAX_HEIGHT>::Find(
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
-  return RPC_CALL_WRAPPER("_Find", key_int, bool, key);
+  return find_rpc.call(key_int, key);
 }
 
 template <typename T, typename HashFcn, typename Comp, typename NodeAlloc,
@@ -46,7 +46,46 @@ bool concurrent_skiplist<T, HashFcn, Comp, NodeAlloc, MAX_HEIGHT>::Erase(
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
-  return RPC_CALL_WRAPPER("_Erase", key_int, bool, key);
+  return erase_rpc.call(key_int, key);
+}
+
+template <typename T, typename HashFcn, typename Comp, typename NodeAlloc,
+          int MAX_HEIGHT>
+RPCFuture<bool>
+concurrent_skiplist<T, HashFcn, Comp, NodeAlloc, MAX_HEIGHT>::AsyncInsert(
+    T &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return insert_rpc.async_call(key_int, key);
+}
+
+template <typename T, typename HashFcn, typename Comp, typename NodeAlloc,
+          int MAX_HEIGHT>
+RPCFuture<bool>
+concurrent_skiplist<T, HashFcn, Comp, NodeAlloc, MAX_HEIGHT>::AsyncFind(
+    T &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return find_rpc.async_call(key_int, key);
+}
+
+template <typename T, typename HashFcn, typename Comp, typename NodeAlloc,
+          int MAX_HEIGHT>
+RPCFuture<bool>
+concurrent_skiplist<T, HashFcn, Comp, NodeAlloc, MAX_HEIGHT>::AsyncErase(
+    T &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return erase_rpc.async_call(key_int, key);
 }
 
 #endif
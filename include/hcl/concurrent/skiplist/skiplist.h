@@ -40,11 +40,12 @@
 
 /*This file contains the class that implements a distributed concurrent set. The
  * total size of the set is not fixed. Each server has a set. The total key
- * space is partitioned across servers using the upper log(n) bits where 'n' is
- * the number of servers. A client program should locate the server for its key
- * and make RPC calls to it for performing set operations. The underlying set is
- * implemented using a concurrent randomized skiplist. The skiplist can be
- * accessed concurrently using multiple threads.*/
+ * space is partitioned across servers by the PARTITIONER scheme, where
+ * PARTITION_RANGE keeps the hash order of the keys. A client program should
+ * locate the server for its key and make RPC calls to it for performing set
+ * operations. The underlying set is implemented using a concurrent
+ * randomized skiplist. The skiplist can be accessed concurrently using
+ * multiple threads.*/
 
 namespace hcl {
 
@@ -59,32 +60,18 @@ class concurrent_skiplist : public container {
   uint64_t totalSize;
   uint32_t nservers;
   uint32_t serverid;
-  uint64_t nbits;
   SkipListType *s;
   SkipListAccessor *a;
-
-  uint64_t power_of_two(int n) {
-    HCL_LOG_TRACE();
-    HCL_CPP_FUNCTION()
-    int c = 1;
-    while (c < n) {
-      c = 2 * c;
-    }
-    return c;
-  }
+  /** Remote procedures **/
+  rpc_handle<bool(T)> insert_rpc;
+  rpc_handle<bool(T)> find_rpc;
+  rpc_handle<bool(T)> erase_rpc;
 
  public:
   uint64_t serverLocation(T &k) {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
-    uint64_t id = -1;
-    uint64_t hashval = HashFcn()(k);
-    uint64_t mask = UINT64_MAX;
-    mask = mask << (64 - nbits);
-    id = hashval & mask;
-    id = id >> (64 - nbits);
-    if (id >= nservers) id = nservers - 1;
-    return id;
+    return partition.server_of(HashFcn()(k));
   }
 
   bool isLocal(T &k) {
@@ -99,8 +86,8 @@ class concurrent_skiplist : public container {
   void initialize_sets(uint32_t np, uint32_t rank) {
     nservers = np;
     serverid = rank;
-    uint64_t nservers_2 = power_of_two(nservers);
-    nbits = log2(nservers_2);
+    partition = partitioner(HCL_CONF->PARTITIONER, nservers,
+                            HCL_CONF->PARTITION_SLOTS);
 
     s = nullptr;
     a = nullptr;
@@ -126,7 +113,6 @@ class concurrent_skiplist : public container {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
 
-    auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
     switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
       case THALLIUM:
@@ -153,6 +139,16 @@ class concurrent_skiplist : public container {
         break;
       }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+      case LOOPBACK: {
+        bind_loopback("_Insert", &concurrent_skiplist::LocalInsert);
+        bind_loopback("_Find", &concurrent_skiplist::LocalFind);
+        bind_loopback("_Erase", &concurrent_skiplist::LocalErase);
+        break;
+      }
+#endif
+      default:
+        break;
     }
   }
 
@@ -175,6 +171,9 @@ class concurrent_skiplist : public container {
       bind_functions();
     } else if (!is_server && server_on_node) {
     }
+    define_rpc_handle(insert_rpc, "_Insert");
+    define_rpc_handle(find_rpc, "_Find");
+    define_rpc_handle(erase_rpc, "_Erase");
   }
 
   bool LocalInsert(T &k) {
@@ -206,6 +205,9 @@ class concurrent_skiplist : public container {
   bool Insert(T &k);
   bool Find(T &k);
   bool Erase(T &k);
+  RPCFuture<bool> AsyncInsert(T &k);
+  RPCFuture<bool> AsyncFind(T &k);
+  RPCFuture<bool> AsyncErase(T &k);
 };
 #include "skiplist.cpp"
 }  // namespace hcl
@@ -21,7 +21,7 @@ bool concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::Insert(
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
-  return RPC_CALL_WRAPPER("_Insert", key_int, bool, key, data);
+  return insert_rpc.call(key_int, key, data);
 }
 
 template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
@@ -32,7 +32,7 @@ bool concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::Find(
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
-  return RPC_CALL_WRAPPER("_Find", key_int, bool, key);
+  return find_rpc.call(key_int, key);
 }
 
 template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
@@ -43,7 +43,7 @@ bool concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::Erase(
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
-  return RPC_CALL_WRAPPER("_Erase", key_int, bool, key);
+  return erase_rpc.call(key_int, key);
 }
 
 template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
@@ -54,7 +54,7 @@ ValueT concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::Get(
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
-  return RPC_CALL_WRAPPER("_Get", key_int, ValueT, key);
+  return get_rpc.call(key_int, key);
 }
 
 template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
@@ -65,7 +65,67 @@ bool concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::Update(
   uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
   HCL_CPP_FUNCTION_UPDATE("access", "remote");
   HCL_CPP_FUNCTION_UPDATE("server", key_int);
-  return RPC_CALL_WRAPPER("_Update", key_int, bool, key, data);
+  return update_rpc.call(key_int, key, data);
+}
+
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
+RPCFuture<bool>
+concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::AsyncInsert(
+    KeyT &key, ValueT &data) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return insert_rpc.async_call(key_int, key, data);
+}
+
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
+RPCFuture<bool>
+concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::AsyncFind(
+    KeyT &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return find_rpc.async_call(key_int, key);
+}
+
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
+RPCFuture<bool>
+concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::AsyncErase(
+    KeyT &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return erase_rpc.async_call(key_int, key);
+}
+
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
+RPCFuture<ValueT>
+concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::AsyncGet(
+    KeyT &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return get_rpc.async_call(key_int, key);
+}
+
+template <typename KeyT, typename ValueT, typename HashFcn, typename EqualFcn>
+RPCFuture<bool>
+concurrent_unordered_map<KeyT, ValueT, HashFcn, EqualFcn>::AsyncUpdate(
+    KeyT &key, ValueT &data) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint16_t key_int = static_cast<uint16_t>(serverLocation(key));
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  return update_rpc.async_call(key_int, key, data);
 }
 
 #endif
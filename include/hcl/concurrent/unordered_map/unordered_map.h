@@ -65,6 +65,12 @@ class concurrent_unordered_map : public container {
   KeyT emptyKey;
   pool_type *pl;
   map_type *my_table;
+  /** Remote procedures **/
+  rpc_handle<bool(KeyT, ValueT)> insert_rpc;
+  rpc_handle<bool(KeyT)> find_rpc;
+  rpc_handle<bool(KeyT)> erase_rpc;
+  rpc_handle<ValueT(KeyT)> get_rpc;
+  rpc_handle<bool(KeyT, ValueT)> update_rpc;
 
  public:
   bool isLocal(KeyT &k) {
@@ -81,20 +87,7 @@ class concurrent_unordered_map : public container {
   uint64_t serverLocation(KeyT &k) {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
-    uint64_t localSize = totalSize / num_servers;
-    uint64_t rem = totalSize % num_servers;
-    uint64_t hashval = HashFcn()(k);
-    uint64_t v = hashval % totalSize;
-    uint64_t offset = rem * (localSize + 1);
-    uint64_t id = -1;
-    if (v < totalSize) {
-      if (v < offset)
-        id = v / (localSize + 1);
-      else
-        id = rem + ((v - offset) / localSize);
-    }
-
-    return id;
+    return partition.server_of(HashFcn()(k));
   }
 
   void initialize_tables(uint64_t n, uint32_t np, uint32_t rank, KeyT maxKey) {
@@ -107,21 +100,12 @@ class concurrent_unordered_map : public container {
     my_table = nullptr;
     pl = nullptr;
     assert(totalSize > 0 && totalSize < UINT64_MAX);
-    uint64_t localSize = totalSize / nservers;
-    uint64_t rem = totalSize % nservers;
-    if (serverid < rem)
-      maxSize = localSize + 1;
-    else
-      maxSize = localSize;
+    /* Each server's table holds one contiguous range of the positions. */
+    partition = partitioner(PARTITION_RANGE, nservers, 0, totalSize);
+    min_range = partition.range_begin(serverid);
+    max_range = partition.range_begin(serverid + 1);
+    maxSize = max_range - min_range;
     assert(maxSize > 0 && maxSize < UINT64_MAX);
-    min_range = 0;
-
-    if (serverid < rem)
-      min_range = serverid * (localSize + 1);
-    else
-      min_range = rem * (localSize + 1) + (serverid - rem) * localSize;
-
-    max_range = min_range + maxSize;
 
     if (is_server) {
       pl = new pool_type(100);
@@ -146,7 +130,6 @@ class concurrent_unordered_map : public container {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
 
-    auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
     switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
       case THALLIUM:
@@ -185,6 +168,18 @@ class concurrent_unordered_map : public container {
         break;
       }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+      case LOOPBACK: {
+        bind_loopback("_Insert", &concurrent_unordered_map::LocalInsert);
+        bind_loopback("_Find", &concurrent_unordered_map::LocalFind);
+        bind_loopback("_Erase", &concurrent_unordered_map::LocalErase);
+        bind_loopback("_Get", &concurrent_unordered_map::LocalGetValue);
+        bind_loopback("_Update", &concurrent_unordered_map::LocalUpdate);
+        break;
+      }
+#endif
+      default:
+        break;
     }
   }
 
@@ -207,6 +202,11 @@ class concurrent_unordered_map : public container {
       bind_functions();
     } else if (!is_server && server_on_node) {
     }
+    define_rpc_handle(insert_rpc, "_Insert");
+    define_rpc_handle(find_rpc, "_Find");
+    define_rpc_handle(erase_rpc, "_Erase");
+    define_rpc_handle(get_rpc, "_Get");
+    define_rpc_handle(update_rpc, "_Update");
   }
 
   map_type *data() {
@@ -296,6 +296,11 @@ class concurrent_unordered_map : public container {
   bool Erase(KeyT &k);
   ValueT Get(KeyT &k);
   bool Update(KeyT &k, ValueT &v);
+  RPCFuture<bool> AsyncInsert(KeyT &k, ValueT &v);
+  RPCFuture<bool> AsyncFind(KeyT &k);
+  RPCFuture<bool> AsyncErase(KeyT &k);
+  RPCFuture<ValueT> AsyncGet(KeyT &k);
+  RPCFuture<bool> AsyncUpdate(KeyT &k, ValueT &v);
 };
 
 #include "unordered_map.cpp"
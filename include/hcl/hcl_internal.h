@@ -5,12 +5,14 @@
 #include <hcl/hcl_config.hpp>
 /*Internal*/
 #include <hcl/common/logging.h>
+#include <hcl/common/node_segment.h>
 #include <hcl/common/profiler.h>
 #include <hcl/communication/rpc_lib.h>
 /*Standard*/
 #include <stdint.h>
 
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <unordered_map>
 
@@ -23,6 +25,8 @@ class HCL {
 
   // port. rpc
   std::unordered_map<uint16_t, std::shared_ptr<RPC>> rpcs;
+  std::mutex node_mutex;
+  std::shared_ptr<node_segment> node;
 
   static std::shared_ptr<HCL> instance;
 
@@ -72,6 +76,12 @@ class HCL {
                   CharStruct _backed_file_dir = "",
                   CharStruct _server_list_path = "", CharStruct _uri = "");
   std::shared_ptr<RPC> GetRPC(uint16_t server_port);
+  /**
+   * @return std::shared_ptr<node_segment>, the segment shared by the
+   * containers of this server, mapped on first use, or nullptr if
+   * NODE_SEGMENT_SIZE is 0.
+   */
+  std::shared_ptr<node_segment> GetNodeSegment();
 };
 
 }  // namespace hcl
@@ -26,12 +26,85 @@ bool map<KeyType, MappedType, Compare, Allocator, SharedType>::LocalPut(
     KeyType &key, MappedType &data) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
-  auto value = GetData<Allocator, MappedType, SharedType>(data);
-  mymap->insert_or_assign(key, value);
-  HCL_CPP_FUNCTION_UPDATE("access", "local");
-  return true;
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    auto value = GetData<Allocator, MappedType, SharedType>(data);
+    mymap->insert_or_assign(key, value);
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return true;
+  });
+}
+
+/**
+ * Put a batch of key/value pairs into the local map while holding the lock
+ * once.
+ * @param batch, the pairs to put in order
+ * @return bool, true if every Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+bool map<KeyType, MappedType, Compare, Allocator, SharedType>::LocalPutBatch(
+    std::vector<std::pair<KeyType, MappedType>> &batch) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t done = 0;
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    for (; done < batch.size(); ++done) {
+      auto &entry = batch[done];
+      auto value = GetData<Allocator, MappedType, SharedType>(entry.second);
+      mymap->insert_or_assign(entry.first, value);
+    }
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return true;
+  });
+}
+
+/**
+ * Sends the Puts buffered for one server as a single _PutBatch.
+ * @param server_index, server whose buffer is drained
+ * @return bool, true if every buffered Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+bool map<KeyType, MappedType, Compare, Allocator, SharedType>::flush_puts(
+    uint16_t server_index) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::lock_guard<std::mutex> sending(put_batch.sending(server_index));
+  auto batch = put_batch.take(server_index);
+  if (batch.empty()) return true;
+  HCL_CPP_FUNCTION_UPDATE("server", server_index);
+  return put_batch_rpc.call(server_index, batch);
+}
+
+/**
+ * Sends every buffered Put to its server.
+ * @return bool, true if every buffered Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+bool map<KeyType, MappedType, Compare, Allocator, SharedType>::Flush() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  bool success = true;
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    if (!flush_puts(i)) success = false;
+  }
+  return success;
+}
+
+/**
+ * Sends every buffered Put and reports failures of the background drain.
+ * @return bool, true if every Put since the last Quiesce was successful.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+bool map<KeyType, MappedType, Compare, Allocator, SharedType>::Quiesce() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  bool success = Flush();
+  return write_behind_succeeded() && success;
 }
 
 /**
@@ -47,14 +120,50 @@ bool map<KeyType, MappedType, Compare, Allocator, SharedType>::Put(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
+  uint16_t key_int = server_of(key_hash);
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalPut(key, data);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    return RPC_CALL_WRAPPER("_Put", key_int, bool, key, data);
+    if (put_batch.enabled()) {
+      HCL_CPP_FUNCTION_UPDATE("transfer", "batch");
+      if (!put_batch.add(key_int, std::pair<KeyType, MappedType>(key, data),
+                         [&key](const std::pair<KeyType, MappedType> &put) {
+                           return !Compare()(put.first, key) &&
+                                  !Compare()(key, put.first);
+                         }))
+        return true;
+      return flush_puts(key_int);
+    }
+    return put_rpc.call(key_int, key, data);
+  }
+}
+
+/**
+ * Put the data into the map without waiting for the remote server.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @return RPCFuture<bool>, handle that yields true once Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+RPCFuture<bool>
+map<KeyType, MappedType, Compare, Allocator, SharedType>::AsyncPut(
+    KeyType &key, MappedType &data) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<bool>(LocalPut(key, data));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_puts(key_int);
+    return put_rpc.async_call(key_int, key, data);
   }
 }
 
@@ -71,8 +180,7 @@ std::pair<bool, MappedType> map<KeyType, MappedType, Compare, Allocator,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   typename MyMap::iterator iterator = mymap->find(key);
   if (iterator != mymap->end()) {
     return std::pair<bool, MappedType>(true, iterator->second);
@@ -94,16 +202,111 @@ map<KeyType, MappedType, Compare, Allocator, SharedType>::Get(KeyType &key) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+  uint16_t key_int = server_of(key_hash);
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalGet(key);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Get", key_int, ret_type, key);
+    flush_puts(key_int);
+    return get_rpc.call(key_int, key);
+  }
+}
+
+/**
+ * Get the data in the map without waiting for the remote server.
+ * @param key, key to get
+ * @return RPCFuture of the pair returned by Get.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+RPCFuture<std::pair<bool, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType>::AsyncGet(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  typedef std::pair<bool, MappedType> ret_type;
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<ret_type>(LocalGet(key));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_puts(key_int);
+    return get_rpc.async_call(key_int, key);
+  }
+}
+
+/**
+ * Get a batch of keys from the local map while holding the lock once.
+ * @param keys, keys to get
+ * @return the pairs returned by LocalGet, in the order of keys.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+std::vector<std::pair<bool, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType>::LocalGetBatch(
+    std::vector<KeyType> &keys) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  HCL_CPP_FUNCTION_UPDATE("access", "local");
+  std::vector<std::pair<bool, MappedType>> values;
+  values.reserve(keys.size());
+  std::shared_lock<rw_lock> lock(*mutex);
+  for (auto &key : keys) {
+    typename MyMap::iterator iterator = mymap->find(key);
+    if (iterator != mymap->end()) {
+      values.emplace_back(true, iterator->second);
+    } else {
+      values.emplace_back(false, MappedType());
+    }
+  }
+  return values;
+}
+
+/**
+ * Get many keys with one _GetBatch per server. The requests to all servers
+ * are in flight at the same time.
+ * @param keys, keys to get
+ * @return the pairs returned by Get, in the order of keys.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+std::vector<std::pair<bool, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType>::GetBatch(
+    std::vector<KeyType> &keys) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  typedef std::vector<std::pair<bool, MappedType>> ret_type;
+  std::vector<std::vector<KeyType>> server_keys(num_servers);
+  std::vector<std::vector<size_t>> positions(num_servers);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    size_t key_hash = keyHash(keys[i]);
+    uint16_t key_int = server_of(key_hash);
+    server_keys[key_int].push_back(keys[i]);
+    positions[key_int].push_back(i);
+  }
+  std::vector<RPCFuture<ret_type>> replies(num_servers);
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    if (server_keys[i].empty()) continue;
+    if (is_local(i)) {
+      replies[i] = RPCFuture<ret_type>(LocalGetBatch(server_keys[i]));
+    } else {
+      flush_puts(i);
+      replies[i] = get_batch_rpc.async_call(i, server_keys[i]);
+    }
   }
+  ret_type values(keys.size());
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    if (!replies[i].valid()) continue;
+    auto server = replies[i].get();
+    for (size_t j = 0; j < server.size(); ++j)
+      values[positions[i][j]] = std::move(server[j]);
+  }
+  return values;
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
@@ -112,8 +315,7 @@ std::pair<bool, MappedType> map<KeyType, MappedType, Compare, Allocator,
                                 SharedType>::LocalErase(KeyType &key) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  std::unique_lock<rw_lock> lock(*mutex);
   size_t s = mymap->erase(key);
   HCL_CPP_FUNCTION_UPDATE("access", "local");
   return std::pair<bool, MappedType>(s > 0, MappedType());
@@ -126,15 +328,41 @@ map<KeyType, MappedType, Compare, Allocator, SharedType>::Erase(KeyType &key) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+  uint16_t key_int = server_of(key_hash);
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalErase(key);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
+    flush_puts(key_int);
+    return erase_rpc.call(key_int, key);
+  }
+}
+
+/**
+ * Erase the key from the map without waiting for the remote server.
+ * @param key, key to erase
+ * @return RPCFuture of the pair returned by Erase.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+RPCFuture<std::pair<bool, MappedType>>
+map<KeyType, MappedType, Compare, Allocator, SharedType>::AsyncErase(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  typedef std::pair<bool, MappedType> ret_type;
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<ret_type>(LocalErase(key));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_puts(key_int);
+    return erase_rpc.async_call(key_int, key);
   }
 }
 
@@ -152,23 +380,33 @@ map<KeyType, MappedType, Compare, Allocator, SharedType>::Contains(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   auto final_values = std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = ContainsInServer(key_start, key_end);
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server_idx) {
-      HCL_CPP_REGION(ContainsServer);
-      HCL_CPP_REGION_UPDATE(ContainsServer, "access", "remote");
-      HCL_CPP_REGION_UPDATE(ContainsServer, "server", i);
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server =
-          RPC_CALL_WRAPPER("_Contains", i, ret_type, key_start, key_end);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
-  }
+  Contains(
+      key_start, key_end,
+      [&final_values](std::vector<std::pair<KeyType, MappedType>> &values) {
+        final_values.insert(final_values.end(), values.begin(), values.end());
+      });
   return final_values;
 }
 
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+void map<KeyType, MappedType, Compare, Allocator, SharedType>::Contains(
+    KeyType &key_start, KeyType &key_end,
+    std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+        on_server) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  Flush();
+  scatter_gather<std::vector<std::pair<KeyType, MappedType>>>(
+      [&](uint16_t server) {
+        HCL_CPP_REGION(ContainsServer);
+        HCL_CPP_REGION_UPDATE(ContainsServer, "access", "remote");
+        HCL_CPP_REGION_UPDATE(ContainsServer, "server", server);
+        return contains_rpc.async_call(server, key_start, key_end);
+      },
+      [&]() { return ContainsInServer(key_start, key_end); }, on_server);
+}
+
 template <typename KeyType, typename MappedType, typename Compare,
           typename Allocator, typename SharedType>
 std::vector<std::pair<KeyType, MappedType>>
@@ -176,22 +414,31 @@ map<KeyType, MappedType, Compare, Allocator, SharedType>::GetAllData() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   auto final_values = std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = GetAllDataInServer();
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server_idx) {
-      HCL_CPP_REGION(GetAllDataServer);
-      HCL_CPP_REGION_UPDATE(GetAllDataServer, "access", "remote");
-      HCL_CPP_REGION_UPDATE(GetAllDataServer, "server", i);
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server = RPC_CALL_WRAPPER1("_GetAllData", i, ret_type);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
-  }
+  GetAllData(
+      [&final_values](std::vector<std::pair<KeyType, MappedType>> &values) {
+        final_values.insert(final_values.end(), values.begin(), values.end());
+      });
   return final_values;
 }
 
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+void map<KeyType, MappedType, Compare, Allocator, SharedType>::GetAllData(
+    std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+        on_server) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  Flush();
+  scatter_gather<std::vector<std::pair<KeyType, MappedType>>>(
+      [&](uint16_t server) {
+        HCL_CPP_REGION(GetAllDataServer);
+        HCL_CPP_REGION_UPDATE(GetAllDataServer, "access", "remote");
+        HCL_CPP_REGION_UPDATE(GetAllDataServer, "server", server);
+        return get_all_data_rpc.async_call(server);
+      },
+      [&]() { return GetAllDataInServer(); }, on_server);
+}
+
 template <typename KeyType, typename MappedType, typename Compare,
           typename Allocator, typename SharedType>
 std::vector<std::pair<KeyType, MappedType>>
@@ -202,8 +449,7 @@ map<KeyType, MappedType, Compare, Allocator, SharedType>::LocalContainsInServer(
   HCL_CPP_FUNCTION_UPDATE("access", "local");
   auto final_values = std::vector<std::pair<KeyType, MappedType>>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    std::shared_lock<rw_lock> lock(*mutex);
     typename MyMap::iterator lower_bound;
     size_t size = mymap->size();
     if (size == 0) {
@@ -244,12 +490,11 @@ map<KeyType, MappedType, Compare, Allocator, SharedType>::ContainsInServer(
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalContainsInServer(key_start, key_end);
   } else {
-    typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server_idx;
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", my_server_i);
-    return RPC_CALL_WRAPPER("_Contains", my_server_i, ret_type, key_start,
-                            key_end);
+    flush_puts(my_server_i);
+    return contains_rpc.call(my_server_i, key_start, key_end);
   }
 }
 
@@ -263,8 +508,7 @@ map<KeyType, MappedType, Compare, Allocator,
   HCL_CPP_FUNCTION_UPDATE("access", "local");
   auto final_values = std::vector<std::pair<KeyType, MappedType>>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    std::shared_lock<rw_lock> lock(*mutex);
     typename MyMap::iterator lower_bound;
     lower_bound = mymap->begin();
     while (lower_bound != mymap->end()) {
@@ -287,11 +531,11 @@ map<KeyType, MappedType, Compare, Allocator, SharedType>::GetAllDataInServer() {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalGetAllDataInServer();
   } else {
-    typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server_idx;
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", my_server_i);
-    return RPC_CALL_WRAPPER1("_GetAllData", my_server_i, ret_type);
+    flush_puts(my_server_i);
+    return get_all_data_rpc.call(my_server_i);
   }
 }
 
@@ -57,24 +57,51 @@ class map : public container {
  private:
   /** Class Typedefs for ease of use **/
   typedef std::pair<const KeyType, MappedType> ValueType;
-  typedef std::scoped_allocator_adaptor<boost::interprocess::allocator<
-      ValueType, boost::interprocess::managed_mapped_file::segment_manager>>
+  typedef std::scoped_allocator_adaptor<
+      node_allocator<Allocator, ValueType>>
       ShmemAllocator;
   typedef boost::interprocess::map<KeyType, MappedType, Compare, ShmemAllocator>
       MyMap;
   /** Class attributes**/
   MyMap *mymap;
   std::hash<KeyType> keyHash;
+  /** Remote procedures **/
+  rpc_handle<bool(KeyType, MappedType)> put_rpc;
+  rpc_handle<std::pair<bool, MappedType>(KeyType)> get_rpc;
+  rpc_handle<std::pair<bool, MappedType>(KeyType)> erase_rpc;
+  rpc_handle<std::vector<std::pair<KeyType, MappedType>>()> get_all_data_rpc;
+  rpc_handle<std::vector<std::pair<KeyType, MappedType>>(KeyType, KeyType)>
+      contains_rpc;
+  rpc_handle<bool(std::vector<std::pair<KeyType, MappedType>>)> put_batch_rpc;
+  rpc_handle<std::vector<std::pair<bool, MappedType>>(std::vector<KeyType>)>
+      get_batch_rpc;
+  /** Puts waiting to be sent to each server **/
+  request_batch<std::pair<KeyType, MappedType>> put_batch;
+  /** Last key moved by compaction **/
+  KeyType compact_cursor;
+
+  bool flush_puts(uint16_t server_index);
+  bool compact_slice(bool restart) override {
+    HCL_LOG_TRACE();
+    HCL_CPP_FUNCTION()
+    return compact_tree_slice(
+        *mymap, compact_cursor, restart,
+        [](const ValueType &entry) -> const KeyType & { return entry.first; });
+  }
 
  public:
-  ~map() { this->container::~container(); }
+  ~map() {
+    stop_compaction();
+    stop_write_behind();
+    Flush();
+  }
 
   void construct_shared_memory() override {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
-    ShmemAllocator alloc_inst(segment.get_segment_manager());
+    ShmemAllocator alloc_inst(allocator_of<ValueType, Allocator>());
     /* Construct map in the shared memory space. */
-    mymap = segment.construct<MyMap>(name.c_str())(Compare(), alloc_inst);
+    mymap = construct_named<MyMap>(name.c_str(), Compare(), alloc_inst);
   }
   void open_shared_memory() override {
     HCL_LOG_TRACE();
@@ -87,7 +114,6 @@ class map : public container {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
 
-    auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
     /* Create a RPC server and map the methods to it. */
     switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
@@ -117,15 +143,40 @@ class map : public container {
                                Compare>::ThalliumLocalContainsInServer,
                           this, std::placeholders::_1, std::placeholders::_2,
                           std::placeholders::_3));
+        std::function<void(const tl::request &,
+                           std::vector<std::pair<KeyType, MappedType>> &)>
+            putBatchFunc(std::bind(
+                &map<KeyType, MappedType, Compare>::ThalliumLocalPutBatch, this,
+                std::placeholders::_1, std::placeholders::_2));
+        std::function<void(const tl::request &, std::vector<KeyType> &)>
+            getBatchFunc(std::bind(
+                &map<KeyType, MappedType, Compare>::ThalliumLocalGetBatch, this,
+                std::placeholders::_1, std::placeholders::_2));
 
         rpc->bind(func_prefix + "_Put", putFunc);
         rpc->bind(func_prefix + "_Get", getFunc);
         rpc->bind(func_prefix + "_Erase", eraseFunc);
         rpc->bind(func_prefix + "_GetAllData", getAllDataInServerFunc);
         rpc->bind(func_prefix + "_Contains", containsInServerFunc);
+        rpc->bind(func_prefix + "_PutBatch", putBatchFunc);
+        rpc->bind(func_prefix + "_GetBatch", getBatchFunc);
+        break;
+      }
+#endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+      case LOOPBACK: {
+        bind_loopback("_Put", &map::LocalPut);
+        bind_loopback("_Get", &map::LocalGet);
+        bind_loopback("_Erase", &map::LocalErase);
+        bind_loopback("_GetAllData", &map::LocalGetAllDataInServer);
+        bind_loopback("_Contains", &map::LocalContainsInServer);
+        bind_loopback("_PutBatch", &map::LocalPutBatch);
+        bind_loopback("_GetBatch", &map::LocalGetBatch);
         break;
       }
 #endif
+      default:
+        break;
     }
   }
 
@@ -139,15 +190,32 @@ class map : public container {
                CharStruct _backed_file_dir = HCL_CONF->BACKED_FILE_DIR)
       : container(name_, port, _num_servers, _my_server_idx, _memory_allocated,
                   _is_server, _is_server_on_node, _backed_file_dir),
-        mymap() {
+        mymap(),
+        compact_cursor() {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
     if (is_server) {
-      construct_shared_memory();
+      if (attach_type(typeid(*this).name()))
+        open_shared_memory();
+      else
+        construct_shared_memory();
       bind_functions();
+      start_compaction(HCL_CONF->COMPACTION_INTERVAL_MS);
     } else if (!is_server && server_on_node) {
       open_shared_memory();
     }
+    define_rpc_handle(put_rpc, "_Put");
+    define_rpc_handle(get_rpc, "_Get");
+    define_rpc_handle(erase_rpc, "_Erase");
+    define_rpc_handle(get_all_data_rpc, "_GetAllData");
+    define_rpc_handle(contains_rpc, "_Contains");
+    define_rpc_handle(put_batch_rpc, "_PutBatch");
+    define_rpc_handle(get_batch_rpc, "_GetBatch");
+    put_batch.configure(num_servers, HCL_CONF->BATCH_SIZE,
+                        HCL_CONF->BATCH_WINDOW_MS, HCL_CONF->WRITE_BEHIND);
+    if (put_batch.timed())
+      start_write_behind(HCL_CONF->BATCH_WINDOW_MS,
+                         [this]() { return Flush(); });
   }
 
   MyMap *data() {
@@ -156,7 +224,7 @@ class map : public container {
     if (server_on_node || is_server)
       return mymap;
     else
-      nullptr;
+      return nullptr;
   }
 
   bool LocalPut(KeyType &key, MappedType &data);
@@ -170,6 +238,11 @@ class map : public container {
   std::vector<std::pair<KeyType, MappedType>> LocalContainsInServer(
       KeyType &key_start, KeyType &key_end);
 
+  bool LocalPutBatch(std::vector<std::pair<KeyType, MappedType>> &batch);
+
+  std::vector<std::pair<bool, MappedType>> LocalGetBatch(
+      std::vector<KeyType> &keys);
+
 #if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
   THALLIUM_DEFINE(LocalPut, (key, data), KeyType &key, MappedType &data)
   THALLIUM_DEFINE(LocalGet, (key), KeyType &key)
@@ -177,6 +250,9 @@ class map : public container {
   THALLIUM_DEFINE(LocalContainsInServer, (key_start, key_end),
                   KeyType &key_start, KeyType &key_end)
   THALLIUM_DEFINE1(LocalGetAllDataInServer)
+  THALLIUM_DEFINE(LocalPutBatch, (batch),
+                  std::vector<std::pair<KeyType, MappedType>> &batch)
+  THALLIUM_DEFINE(LocalGetBatch, (keys), std::vector<KeyType> &keys)
 #endif
 
   bool Put(KeyType &key, MappedType &data);
@@ -185,10 +261,42 @@ class map : public container {
 
   std::pair<bool, MappedType> Erase(KeyType &key);
 
+  RPCFuture<bool> AsyncPut(KeyType &key, MappedType &data);
+
+  RPCFuture<std::pair<bool, MappedType>> AsyncGet(KeyType &key);
+
+  RPCFuture<std::pair<bool, MappedType>> AsyncErase(KeyType &key);
+
+  std::vector<std::pair<bool, MappedType>> GetBatch(
+      std::vector<KeyType> &keys);
+
+  bool Flush();
+  /**
+   * Durability barrier for write-behind mode: sends every buffered Put and
+   * waits for the servers.
+   * @return bool, false if this or an earlier background send failed.
+   */
+  bool Quiesce();
+
   std::vector<std::pair<KeyType, MappedType>> Contains(KeyType &key_start,
                                                        KeyType &key_end);
+  /**
+   * Streams the result: on_server is called once for each server, local
+   * part first and then as the concurrent requests complete.
+   */
+  void Contains(
+      KeyType &key_start, KeyType &key_end,
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          on_server);
 
   std::vector<std::pair<KeyType, MappedType>> GetAllData();
+  /**
+   * Streams the result: on_server is called once for each server, local
+   * part first and then as the concurrent requests complete.
+   */
+  void GetAllData(
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          on_server);
 
   std::vector<std::pair<KeyType, MappedType>> ContainsInServer(
       KeyType &key_start, KeyType &key_end);
@@ -17,7 +17,7 @@
 template <typename KeyType, typename MappedType, typename Compare,
           typename Allocator, typename SharedType>
 multimap<KeyType, MappedType, Compare, Allocator, SharedType>::~multimap() {
-  this->container::~container();
+  stop_compaction();
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
@@ -28,15 +28,42 @@ multimap<KeyType, MappedType, Compare, Allocator, SharedType>::multimap(
     bool _is_server_on_node, CharStruct _backed_file_dir)
     : container(name_, port, _num_servers, _my_server_idx, _memory_allocated,
                 _is_server, _is_server_on_node, _backed_file_dir),
-      mymap() {
+      mymap(),
+      compact_cursor() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   if (is_server) {
-    construct_shared_memory();
+    if (attach_type(typeid(*this).name()))
+      open_shared_memory();
+    else
+      construct_shared_memory();
     bind_functions();
+    start_compaction(HCL_CONF->COMPACTION_INTERVAL_MS);
   } else if (!is_server && server_on_node) {
     open_shared_memory();
   }
+  define_rpc_handle(put_rpc, "_Put");
+  define_rpc_handle(get_rpc, "_Get");
+  define_rpc_handle(erase_rpc, "_Erase");
+  define_rpc_handle(get_all_data_rpc, "_GetAllData");
+  define_rpc_handle(contains_rpc, "_Contains");
+}
+
+/**
+ * Moves the next COMPACTION_SLICE entries of the local multimap, together
+ * with the rest of the entries of the last key, to new memory.
+ * @param restart, start over from the first key
+ * @return bool, true if entries remain.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+bool multimap<KeyType, MappedType, Compare, Allocator,
+              SharedType>::compact_slice(bool restart) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  return compact_tree_slice(
+      *mymap, compact_cursor, restart,
+      [](const ValueType &entry) -> const KeyType & { return entry.first; });
 }
 
 /**
@@ -52,15 +79,16 @@ bool multimap<KeyType, MappedType, Compare, Allocator, SharedType>::LocalPut(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
-  typename MyMap::iterator iterator = mymap->find(key);
-  if (iterator != mymap->end()) {
-    mymap->erase(iterator);
-  }
-  auto value = GetData<Allocator, MappedType, SharedType>(data);
-  mymap->insert(std::pair<KeyType, MappedType>(key, value));
-  return true;
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    typename MyMap::iterator iterator = mymap->find(key);
+    if (iterator != mymap->end()) {
+      mymap->erase(iterator);
+    }
+    auto value = GetData<Allocator, MappedType, SharedType>(data);
+    mymap->insert(std::pair<KeyType, MappedType>(key, value));
+    return true;
+  });
 }
 
 /**
@@ -77,14 +105,39 @@ bool multimap<KeyType, MappedType, Compare, Allocator, SharedType>::Put(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
+  uint16_t key_int = server_of(key_hash);
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalPut(key, data);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    return RPC_CALL_WRAPPER("_Put", key_int, bool, key, data);
+    return put_rpc.call(key_int, key, data);
+  }
+}
+
+/**
+ * Put the data into the multimap without waiting for the remote server.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @return RPCFuture<bool>, handle that yields true once Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+RPCFuture<bool>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType>::AsyncPut(
+    KeyType &key, MappedType &data) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<bool>(LocalPut(key, data));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    return put_rpc.async_call(key_int, key, data);
   }
 }
 
@@ -101,8 +154,7 @@ std::pair<bool, MappedType> multimap<KeyType, MappedType, Compare, Allocator,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   typename MyMap::iterator iterator = mymap->find(key);
   if (iterator != mymap->end()) {
     return std::pair<bool, MappedType>(true, iterator->second);
@@ -125,15 +177,39 @@ std::pair<bool, MappedType> multimap<KeyType, MappedType, Compare, Allocator,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+  uint16_t key_int = server_of(key_hash);
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalGet(key);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Get", key_int, ret_type, key);
+    return get_rpc.call(key_int, key);
+  }
+}
+
+/**
+ * Get the data in the multimap without waiting for the remote server.
+ * @param key, key to get
+ * @return RPCFuture of the pair returned by Get.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+RPCFuture<std::pair<bool, MappedType>>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType>::AsyncGet(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  typedef std::pair<bool, MappedType> ret_type;
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<ret_type>(LocalGet(key));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    return get_rpc.async_call(key_int, key);
   }
 }
 
@@ -143,8 +219,7 @@ std::pair<bool, MappedType> multimap<KeyType, MappedType, Compare, Allocator,
                                      SharedType>::LocalErase(KeyType &key) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  std::unique_lock<rw_lock> lock(*mutex);
   size_t s = mymap->erase(key);
   return std::pair<bool, MappedType>(s > 0, MappedType());
 }
@@ -156,15 +231,39 @@ std::pair<bool, MappedType> multimap<KeyType, MappedType, Compare, Allocator,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+  uint16_t key_int = server_of(key_hash);
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalErase(key);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
+    return erase_rpc.call(key_int, key);
+  }
+}
+
+/**
+ * Erase the key from the multimap without waiting for the remote server.
+ * @param key, key to erase
+ * @return RPCFuture of the pair returned by Erase.
+ */
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+RPCFuture<std::pair<bool, MappedType>>
+multimap<KeyType, MappedType, Compare, Allocator, SharedType>::AsyncErase(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  typedef std::pair<bool, MappedType> ret_type;
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<ret_type>(LocalErase(key));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    return erase_rpc.async_call(key_int, key);
   }
 }
 
@@ -184,22 +283,32 @@ multimap<KeyType, MappedType, Compare, Allocator, SharedType>::Contains(
   HCL_CPP_FUNCTION()
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = ContainsInServer(key);
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server_idx) {
-      HCL_CPP_REGION(ContainsServer);
-      HCL_CPP_REGION_UPDATE(ContainsServer, "access", "remote");
-      HCL_CPP_REGION_UPDATE(ContainsServer, "server", i);
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server = RPC_CALL_WRAPPER("_Contains", i, ret_type, key);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
-  }
+  Contains(
+      key,
+      [&final_values](std::vector<std::pair<KeyType, MappedType>> &values) {
+        final_values.insert(final_values.end(), values.begin(), values.end());
+      });
   return final_values;
 }
 
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+void multimap<KeyType, MappedType, Compare, Allocator, SharedType>::Contains(
+    KeyType &key,
+    std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+        on_server) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  scatter_gather<std::vector<std::pair<KeyType, MappedType>>>(
+      [&](uint16_t server) {
+        HCL_CPP_REGION(ContainsServer);
+        HCL_CPP_REGION_UPDATE(ContainsServer, "access", "remote");
+        HCL_CPP_REGION_UPDATE(ContainsServer, "server", server);
+        return contains_rpc.async_call(server, key);
+      },
+      [&]() { return ContainsInServer(key); }, on_server);
+}
+
 template <typename KeyType, typename MappedType, typename Compare,
           typename Allocator, typename SharedType>
 std::vector<std::pair<KeyType, MappedType>>
@@ -208,22 +317,31 @@ multimap<KeyType, MappedType, Compare, Allocator, SharedType>::GetAllData() {
   HCL_CPP_FUNCTION()
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = GetAllDataInServer();
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server_idx) {
-      HCL_CPP_REGION(ContainsGetAllData);
-      HCL_CPP_REGION_UPDATE(ContainsGetAllData, "access", "remote");
-      HCL_CPP_REGION_UPDATE(ContainsGetAllData, "server", i);
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server = RPC_CALL_WRAPPER1("_GetAllData", i, ret_type);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
-  }
+  GetAllData(
+      [&final_values](std::vector<std::pair<KeyType, MappedType>> &values) {
+        final_values.insert(final_values.end(), values.begin(), values.end());
+      });
   return final_values;
 }
 
+template <typename KeyType, typename MappedType, typename Compare,
+          typename Allocator, typename SharedType>
+void multimap<KeyType, MappedType, Compare, Allocator,
+              SharedType>::GetAllData(
+    std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+        on_server) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  scatter_gather<std::vector<std::pair<KeyType, MappedType>>>(
+      [&](uint16_t server) {
+        HCL_CPP_REGION(ContainsGetAllData);
+        HCL_CPP_REGION_UPDATE(ContainsGetAllData, "access", "remote");
+        HCL_CPP_REGION_UPDATE(ContainsGetAllData, "server", server);
+        return get_all_data_rpc.async_call(server);
+      },
+      [&]() { return GetAllDataInServer(); }, on_server);
+}
+
 template <typename KeyType, typename MappedType, typename Compare,
           typename Allocator, typename SharedType>
 std::vector<std::pair<KeyType, MappedType>>
@@ -235,8 +353,7 @@ multimap<KeyType, MappedType, Compare, Allocator,
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    std::shared_lock<rw_lock> lock(*mutex);
     typename MyMap::iterator lower_bound;
     size_t size = mymap->size();
     if (size == 0) {
@@ -277,11 +394,10 @@ multimap<KeyType, MappedType, Compare, Allocator, SharedType>::ContainsInServer(
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalContainsInServer(key);
   } else {
-    typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server_idx;
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", my_server_i);
-    return RPC_CALL_WRAPPER("_Contains", my_server_i, ret_type, key);
+    return contains_rpc.call(my_server_i, key);
   }
 }
 
@@ -296,8 +412,7 @@ multimap<KeyType, MappedType, Compare, Allocator,
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    std::shared_lock<rw_lock> lock(*mutex);
     typename MyMap::iterator lower_bound;
     lower_bound = mymap->begin();
     while (lower_bound != mymap->end()) {
@@ -320,11 +435,10 @@ std::vector<std::pair<KeyType, MappedType>> multimap<
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalGetAllDataInServer();
   } else {
-    typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server_idx;
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", my_server_i);
-    return RPC_CALL_WRAPPER1("_GetAllData", my_server_i, ret_type);
+    return get_all_data_rpc.call(my_server_i);
   }
 }
 
@@ -334,9 +448,9 @@ void multimap<KeyType, MappedType, Compare, Allocator,
               SharedType>::construct_shared_memory() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  ShmemAllocator alloc_inst(segment.get_segment_manager());
+  ShmemAllocator alloc_inst(allocator_of<ValueType, Allocator>());
   /* Construct Multimap in the shared memory space. */
-  mymap = segment.construct<MyMap>(name.c_str())(Compare(), alloc_inst);
+  mymap = construct_named<MyMap>(name.c_str(), Compare(), alloc_inst);
 }
 
 template <typename KeyType, typename MappedType, typename Compare,
@@ -357,7 +471,6 @@ void multimap<KeyType, MappedType, Compare, Allocator,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
 
-  auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
   /* Create a RPC server and map the methods to it. */
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
@@ -396,6 +509,18 @@ void multimap<KeyType, MappedType, Compare, Allocator,
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      bind_loopback("_Put", &multimap::LocalPut);
+      bind_loopback("_Get", &multimap::LocalGet);
+      bind_loopback("_Erase", &multimap::LocalErase);
+      bind_loopback("_GetAllData", &multimap::LocalGetAllDataInServer);
+      bind_loopback("_Contains", &multimap::LocalContainsInServer);
+      break;
+    }
+#endif
+    default:
+      break;
   }
 }
 
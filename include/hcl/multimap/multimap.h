@@ -54,8 +54,8 @@ class multimap : public container {
  private:
   /** Class Typedefs for ease of use **/
   typedef std::pair<const KeyType, MappedType> ValueType;
-  typedef std::scoped_allocator_adaptor<boost::interprocess::allocator<
-      ValueType, boost::interprocess::managed_mapped_file::segment_manager>>
+  typedef std::scoped_allocator_adaptor<
+      node_allocator<Allocator, ValueType>>
       ShmemAllocator;
   typedef boost::interprocess::multimap<KeyType, MappedType, Compare,
                                         ShmemAllocator>
@@ -63,6 +63,17 @@ class multimap : public container {
   /** Class attributes**/
   std::hash<KeyType> keyHash;
   MyMap *mymap;
+  /** Remote procedures **/
+  rpc_handle<bool(KeyType, MappedType)> put_rpc;
+  rpc_handle<std::pair<bool, MappedType>(KeyType)> get_rpc;
+  rpc_handle<std::pair<bool, MappedType>(KeyType)> erase_rpc;
+  rpc_handle<std::vector<std::pair<KeyType, MappedType>>()> get_all_data_rpc;
+  rpc_handle<std::vector<std::pair<KeyType, MappedType>>(KeyType)>
+      contains_rpc;
+  /** Last key moved by compaction **/
+  KeyType compact_cursor;
+
+  bool compact_slice(bool restart) override;
 
  public:
   /* Constructor to deallocate the shared memory*/
@@ -81,7 +92,7 @@ class multimap : public container {
     if (server_on_node || is_server)
       return mymap;
     else
-      nullptr;
+      return nullptr;
   }
   explicit multimap(CharStruct name_ = "TEST_MULTIMAP",
                     uint16_t port = HCL_CONF->RPC_PORT,
@@ -111,9 +122,27 @@ class multimap : public container {
   std::pair<bool, MappedType> Get(KeyType &key);
 
   std::pair<bool, MappedType> Erase(KeyType &key);
+  RPCFuture<bool> AsyncPut(KeyType &key, MappedType &data);
+  RPCFuture<std::pair<bool, MappedType>> AsyncGet(KeyType &key);
+  RPCFuture<std::pair<bool, MappedType>> AsyncErase(KeyType &key);
   std::vector<std::pair<KeyType, MappedType>> Contains(KeyType &key);
+  /**
+   * Streams the result: on_server is called once for each server, local
+   * part first and then as the concurrent requests complete.
+   */
+  void Contains(
+      KeyType &key,
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          on_server);
 
   std::vector<std::pair<KeyType, MappedType>> GetAllData();
+  /**
+   * Streams the result: on_server is called once for each server, local
+   * part first and then as the concurrent requests complete.
+   */
+  void GetAllData(
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          on_server);
 
   std::vector<std::pair<KeyType, MappedType>> ContainsInServer(KeyType &key);
   std::vector<std::pair<KeyType, MappedType>> GetAllDataInServer();
@@ -16,9 +16,7 @@
 /* Constructor to deallocate the shared memory*/
 template <typename MappedType, typename Compare, typename Allocator,
           typename SharedType>
-priority_queue<MappedType, Compare, Allocator, SharedType>::~priority_queue() {
-  this->container::~container();
-}
+priority_queue<MappedType, Compare, Allocator, SharedType>::~priority_queue() {}
 
 template <typename MappedType, typename Compare, typename Allocator,
           typename SharedType>
@@ -32,11 +30,18 @@ priority_queue<MappedType, Compare, Allocator, SharedType>::priority_queue(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   if (is_server) {
-    construct_shared_memory();
+    if (attach_type(typeid(*this).name()))
+      open_shared_memory();
+    else
+      construct_shared_memory();
     bind_functions();
   } else if (!is_server && server_on_node) {
     open_shared_memory();
   }
+  define_rpc_handle(push_rpc, "_Push");
+  define_rpc_handle(pop_rpc, "_Pop");
+  define_rpc_handle(top_rpc, "_Top");
+  define_rpc_handle(size_rpc, "_Size");
 }
 
 /**
@@ -52,10 +57,12 @@ bool priority_queue<MappedType, Compare, Allocator, SharedType>::LocalPush(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
-  auto value = GetData<Allocator, MappedType, SharedType>(data);
-  queue->push(value);
-  return true;
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    auto value = GetData<Allocator, MappedType, SharedType>(data);
+    queue->push(value);
+    return true;
+  });
 }
 
 /**
@@ -77,7 +84,30 @@ bool priority_queue<MappedType, Compare, Allocator, SharedType>::Push(
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    return RPC_CALL_WRAPPER("_Push", key_int, bool, data);
+    return push_rpc.call(key_int, data);
+  }
+}
+
+/**
+ * Push the data into the priority queue without waiting for the remote server.
+ * @param data, the value for push
+ * @param key_int, key_int to know which server
+ * @return RPCFuture<bool>, handle that yields true once Push was successful.
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+RPCFuture<bool>
+priority_queue<MappedType, Compare, Allocator, SharedType>::AsyncPush(
+    MappedType &data, uint16_t &key_int) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<bool>(LocalPush(data));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    return push_rpc.async_call(key_int, data);
   }
 }
 
@@ -94,7 +124,7 @@ priority_queue<MappedType, Compare, Allocator, SharedType>::LocalPop() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::unique_lock<rw_lock> lock(*mutex);
   if (queue->size() > 0) {
     MappedType value = queue->top();
     queue->pop();
@@ -122,8 +152,30 @@ std::pair<bool, MappedType> priority_queue<MappedType, Compare, Allocator,
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER1("_Pop", key_int, ret_type);
+    return pop_rpc.call(key_int);
+  }
+}
+
+/**
+ * Pop the data from the priority queue without waiting for the remote server.
+ * @param key_int, key_int to know which server
+ * @return RPCFuture of the pair returned by Pop.
+ */
+template <typename MappedType, typename Compare, typename Allocator,
+          typename SharedType>
+RPCFuture<std::pair<bool, MappedType>>
+priority_queue<MappedType, Compare, Allocator, SharedType>::AsyncPop(
+    uint16_t &key_int) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  typedef std::pair<bool, MappedType> ret_type;
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<ret_type>(LocalPop());
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    return pop_rpc.async_call(key_int);
   }
 }
 
@@ -140,7 +192,7 @@ priority_queue<MappedType, Compare, Allocator, SharedType>::LocalTop() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   if (queue->size() > 0) {
     MappedType value = queue->top();
     return std::pair<bool, MappedType>(true, value);
@@ -168,8 +220,7 @@ std::pair<bool, MappedType> priority_queue<MappedType, Compare, Allocator,
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER1("_Top", key_int, ret_type);
+    return top_rpc.call(key_int);
   }
 }
 
@@ -184,7 +235,7 @@ size_t priority_queue<MappedType, Compare, Allocator, SharedType>::LocalSize() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   size_t value = queue->size();
   return value;
 }
@@ -204,7 +255,7 @@ size_t priority_queue<MappedType, Compare, Allocator, SharedType>::Size(
   } else {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
-    return RPC_CALL_WRAPPER1("_Size", key_int, size_t);
+    return size_rpc.call(key_int);
   }
 }
 
@@ -215,9 +266,9 @@ void priority_queue<MappedType, Compare, Allocator,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  ShmemAllocator alloc_inst(segment.get_segment_manager());
+  ShmemAllocator alloc_inst(allocator_of<MappedType, Allocator>());
   /* Construct priority queue in the shared memory space. */
-  queue = segment.construct<Queue>("Queue")(Compare(), alloc_inst);
+  queue = construct_named<Queue>("Queue", Compare(), alloc_inst);
 }
 
 template <typename MappedType, typename Compare, typename Allocator,
@@ -240,7 +291,6 @@ void priority_queue<MappedType, Compare, Allocator,
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
 
-  auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
   /* Create a RPC server and map the methods to it. */
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
@@ -267,6 +317,17 @@ void priority_queue<MappedType, Compare, Allocator,
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      bind_loopback("_Push", &priority_queue::LocalPush);
+      bind_loopback("_Pop", &priority_queue::LocalPop);
+      bind_loopback("_Top", &priority_queue::LocalTop);
+      bind_loopback("_Size", &priority_queue::LocalSize);
+      break;
+    }
+#endif
+    default:
+      break;
   }
 }
 
@@ -59,7 +59,7 @@ class priority_queue : public container {
  private:
   /** Class Typedefs for ease of use **/
   typedef std::scoped_allocator_adaptor<
-      bip::allocator<MappedType, bip::managed_mapped_file::segment_manager>>
+      node_allocator<Allocator, MappedType>>
       ShmemAllocator;
   typedef std::priority_queue<MappedType,
                               std::vector<MappedType, ShmemAllocator>, Compare>
@@ -67,6 +67,11 @@ class priority_queue : public container {
 
   /** Class attributes**/
   Queue *queue;
+  /** Remote procedures **/
+  rpc_handle<bool(MappedType)> push_rpc;
+  rpc_handle<std::pair<bool, MappedType>()> pop_rpc;
+  rpc_handle<std::pair<bool, MappedType>()> top_rpc;
+  rpc_handle<size_t()> size_rpc;
 
  public:
   ~priority_queue();
@@ -93,7 +98,7 @@ class priority_queue : public container {
     if (server_on_node || is_server)
       return queue;
     else
-      nullptr;
+      return nullptr;
   }
   bool LocalPush(MappedType &data);
   std::pair<bool, MappedType> LocalPop();
@@ -109,6 +114,8 @@ class priority_queue : public container {
 
   bool Push(MappedType &data, uint16_t &key_int);
   std::pair<bool, MappedType> Pop(uint16_t &key_int);
+  RPCFuture<bool> AsyncPush(MappedType &data, uint16_t &key_int);
+  RPCFuture<std::pair<bool, MappedType>> AsyncPop(uint16_t &key_int);
   std::pair<bool, MappedType> Top(uint16_t &key_int);
   size_t Size(uint16_t &key_int);
 };
@@ -12,7 +12,8 @@
 
 template <typename MappedType, typename Allocator, typename SharedType>
 queue<MappedType, Allocator, SharedType>::~queue() {
-  this->container::~container();
+  stop_write_behind();
+  Flush();
 }
 template <typename MappedType, typename Allocator, typename SharedType>
 queue<MappedType, Allocator, SharedType>::queue(
@@ -25,11 +26,24 @@ queue<MappedType, Allocator, SharedType>::queue(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   if (is_server) {
-    construct_shared_memory();
+    if (attach_type(typeid(*this).name()))
+      open_shared_memory();
+    else
+      construct_shared_memory();
     bind_functions();
   } else if (!is_server && server_on_node) {
     open_shared_memory();
   }
+  define_rpc_handle(push_rpc, "_Push");
+  define_rpc_handle(pop_rpc, "_Pop");
+  define_rpc_handle(wait_for_element_rpc, "_WaitForElement");
+  define_rpc_handle(size_rpc, "_Size");
+  define_rpc_handle(push_batch_rpc, "_PushBatch");
+  push_batch.configure(num_servers, HCL_CONF->BATCH_SIZE,
+                       HCL_CONF->BATCH_WINDOW_MS, HCL_CONF->WRITE_BEHIND);
+  if (push_batch.timed())
+    start_write_behind(HCL_CONF->BATCH_WINDOW_MS,
+                       [this]() { return Flush(); });
 }
 
 /**
@@ -43,10 +57,79 @@ bool queue<MappedType, Allocator, SharedType>::LocalPush(MappedType &data) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
-  auto value = GetData<Allocator, MappedType, SharedType>(data);
-  my_queue->push_back(std::move(value));
-  return true;
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    auto value = GetData<Allocator, MappedType, SharedType>(data);
+    my_queue->push_back(std::move(value));
+    return true;
+  });
+}
+
+/**
+ * Push a batch of values into the local queue while holding the lock once.
+ * @param batch, the values to push in order
+ * @return bool, true if every Push was successful.
+ */
+template <typename MappedType, typename Allocator, typename SharedType>
+bool queue<MappedType, Allocator, SharedType>::LocalPushBatch(
+    std::vector<MappedType> &batch) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  HCL_CPP_FUNCTION_UPDATE("access", "local");
+  size_t done = 0;
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    for (; done < batch.size(); ++done) {
+      auto &data = batch[done];
+      auto value = GetData<Allocator, MappedType, SharedType>(data);
+      my_queue->push_back(std::move(value));
+    }
+    return true;
+  });
+}
+
+/**
+ * Sends the Pushes buffered for one server as a single _PushBatch.
+ * @param server_index, server whose buffer is drained
+ * @return bool, true if every buffered Push was successful.
+ */
+template <typename MappedType, typename Allocator, typename SharedType>
+bool queue<MappedType, Allocator, SharedType>::flush_pushes(
+    uint16_t server_index) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::lock_guard<std::mutex> sending(push_batch.sending(server_index));
+  auto batch = push_batch.take(server_index);
+  if (batch.empty()) return true;
+  HCL_CPP_FUNCTION_UPDATE("server", server_index);
+  return push_batch_rpc.call(server_index, batch);
+}
+
+/**
+ * Sends every buffered Push to its server.
+ * @return bool, true if every buffered Push was successful.
+ */
+template <typename MappedType, typename Allocator, typename SharedType>
+bool queue<MappedType, Allocator, SharedType>::Flush() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  bool success = true;
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    if (!flush_pushes(i)) success = false;
+  }
+  return success;
+}
+
+/**
+ * Sends every buffered Push and reports failures of the background drain.
+ * @return bool, true if every Push since the last Quiesce was successful.
+ */
+template <typename MappedType, typename Allocator, typename SharedType>
+bool queue<MappedType, Allocator, SharedType>::Quiesce() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  bool success = Flush();
+  return write_behind_succeeded() && success;
 }
 
 /**
@@ -66,7 +149,34 @@ bool queue<MappedType, Allocator, SharedType>::Push(MappedType &data,
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    return RPC_CALL_WRAPPER("_Push", key_int, bool, data);
+    if (push_batch.enabled()) {
+      HCL_CPP_FUNCTION_UPDATE("transfer", "batch");
+      if (!push_batch.add(key_int, MappedType(data))) return true;
+      return flush_pushes(key_int);
+    }
+    return push_rpc.call(key_int, data);
+  }
+}
+
+/**
+ * Push the data into the queue without waiting for the remote server.
+ * @param data, the value for push
+ * @param key_int, key_int to know which server
+ * @return RPCFuture<bool>, handle that yields true once Push was successful.
+ */
+template <typename MappedType, typename Allocator, typename SharedType>
+RPCFuture<bool> queue<MappedType, Allocator, SharedType>::AsyncPush(
+    MappedType &data, uint16_t &key_int) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<bool>(LocalPush(data));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_pushes(key_int);
+    return push_rpc.async_call(key_int, data);
   }
 }
 
@@ -82,7 +192,7 @@ queue<MappedType, Allocator, SharedType>::LocalPop() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::unique_lock<rw_lock> lock(*mutex);
   if (my_queue->size() > 0) {
     MappedType value = my_queue->front();
     my_queue->pop_front();
@@ -109,8 +219,30 @@ std::pair<bool, MappedType> queue<MappedType, Allocator, SharedType>::Pop(
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER1("_Pop", key_int, ret_type);
+    flush_pushes(key_int);
+    return pop_rpc.call(key_int);
+  }
+}
+
+/**
+ * Pop the data from the queue without waiting for the remote server.
+ * @param key_int, key_int to know which server
+ * @return RPCFuture of the pair returned by Pop.
+ */
+template <typename MappedType, typename Allocator, typename SharedType>
+RPCFuture<std::pair<bool, MappedType>>
+queue<MappedType, Allocator, SharedType>::AsyncPop(uint16_t &key_int) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  typedef std::pair<bool, MappedType> ret_type;
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<ret_type>(LocalPop());
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_pushes(key_int);
+    return pop_rpc.async_call(key_int);
   }
 }
 
@@ -137,7 +269,8 @@ bool queue<MappedType, Allocator, SharedType>::WaitForElement(
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    return RPC_CALL_WRAPPER1("_WaitForElement", key_int, bool);
+    flush_pushes(key_int);
+    return wait_for_element_rpc.call(key_int);
   }
 }
 
@@ -150,7 +283,7 @@ template <typename MappedType, typename Allocator, typename SharedType>
 size_t queue<MappedType, Allocator, SharedType>::LocalSize() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   size_t value = my_queue->size();
   return value;
 }
@@ -170,7 +303,8 @@ size_t queue<MappedType, Allocator, SharedType>::Size(uint16_t &key_int) {
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    return RPC_CALL_WRAPPER1("_Size", key_int, size_t);
+    flush_pushes(key_int);
+    return size_rpc.call(key_int);
   }
 }
 
@@ -179,9 +313,9 @@ void queue<MappedType, Allocator, SharedType>::construct_shared_memory() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  ShmemAllocator alloc_inst(segment.get_segment_manager());
+  ShmemAllocator alloc_inst(allocator_of<MappedType, Allocator>());
   /* Construct queue in the shared memory space. */
-  my_queue = segment.construct<Queue>("Queue")(alloc_inst);
+  my_queue = construct_named<Queue>("Queue", alloc_inst);
 }
 
 template <typename MappedType, typename Allocator, typename SharedType>
@@ -199,7 +333,6 @@ void queue<MappedType, Allocator, SharedType>::bind_functions() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
   /* Create a RPC server and map the methods to it. */
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
@@ -220,13 +353,31 @@ void queue<MappedType, Allocator, SharedType>::bind_functions() {
           std::bind(&hcl::queue<MappedType, Allocator,
                                 SharedType>::ThalliumLocalWaitForElement,
                     this, std::placeholders::_1));
+      std::function<void(const tl::request &, std::vector<MappedType> &)>
+          pushBatchFunc(std::bind(
+              &hcl::queue<MappedType, Allocator,
+                          SharedType>::ThalliumLocalPushBatch,
+              this, std::placeholders::_1, std::placeholders::_2));
       rpc->bind(func_prefix + "_Push", pushFunc);
       rpc->bind(func_prefix + "_Pop", popFunc);
       rpc->bind(func_prefix + "_WaitForElement", waitForElementFunc);
       rpc->bind(func_prefix + "_Size", sizeFunc);
+      rpc->bind(func_prefix + "_PushBatch", pushBatchFunc);
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      bind_loopback("_Push", &queue::LocalPush);
+      bind_loopback("_Pop", &queue::LocalPop);
+      bind_loopback("_WaitForElement", &queue::LocalWaitForElement);
+      bind_loopback("_Size", &queue::LocalSize);
+      bind_loopback("_PushBatch", &queue::LocalPushBatch);
+      break;
+    }
+#endif
+    default:
+      break;
   }
 }
 // template class queue<int>;
@@ -55,12 +55,22 @@ class queue : public container {
  private:
   /** Class Typedefs for ease of use **/
   typedef std::scoped_allocator_adaptor<
-      bip::allocator<MappedType, bip::managed_mapped_file::segment_manager>>
+      node_allocator<Allocator, MappedType>>
       ShmemAllocator;
   typedef boost::interprocess::deque<MappedType, ShmemAllocator> Queue;
 
   /** Class attributes**/
   Queue *my_queue;
+  /** Remote procedures **/
+  rpc_handle<bool(MappedType)> push_rpc;
+  rpc_handle<std::pair<bool, MappedType>()> pop_rpc;
+  rpc_handle<bool()> wait_for_element_rpc;
+  rpc_handle<size_t()> size_rpc;
+  rpc_handle<bool(std::vector<MappedType>)> push_batch_rpc;
+  /** Pushes waiting to be sent to each server **/
+  request_batch<MappedType> push_batch;
+
+  bool flush_pushes(uint16_t server_index);
 
  public:
   ~queue();
@@ -86,24 +96,35 @@ class queue : public container {
     if (server_on_node || is_server)
       return my_queue;
     else
-      nullptr;
+      return nullptr;
   }
   bool LocalPush(MappedType &data);
   std::pair<bool, MappedType> LocalPop();
   bool LocalWaitForElement();
   size_t LocalSize();
+  bool LocalPushBatch(std::vector<MappedType> &batch);
 
 #if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
   THALLIUM_DEFINE(LocalPush, (data), MappedType &data)
   THALLIUM_DEFINE1(LocalPop)
   THALLIUM_DEFINE1(LocalWaitForElement)
   THALLIUM_DEFINE1(LocalSize)
+  THALLIUM_DEFINE(LocalPushBatch, (batch), std::vector<MappedType> &batch)
 #endif
 
   bool Push(MappedType &data, uint16_t &key_int);
   std::pair<bool, MappedType> Pop(uint16_t &key_int);
+  RPCFuture<bool> AsyncPush(MappedType &data, uint16_t &key_int);
+  RPCFuture<std::pair<bool, MappedType>> AsyncPop(uint16_t &key_int);
   bool WaitForElement(uint16_t &key_int);
   size_t Size(uint16_t &key_int);
+  bool Flush();
+  /**
+   * Durability barrier for write-behind mode: sends every buffered Push and
+   * waits for the servers.
+   * @return bool, false if this or an earlier background send failed.
+   */
+  bool Quiesce();
 };
 
 #include "queue.cpp"
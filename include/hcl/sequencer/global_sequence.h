@@ -32,14 +32,16 @@ namespace hcl {
 class global_sequence : public container {
  private:
   uint64_t *value;
+  /** Remote procedures **/
+  rpc_handle<uint64_t()> get_next_sequence_rpc;
 
  public:
-  ~global_sequence() { this->container::~container(); }
+  ~global_sequence() {}
 
   void construct_shared_memory() override {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
-    value = segment.construct<uint64_t>(name.c_str())(0);
+    value = construct_named<uint64_t>(name.c_str(), 0);
   }
 
   void open_shared_memory() override {
@@ -54,7 +56,6 @@ class global_sequence : public container {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
 
-    auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
     switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
       case THALLIUM:
@@ -68,6 +69,15 @@ class global_sequence : public container {
         break;
       }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+      case LOOPBACK: {
+        bind_loopback("_GetNextSequence",
+                      &global_sequence::LocalGetNextSequence);
+        break;
+      }
+#endif
+      default:
+        break;
     }
   }
 
@@ -84,11 +94,15 @@ class global_sequence : public container {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
     if (is_server) {
-      construct_shared_memory();
+      if (attach_type(typeid(*this).name()))
+        open_shared_memory();
+      else
+        construct_shared_memory();
       bind_functions();
     } else if (!is_server && server_on_node) {
       open_shared_memory();
     }
+    define_rpc_handle(get_next_sequence_rpc, "_GetNextSequence");
   }
   uint64_t *data() {
     HCL_LOG_TRACE();
@@ -110,7 +124,7 @@ class global_sequence : public container {
       auto my_server_i = my_server_idx;
       HCL_CPP_FUNCTION_UPDATE("access", "remote");
       HCL_CPP_FUNCTION_UPDATE("access", my_server_i);
-      return RPC_CALL_WRAPPER1("_GetNextSequence", my_server_i, uint64_t);
+      return get_next_sequence_rpc.call(my_server_i);
     }
   }
   uint64_t GetNextSequenceServer(uint16_t &server) {
@@ -122,7 +136,7 @@ class global_sequence : public container {
     } else {
       HCL_CPP_FUNCTION_UPDATE("access", "remote");
       HCL_CPP_FUNCTION_UPDATE("access", server);
-      return RPC_CALL_WRAPPER1("_GetNextSequence", server, uint64_t);
+      return get_next_sequence_rpc.call(server);
     }
   }
 
@@ -130,8 +144,7 @@ class global_sequence : public container {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
     HCL_CPP_FUNCTION_UPDATE("access", "local");
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    std::unique_lock<rw_lock> lock(*mutex);
     return ++*value;
   }
 
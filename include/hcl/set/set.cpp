@@ -18,7 +18,9 @@
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
           typename SharedType>
 set<KeyType, Hash, Compare, Allocator, SharedType>::~set() {
-  this->container::~container();
+  stop_compaction();
+  stop_write_behind();
+  Flush();
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
@@ -29,15 +31,52 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::set(
     bool _is_server_on_node, CharStruct _backed_file_dir)
     : container(name_, port, _num_servers, _my_server_idx, _memory_allocated,
                 _is_server, _is_server_on_node, _backed_file_dir),
-      myset() {
+      myset(),
+      compact_cursor() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   if (is_server) {
-    construct_shared_memory();
+    if (attach_type(typeid(*this).name()))
+      open_shared_memory();
+    else
+      construct_shared_memory();
     bind_functions();
+    start_compaction(HCL_CONF->COMPACTION_INTERVAL_MS);
   } else if (!is_server && server_on_node) {
     open_shared_memory();
   }
+  define_rpc_handle(put_rpc, "_Put");
+  define_rpc_handle(get_rpc, "_Get");
+  define_rpc_handle(erase_rpc, "_Erase");
+  define_rpc_handle(get_all_data_rpc, "_GetAllData");
+  define_rpc_handle(contains_rpc, "_Contains");
+  define_rpc_handle(seek_first_rpc, "_SeekFirst");
+  define_rpc_handle(pop_first_rpc, "_PopFirst");
+  define_rpc_handle(seek_first_n_rpc, "_SeekFirstN");
+  define_rpc_handle(size_rpc, "_Size");
+  define_rpc_handle(put_batch_rpc, "_PutBatch");
+  put_batch.configure(num_servers, HCL_CONF->BATCH_SIZE,
+                      HCL_CONF->BATCH_WINDOW_MS);
+  if (put_batch.timed())
+    start_write_behind(HCL_CONF->BATCH_WINDOW_MS,
+                       [this]() { return Flush(); });
+}
+
+/**
+ * Moves the next COMPACTION_SLICE keys of the local set to new memory.
+ * @param restart, start over from the first key
+ * @return bool, true if keys remain.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType>
+bool set<KeyType, Hash, Compare, Allocator, SharedType>::compact_slice(
+    bool restart) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  return compact_tree_slice(*myset, compact_cursor, restart,
+                            [](const KeyType &key) -> const KeyType & {
+                              return key;
+                            });
 }
 
 /**
@@ -53,12 +92,71 @@ bool set<KeyType, Hash, Compare, Allocator, SharedType>::LocalPut(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
-  auto value = GetData<Allocator, KeyType, SharedType>(key);
-  myset->insert(value);
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    auto value = GetData<Allocator, KeyType, SharedType>(key);
+    myset->insert(value);
+
+    return true;
+  });
+}
+
+/**
+ * Put a batch of keys into the local set while holding the lock once.
+ * @param batch, the keys to put
+ * @return bool, true if every Put was successful.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType>
+bool set<KeyType, Hash, Compare, Allocator, SharedType>::LocalPutBatch(
+    std::vector<KeyType> &batch) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  HCL_CPP_FUNCTION_UPDATE("access", "local");
+  size_t done = 0;
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    for (; done < batch.size(); ++done) {
+      auto &key = batch[done];
+      auto value = GetData<Allocator, KeyType, SharedType>(key);
+      myset->insert(value);
+    }
+    return true;
+  });
+}
+
+/**
+ * Sends the Puts buffered for one server as a single _PutBatch.
+ * @param server_index, server whose buffer is drained
+ * @return bool, true if every buffered Put was successful.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType>
+bool set<KeyType, Hash, Compare, Allocator, SharedType>::flush_puts(
+    uint16_t server_index) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::lock_guard<std::mutex> sending(put_batch.sending(server_index));
+  auto batch = put_batch.take(server_index);
+  if (batch.empty()) return true;
+  HCL_CPP_FUNCTION_UPDATE("server", server_index);
+  return put_batch_rpc.call(server_index, batch);
+}
 
-  return true;
+/**
+ * Sends every buffered Put to its server.
+ * @return bool, true if every buffered Put was successful.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType>
+bool set<KeyType, Hash, Compare, Allocator, SharedType>::Flush() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  bool success = true;
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    if (!flush_puts(i)) success = false;
+  }
+  return write_behind_succeeded() && success;
 }
 
 /**
@@ -73,14 +171,43 @@ bool set<KeyType, Hash, Compare, Allocator, SharedType>::Put(KeyType &key) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
+  uint16_t key_int = server_of(key_hash);
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalPut(key);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    return RPC_CALL_WRAPPER("_Put", key_int, bool, key);
+    if (put_batch.enabled()) {
+      HCL_CPP_FUNCTION_UPDATE("transfer", "batch");
+      if (!put_batch.add(key_int, KeyType(key))) return true;
+      return flush_puts(key_int);
+    }
+    return put_rpc.call(key_int, key);
+  }
+}
+
+/**
+ * Put the key into the set without waiting for the remote server.
+ * @param key, the key for put
+ * @return RPCFuture<bool>, handle that yields true once Put was successful.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType>
+RPCFuture<bool> set<KeyType, Hash, Compare, Allocator, SharedType>::AsyncPut(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<bool>(LocalPut(key));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_puts(key_int);
+    return put_rpc.async_call(key_int, key);
   }
 }
 
@@ -97,8 +224,7 @@ bool set<KeyType, Hash, Compare, Allocator, SharedType>::LocalGet(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   typename MySet::iterator iterator = myset->find(key);
   if (iterator != myset->end()) {
     return true;
@@ -119,15 +245,39 @@ bool set<KeyType, Hash, Compare, Allocator, SharedType>::Get(KeyType &key) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+  uint16_t key_int = server_of(key_hash);
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalGet(key);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    typedef bool ret_type;
-    return RPC_CALL_WRAPPER("_Get", key_int, ret_type, key);
+    flush_puts(key_int);
+    return get_rpc.call(key_int, key);
+  }
+}
+
+/**
+ * Look up the key in the set without waiting for the remote server.
+ * @param key, key to get
+ * @return RPCFuture<bool>, handle that yields true if the key was found.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType>
+RPCFuture<bool> set<KeyType, Hash, Compare, Allocator, SharedType>::AsyncGet(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<bool>(LocalGet(key));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_puts(key_int);
+    return get_rpc.async_call(key_int, key);
   }
 }
 
@@ -138,8 +288,7 @@ bool set<KeyType, Hash, Compare, Allocator, SharedType>::LocalErase(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-      lock(*mutex);
+  std::unique_lock<rw_lock> lock(*mutex);
   size_t s = myset->erase(key);
 
   return s > 0;
@@ -151,15 +300,39 @@ bool set<KeyType, Hash, Compare, Allocator, SharedType>::Erase(KeyType &key) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = key_hash % num_servers;
+  uint16_t key_int = server_of(key_hash);
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalErase(key);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    typedef bool ret_type;
-    return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
+    flush_puts(key_int);
+    return erase_rpc.call(key_int, key);
+  }
+}
+
+/**
+ * Erase the key from the set without waiting for the remote server.
+ * @param key, key to erase
+ * @return RPCFuture<bool>, handle that yields true if the key was erased.
+ */
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType>
+RPCFuture<bool> set<KeyType, Hash, Compare, Allocator, SharedType>::AsyncErase(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<bool>(LocalErase(key));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_puts(key_int);
+    return erase_rpc.async_call(key_int, key);
   }
 }
 
@@ -177,23 +350,30 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::Contains(KeyType &key_start,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   std::vector<KeyType> final_values = std::vector<KeyType>();
-  auto current_server = ContainsInServer(key_start, key_end);
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server_idx) {
-      HCL_CPP_REGION(ContainsInServerServer)
-      HCL_CPP_REGION_UPDATE(ContainsInServerServer, "access", "remote");
-      HCL_CPP_REGION_UPDATE(ContainsInServerServer, "access", i);
-      typedef std::vector<KeyType> ret_type;
-      auto server =
-          RPC_CALL_WRAPPER("_Contains", i, ret_type, key_start, key_end);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
-  }
+  Contains(key_start, key_end, [&final_values](std::vector<KeyType> &values) {
+    final_values.insert(final_values.end(), values.begin(), values.end());
+  });
   return final_values;
 }
 
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType>
+void set<KeyType, Hash, Compare, Allocator, SharedType>::Contains(
+    KeyType &key_start, KeyType &key_end,
+    std::function<void(std::vector<KeyType> &)> on_server) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  Flush();
+  scatter_gather<std::vector<KeyType>>(
+      [&](uint16_t server) {
+        HCL_CPP_REGION(ContainsInServerServer)
+        HCL_CPP_REGION_UPDATE(ContainsInServerServer, "access", "remote");
+        HCL_CPP_REGION_UPDATE(ContainsInServerServer, "access", server);
+        return contains_rpc.async_call(server, key_start, key_end);
+      },
+      [&]() { return ContainsInServer(key_start, key_end); }, on_server);
+}
+
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
           typename SharedType>
 std::vector<KeyType>
@@ -201,22 +381,29 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::GetAllData() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   std::vector<KeyType> final_values = std::vector<KeyType>();
-  auto current_server = GetAllDataInServer();
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server_idx) {
-      HCL_CPP_REGION(GetAllDataServer)
-      HCL_CPP_REGION_UPDATE(GetAllDataServer, "access", "remote");
-      HCL_CPP_REGION_UPDATE(GetAllDataServer, "access", i);
-      typedef std::vector<KeyType> ret_type;
-      auto server = RPC_CALL_WRAPPER1("_GetAllData", i, ret_type);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
-  }
+  GetAllData([&final_values](std::vector<KeyType> &values) {
+    final_values.insert(final_values.end(), values.begin(), values.end());
+  });
   return final_values;
 }
 
+template <typename KeyType, typename Hash, typename Compare, typename Allocator,
+          typename SharedType>
+void set<KeyType, Hash, Compare, Allocator, SharedType>::GetAllData(
+    std::function<void(std::vector<KeyType> &)> on_server) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  Flush();
+  scatter_gather<std::vector<KeyType>>(
+      [&](uint16_t server) {
+        HCL_CPP_REGION(GetAllDataServer)
+        HCL_CPP_REGION_UPDATE(GetAllDataServer, "access", "remote");
+        HCL_CPP_REGION_UPDATE(GetAllDataServer, "access", server);
+        return get_all_data_rpc.async_call(server);
+      },
+      [&]() { return GetAllDataInServer(); }, on_server);
+}
+
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
           typename SharedType>
 std::vector<KeyType> set<KeyType, Hash, Compare, Allocator,
@@ -227,8 +414,7 @@ std::vector<KeyType> set<KeyType, Hash, Compare, Allocator,
   HCL_CPP_FUNCTION_UPDATE("access", "local");
   std::vector<KeyType> final_values = std::vector<KeyType>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    std::shared_lock<rw_lock> lock(*mutex);
     typename MySet::iterator lower_bound;
     size_t size = myset->size();
     if (size == 0) {
@@ -267,12 +453,11 @@ std::vector<KeyType> set<KeyType, Hash, Compare, Allocator,
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalContainsInServer(key_start, key_end);
   } else {
-    typedef std::vector<KeyType> ret_type;
     auto my_server_i = my_server_idx;
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", my_server_i);
-    return RPC_CALL_WRAPPER("_Contains", my_server_i, ret_type, key_start,
-                            key_end);
+    flush_puts(my_server_i);
+    return contains_rpc.call(my_server_i, key_start, key_end);
   }
 }
 
@@ -285,8 +470,7 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::LocalGetAllDataInServer() {
   HCL_CPP_FUNCTION_UPDATE("access", "local");
   std::vector<KeyType> final_values = std::vector<KeyType>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
+    std::shared_lock<rw_lock> lock(*mutex);
     typename MySet::iterator lower_bound;
     lower_bound = myset->begin();
     while (lower_bound != myset->end()) {
@@ -307,11 +491,11 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::GetAllDataInServer() {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalGetAllDataInServer();
   } else {
-    typedef std::vector<KeyType> ret_type;
     auto my_server_i = my_server_idx;
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", my_server_i);
-    return RPC_CALL_WRAPPER1("_GetAllData", my_server_i, ret_type);
+    flush_puts(my_server_i);
+    return get_all_data_rpc.call(my_server_i);
   }
 }
 
@@ -321,7 +505,7 @@ std::pair<bool, KeyType>
 set<KeyType, Hash, Compare, Allocator, SharedType>::LocalSeekFirst() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   if (myset->size() > 0) {
     auto iterator = myset->begin();  // We want First (smallest) value in set
     KeyType value = *iterator;
@@ -342,8 +526,8 @@ std::pair<bool, KeyType> set<KeyType, Hash, Compare, Allocator,
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, KeyType> ret_type;
-    return RPC_CALL_WRAPPER1("_SeekFirst", key_int, ret_type);
+    flush_puts(key_int);
+    return seek_first_rpc.call(key_int);
   }
 }
 
@@ -355,7 +539,7 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::LocalSeekFirstN(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   auto keys = std::vector<KeyType>();
   auto iterator = myset->begin();
   uint32_t i = 0;
@@ -380,8 +564,8 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::SeekFirstN(
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, KeyType> ret_type;
-    return RPC_CALL_WRAPPER("_SeekFirstN", key_int, ret_type, n);
+    flush_puts(key_int);
+    return seek_first_n_rpc.call(key_int, n);
   }
 }
 
@@ -392,7 +576,7 @@ set<KeyType, Hash, Compare, Allocator, SharedType>::LocalPopFirst() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::unique_lock<rw_lock> lock(*mutex);
   if (myset->size() > 0) {
     auto iterator = myset->begin();  // We want First (smallest) value in set
     KeyType value = *iterator;
@@ -414,8 +598,8 @@ std::pair<bool, KeyType> set<KeyType, Hash, Compare, Allocator,
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, KeyType> ret_type;
-    return RPC_CALL_WRAPPER1("_PopFirst", key_int, ret_type);
+    flush_puts(key_int);
+    return pop_first_rpc.call(key_int);
   }
 }
 
@@ -440,8 +624,8 @@ size_t set<KeyType, Hash, Compare, Allocator, SharedType>::Size(
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef size_t ret_type;
-    return RPC_CALL_WRAPPER1("_Size", key_int, ret_type);
+    flush_puts(key_int);
+    return size_rpc.call(key_int);
   }
 }
 
@@ -452,9 +636,9 @@ void set<KeyType, Hash, Compare, Allocator,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  ShmemAllocator alloc_inst(segment.get_segment_manager());
+  ShmemAllocator alloc_inst(allocator_of<KeyType, Allocator>());
   /* Construct set in the shared memory space. */
-  myset = segment.construct<MySet>(name.c_str())(Compare(), alloc_inst);
+  myset = construct_named<MySet>(name.c_str(), Compare(), alloc_inst);
 }
 
 template <typename KeyType, typename Hash, typename Compare, typename Allocator,
@@ -475,7 +659,6 @@ void set<KeyType, Hash, Compare, Allocator, SharedType>::bind_functions() {
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
 
-  auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
   /* Create a RPC server and map the methods to it. */
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
@@ -516,6 +699,11 @@ void set<KeyType, Hash, Compare, Allocator, SharedType>::bind_functions() {
           std::bind(&set<KeyType, Hash, Compare, Allocator,
                          SharedType>::ThalliumLocalSize,
                     this, std::placeholders::_1));
+      std::function<void(const tl::request &, std::vector<KeyType> &)>
+          putBatchFunc(std::bind(&set<KeyType, Hash, Compare, Allocator,
+                                      SharedType>::ThalliumLocalPutBatch,
+                                 this, std::placeholders::_1,
+                                 std::placeholders::_2));
       std::function<void(const tl::request &, uint32_t)> localSeekFirstNFunc(
           std::bind(&set<KeyType, Hash, Compare, Allocator,
                          SharedType>::ThalliumLocalSeekFirstN,
@@ -530,9 +718,27 @@ void set<KeyType, Hash, Compare, Allocator, SharedType>::bind_functions() {
       rpc->bind(func_prefix + "_PopFirst", popFirstFunc);
       // rpc->bind(func_prefix+"_SeekFirstN", localSeekFirstNFunc);
       rpc->bind(func_prefix + "_Size", sizeFunc);
+      rpc->bind(func_prefix + "_PutBatch", putBatchFunc);
+      break;
+    }
+#endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      bind_loopback("_Put", &set::LocalPut);
+      bind_loopback("_Get", &set::LocalGet);
+      bind_loopback("_Erase", &set::LocalErase);
+      bind_loopback("_GetAllData", &set::LocalGetAllDataInServer);
+      bind_loopback("_Contains", &set::LocalContainsInServer);
+      bind_loopback("_SeekFirst", &set::LocalSeekFirst);
+      bind_loopback("_PopFirst", &set::LocalPopFirst);
+      bind_loopback("_SeekFirstN", &set::LocalSeekFirstN);
+      bind_loopback("_Size", &set::LocalSize);
+      bind_loopback("_PutBatch", &set::LocalPutBatch);
       break;
     }
 #endif
+    default:
+      break;
   }
 }
 
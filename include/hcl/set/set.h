@@ -55,13 +55,31 @@ template <typename KeyType, typename Hash = std::hash<KeyType>,
 class set : public container {
  private:
   /** Class Typedefs for ease of use **/
-  typedef std::scoped_allocator_adaptor<boost::interprocess::allocator<
-      KeyType, boost::interprocess::managed_mapped_file::segment_manager>>
+  typedef std::scoped_allocator_adaptor<
+      node_allocator<Allocator, KeyType>>
       ShmemAllocator;
   typedef boost::interprocess::set<KeyType, Compare, ShmemAllocator> MySet;
   /** Class attributes**/
   Hash keyHash;
   MySet *myset;
+  /** Remote procedures **/
+  rpc_handle<bool(KeyType)> put_rpc;
+  rpc_handle<bool(KeyType)> get_rpc;
+  rpc_handle<bool(KeyType)> erase_rpc;
+  rpc_handle<std::vector<KeyType>()> get_all_data_rpc;
+  rpc_handle<std::vector<KeyType>(KeyType, KeyType)> contains_rpc;
+  rpc_handle<std::pair<bool, KeyType>()> seek_first_rpc;
+  rpc_handle<std::pair<bool, KeyType>()> pop_first_rpc;
+  rpc_handle<std::pair<bool, std::vector<KeyType>>(uint32_t)> seek_first_n_rpc;
+  rpc_handle<size_t()> size_rpc;
+  rpc_handle<bool(std::vector<KeyType>)> put_batch_rpc;
+  /** Puts waiting to be sent to each server **/
+  request_batch<KeyType> put_batch;
+  /** Last key moved by compaction **/
+  KeyType compact_cursor;
+
+  bool flush_puts(uint16_t server_index);
+  bool compact_slice(bool restart) override;
 
  public:
   ~set();
@@ -78,7 +96,7 @@ class set : public container {
     if (server_on_node || is_server)
       return myset;
     else
-      nullptr;
+      return nullptr;
   }
   explicit set(CharStruct name_ = "TEST_SET",
                uint16_t port = HCL_CONF->RPC_PORT,
@@ -99,6 +117,7 @@ class set : public container {
   std::pair<bool, KeyType> LocalPopFirst();
   size_t LocalSize();
   std::pair<bool, std::vector<KeyType>> LocalSeekFirstN(uint32_t n);
+  bool LocalPutBatch(std::vector<KeyType> &batch);
 
 #if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
   THALLIUM_DEFINE(LocalPut, (key), KeyType &key)
@@ -107,6 +126,7 @@ class set : public container {
   THALLIUM_DEFINE(LocalContainsInServer, (key_start, key_end),
                   KeyType &key_start, KeyType &key_end)
   THALLIUM_DEFINE(LocalSeekFirstN, (n), uint32_t n)
+  THALLIUM_DEFINE(LocalPutBatch, (batch), std::vector<KeyType> &batch)
 
   THALLIUM_DEFINE1(LocalSize)
   THALLIUM_DEFINE1(LocalSeekFirst)
@@ -118,9 +138,24 @@ class set : public container {
   bool Get(KeyType &key);
 
   bool Erase(KeyType &key);
+  RPCFuture<bool> AsyncPut(KeyType &key);
+  RPCFuture<bool> AsyncGet(KeyType &key);
+  RPCFuture<bool> AsyncErase(KeyType &key);
+  bool Flush();
   std::vector<KeyType> Contains(KeyType &key_start, KeyType &key_end);
+  /**
+   * Streams the result: on_server is called once for each server, local
+   * part first and then as the concurrent requests complete.
+   */
+  void Contains(KeyType &key_start, KeyType &key_end,
+                std::function<void(std::vector<KeyType> &)> on_server);
 
   std::vector<KeyType> GetAllData();
+  /**
+   * Streams the result: on_server is called once for each server, local
+   * part first and then as the concurrent requests complete.
+   */
+  void GetAllData(std::function<void(std::vector<KeyType> &)> on_server);
 
   std::vector<KeyType> ContainsInServer(KeyType &key_start, KeyType &key_end);
   std::vector<KeyType> GetAllDataInServer();
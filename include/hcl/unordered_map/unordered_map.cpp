@@ -20,7 +20,12 @@ template <typename KeyType, typename MappedType, typename Hash,
           typename Allocator, typename SharedType>
 unordered_map<KeyType, MappedType, Hash, Allocator,
               SharedType>::~unordered_map() {
-  this->container::~container();
+  stop_migration();
+  stop_compaction();
+  stop_write_behind();
+  Flush();
+  wait_for_replicas();
+  hot.stop();
 }
 
 template <typename KeyType, typename MappedType, typename Hash,
@@ -32,15 +37,163 @@ unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::unordered_map(
     : container(name_, port, _num_servers, _my_server_idx, _memory_allocated,
                 _is_server, _is_server_on_node, _backed_file_dir),
       myHashMap(),
+      compact_stripe(0),
+      compact_bucket(0),
+      hotKeys(),
+      hot(HCL_CONF->HOT_KEY_THRESHOLD, HCL_CONF->HOT_KEY_MAX,
+          static_cast<size_t>(HCL_CONF->HOT_KEY_MAX) * _num_servers,
+          [this](std::function<bool()> done) {
+            rpc->wait_until(done, std::chrono::microseconds::max());
+          }),
+      near(),
+      leases(),
       size_occupied(0) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   if (is_server) {
-    construct_shared_memory();
+    if (attach_type(typeid(*this).name()))
+      open_shared_memory();
+    else
+      construct_shared_memory();
     bind_functions();
+    start_compaction(HCL_CONF->COMPACTION_INTERVAL_MS);
+    /* Replicas already share the reads of every key. */
+    if (HCL_CONF->HOT_KEY_THRESHOLD > 0 && replication < 2)
+      hot.start(HCL_HOT_KEY_SKETCH_WIDTH, HCL_CONF->HOT_KEY_WINDOW_MS,
+                [this]() { end_window(); },
+                [this](std::vector<KeyType> &keys) {
+                  return share_copies(keys);
+                });
+    if (HCL_CONF->NEAR_CACHE_BYTES > 0)
+      leases.reset(new lease_table(
+          HCL_LEASE_BUCKETS,
+          [this](std::chrono::microseconds duration) { rpc->sleep(duration); }));
   } else if (!is_server && server_on_node) {
     open_shared_memory();
   }
+  define_rpc_handle(put_rpc, "_Put");
+  define_rpc_handle(get_rpc, "_Get");
+  define_rpc_handle(erase_rpc, "_Erase");
+  define_rpc_handle(get_all_data_rpc, "_GetAllData");
+  define_rpc_handle(put_batch_rpc, "_PutBatch");
+  define_rpc_handle(get_batch_rpc, "_GetBatch");
+  define_rpc_handle(import_rpc, "_Import");
+  define_rpc_handle(replica_put_rpc, "_ReplicaPut");
+  define_rpc_handle(replica_erase_rpc, "_ReplicaErase");
+  define_rpc_handle(replica_get_rpc, "_ReplicaGet");
+  define_rpc_handle(hot_put_rpc, "_HotPut");
+  define_rpc_handle(hot_drop_rpc, "_HotDrop");
+  define_rpc_handle(hot_reads_rpc, "_HotReads");
+  define_rpc_handle(hot_get_rpc, "_HotGet");
+  define_rpc_handle(leased_get_rpc, "_LeasedGet");
+  if (HCL_CONF->NEAR_CACHE_BYTES > 0)
+    near.reset(new near_cache<KeyType, std::pair<bool, MappedType>, Hash>(
+        HCL_CONF->NEAR_CACHE_BYTES));
+  put_batch.configure(num_servers, HCL_CONF->BATCH_SIZE,
+                      HCL_CONF->BATCH_WINDOW_MS, HCL_CONF->WRITE_BEHIND);
+  if (put_batch.timed())
+    start_write_behind(HCL_CONF->BATCH_WINDOW_MS,
+                       [this]() { return Flush(); });
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+  define_rpc_handle(put_bulk_rpc, "_PutBulk");
+#endif
+}
+
+/**
+ * Decides whether a Put moves its value with RDMA instead of serializing it.
+ * Only values that keep their elements outside the table's node qualify:
+ * the server pulls into the storage it then links into the table. Gets have
+ * no bulk path, since pushing out of a node would hold its stripe lock for
+ * the whole transfer, and neither have fixed-size values such as
+ * std::array, which live inside the node.
+ * @param data, the value to transfer
+ * @return bool, true if the value is contiguous, not stored inline and
+ * above RDMA_THRESHOLD.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::use_bulk(
+    MappedType &data) {
+  if (!BulkBuffer<MappedType>::IsContiguous ||
+      BulkBuffer<MappedType>::IsFixed || HCL_CONF->RDMA_THRESHOLD == 0)
+    return false;
+  return BulkBuffer<MappedType>().GetSize(data) > HCL_CONF->RDMA_THRESHOLD;
+}
+
+/**
+ * Sends the Puts buffered for one server as a single _PutBatch.
+ * @param server_index, server whose buffer is drained
+ * @return bool, true if every buffered Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator,
+                   SharedType>::flush_puts(uint16_t server_index) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::lock_guard<std::mutex> sending(put_batch.sending(server_index));
+  auto batch = put_batch.take(server_index);
+  if (batch.empty()) return true;
+  HCL_CPP_FUNCTION_UPDATE("server", server_index);
+  return send_puts(server_index, batch);
+}
+
+/**
+ * Sends Puts to one server as a single _PutBatch. If the slots of some keys
+ * have moved, the batch is split again over their new owners.
+ * @param server_index, server the batch is sent to
+ * @return bool, true if every Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::
+    send_puts(uint16_t server_index,
+              std::vector<std::pair<KeyType, MappedType>> &batch) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  routed<bool> reply = put_batch_rpc.call(server_index, batch);
+  if (reply.moved.empty()) return reply.value;
+  learn_routes(reply.moved);
+  std::vector<std::vector<std::pair<KeyType, MappedType>>> parts(num_servers);
+  for (auto &put : batch)
+    parts[server_of(keyHash(put.first))].push_back(std::move(put));
+  bool success = true;
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    if (!parts[i].empty() && !send_puts(i, parts[i])) success = false;
+  }
+  return success;
+}
+
+/**
+ * Sends every buffered Put to its server.
+ * @return bool, true if every buffered Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::Flush() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  bool success = true;
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    if (!flush_puts(i)) success = false;
+  }
+  return success;
+}
+
+/**
+ * Sends every buffered Put, waits for the writes still being forwarded to
+ * replicas and reports failures of either background path.
+ * @return bool, true if every Put since the last Quiesce was successful.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator,
+                   SharedType>::Quiesce() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  bool success = Flush();
+  bool replicated = wait_for_replicas();
+  return write_behind_succeeded() && replicated && success;
 }
 
 /**
@@ -55,23 +208,71 @@ bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalPut(
     KeyType &key, MappedType &data) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  if (is_server && !server_on_node) {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
-    auto value = GetData<Allocator, MappedType, SharedType>(data);
-    auto iter = myHashMap->insert_or_assign(key, value);
-    if (iter.second)
-      size_occupied += CalculateSize<KeyType>().GetSize(key) +
-                       CalculateSize<MappedType>().GetSize(data);
-  } else {
+  MappedType value(data);
+  return put_owned(key, value);
+}
+
+/**
+ * Moves data into the local unordered map under key. A value that keeps its
+ * elements outside the table, like a vector, is linked in without copying
+ * them.
+ * @param data, the value for put, left empty
+ * @return bool, true if Put was successful else false.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::put_owned(
+    KeyType &key, MappedType &data) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  uint32_t stripe = stripe_of(keyHash(key));
+  MyHashMap &table = myHashMap[stripe];
+  really_long size = CalculateSize<KeyType>().GetSize(key) +
+                     CalculateSize<MappedType>().GetSize(data);
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(stripe_mutex(stripe));
     auto value = GetData<Allocator, MappedType, SharedType>(data);
-    auto iter = myHashMap->insert_or_assign(key, value);
-    if (iter.second)
-      size_occupied += CalculateSize<KeyType>().GetSize(key) +
-                       CalculateSize<MappedType>().GetSize(data);
-  }
-  return true;
+    auto iter = table.insert_or_assign(key, std::move(value));
+    if (iter.second) size_occupied += size;
+    return true;
+  });
+}
+
+/**
+ * Put a batch of key/value pairs into the local unordered map while holding
+ * each lock stripe once. Pairs with the same key are applied in order.
+ * @param batch, the pairs to put in order
+ * @return bool, true if every Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::
+    LocalPutBatch(std::vector<std::pair<KeyType, MappedType>> &batch) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::vector<std::vector<size_t>> by_stripe(num_stripes);
+  for (size_t i = 0; i < batch.size(); ++i)
+    by_stripe[stripe_of(keyHash(batch[i].first))].push_back(i);
+  uint32_t stripe = 0;
+  size_t next = 0;
+  return growing([&]() {
+    for (; stripe < num_stripes; ++stripe, next = 0) {
+      if (by_stripe[stripe].empty()) continue;
+      std::unique_lock<rw_lock> lock(stripe_mutex(stripe));
+      MyHashMap &table = myHashMap[stripe];
+      for (; next < by_stripe[stripe].size(); ++next) {
+        auto &entry = batch[by_stripe[stripe][next]];
+        auto value = GetData<Allocator, MappedType, SharedType>(entry.second);
+        auto iter = table.insert_or_assign(entry.first, value);
+        if (iter.second)
+          size_occupied += CalculateSize<KeyType>().GetSize(entry.first) +
+                           CalculateSize<MappedType>().GetSize(entry.second);
+      }
+    }
+    return true;
+  });
 }
+
 /**
  * Put the data into the unordered map. Uses key to decide the server to hash it
  * to,
@@ -85,14 +286,74 @@ bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::Put(
     KeyType key, MappedType data) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  uint16_t key_int = (uint16_t)keyHash(key) % num_servers;
-  if (is_local(key_int)) {
+  if (near != nullptr) near->erase(key);
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  std::function<routed<bool>(uint16_t)> resend = [&](uint16_t server) {
+    return put_rpc.call(server, key, data);
+  };
+  if (writes_locally(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
-    return LocalPut(key, data);
+    return follow_routes(key_hash, LocalRoutedPut(key, data), resend);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    return RPC_CALL_WRAPPER("_Put", key_int, bool, key, data);
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+    if (HCL_CONF->RPC_IMPLEMENTATION == THALLIUM && use_bulk(data)) {
+      HCL_CPP_FUNCTION_UPDATE("transfer", "bulk");
+      flush_puts(key_int);
+      BulkBuffer<MappedType> buffer;
+      tl::bulk bulk = rpc->expose(buffer.Data(data), buffer.GetSize(data),
+                                  tl::bulk_mode::read_only);
+      std::function<routed<bool>(uint16_t)> resend_bulk =
+          [&](uint16_t server) { return put_bulk_rpc.call(server, key, bulk); };
+      return follow_routes(key_hash, resend_bulk(key_int), resend_bulk);
+    }
+#endif
+    if (put_batch.enabled()) {
+      HCL_CPP_FUNCTION_UPDATE("transfer", "batch");
+      if (!put_batch.add(
+              key_int, std::pair<KeyType, MappedType>(key, std::move(data)),
+              [&key](const std::pair<KeyType, MappedType> &put) {
+                return put.first == key;
+              }))
+        return true;
+      return flush_puts(key_int);
+    }
+    return follow_routes(key_hash, resend(key_int), resend);
+  }
+}
+
+/**
+ * Put the data into the unordered map without waiting for the remote server.
+ * @param key, the key for put
+ * @param data, the value for put
+ * @return RPCFuture<bool>, handle that yields true once Put was successful.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+RPCFuture<bool>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::AsyncPut(
+    KeyType &key, MappedType &data) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (near != nullptr) near->erase(key);
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  std::function<routed<bool>(uint16_t)> resend =
+      [this, key, data](uint16_t server) mutable {
+        return put_rpc.call(server, key, data);
+      };
+  if (writes_locally(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<bool>(
+        follow_routes(key_hash, LocalRoutedPut(key, data), resend));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_puts(key_int);
+    return follow_routes(key_hash, put_rpc.async_call(key_int, key, data),
+                         resend);
   }
 }
 
@@ -109,28 +370,22 @@ std::pair<bool, MappedType> unordered_map<KeyType, MappedType, Hash, Allocator,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  if (is_server && !server_on_node) {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
-    typename MyHashMap::iterator iterator = myHashMap->find(key);
-    if (iterator != myHashMap->end()) {
-      return std::pair<bool, MappedType>(true, iterator->second);
-    } else {
-      return std::pair<bool, MappedType>(false, MappedType());
-    }
+  uint32_t stripe = stripe_of(keyHash(key));
+  MyHashMap &table = myHashMap[stripe];
+  std::shared_lock<rw_lock> lock(stripe_mutex(stripe));
+  typename MyHashMap::iterator iterator = table.find(key);
+  if (iterator != table.end()) {
+    return std::pair<bool, MappedType>(true, iterator->second);
   } else {
-    typename MyHashMap::iterator iterator = myHashMap->find(key);
-    if (iterator != myHashMap->end()) {
-      return std::pair<bool, MappedType>(true, iterator->second);
-    } else {
-      return std::pair<bool, MappedType>(false, MappedType());
-    }
+    return std::pair<bool, MappedType>(false, MappedType());
   }
 }
 
 /**
  * Get the data in the unordered map. Uses key to decide the server to hash it
- * to,
+ * to, unless the owner told that key is hot: then the copy on this node is
+ * read, or the read goes to the servers in turn. With a near cache, remote
+ * keys are read from the cache and only its misses go to the owner.
  * @param key, key to get
  * @return return a pair of bool and Value. If bool is true then data was
  * found and is present in value part else bool is set to false
@@ -142,18 +397,733 @@ std::pair<bool, MappedType> unordered_map<KeyType, MappedType, Hash, Allocator,
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
+  uint16_t key_int = server_of(key_hash);
+  std::function<routed<std::pair<bool, MappedType>>(uint16_t)> resend =
+      [&](uint16_t server) { return get_rpc.call(server, key); };
+  if (near != nullptr && !is_local(key_int))
+    return cached_get(key, key_hash, key_int);
+  if (replication > 1) {
+    flush_puts(key_int);
+    return read_replica<std::pair<bool, MappedType>>(
+        key_int, [&]() { return LocalGet(key); },
+        [&](uint16_t replica) {
+          return replica_get_rpc.async_call(replica, key);
+        });
+  }
+  if (!is_local(key_int) && hot.seen(key)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "hot");
+    flush_puts(key_int);
+    if (is_server || server_on_node) {
+      std::pair<bool, MappedType> copy = hot_copy(key);
+      if (copy.first) {
+        hot.add_reads(key_hash);
+        return copy;
+      }
+    } else {
+      uint16_t server = read_turn.fetch_add(1, std::memory_order_relaxed) %
+                        num_servers;
+      routed<std::pair<bool, MappedType>> reply =
+          hot_get_rpc.call(server, key);
+      if (reply.hot) return reply.value;
+    }
+    /* Demoted meanwhile, so ask the owner. */
+    hot.learn(key, false);
+  }
   if (is_local(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
-    return LocalGet(key);
+    return follow_routes(key_hash, LocalRoutedGet(key), resend);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Get", key_int, ret_type, key);
+    flush_puts(key_int);
+    routed<std::pair<bool, MappedType>> reply = resend(key_int);
+    if (reply.hot) hot.learn(key, true);
+    return follow_routes(key_hash, std::move(reply), resend);
   }
 }
 
+/**
+ * Get the data in the unordered map without waiting for the remote server.
+ * @param key, key to get
+ * @return RPCFuture of the pair returned by Get.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+RPCFuture<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::AsyncGet(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  typedef std::pair<bool, MappedType> ret_type;
+  std::function<routed<ret_type>(uint16_t)> resend =
+      [this, key](uint16_t server) mutable {
+        return get_rpc.call(server, key);
+      };
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<ret_type>(
+        follow_routes(key_hash, LocalRoutedGet(key), resend));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_puts(key_int);
+    return follow_routes(key_hash, get_rpc.async_call(key_int, key), resend);
+  }
+}
+
+/**
+ * Get a batch of keys from the local unordered map while holding the lock
+ * once.
+ * @param keys, keys to get
+ * @return the pairs returned by LocalGet, in the order of keys.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+std::vector<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalGetBatch(
+    std::vector<KeyType> &keys) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  HCL_CPP_FUNCTION_UPDATE("access", "local");
+  std::vector<std::pair<bool, MappedType>> values(keys.size());
+  std::vector<std::vector<size_t>> by_stripe(num_stripes);
+  for (size_t i = 0; i < keys.size(); ++i)
+    by_stripe[stripe_of(keyHash(keys[i]))].push_back(i);
+  for (uint32_t stripe = 0; stripe < num_stripes; ++stripe) {
+    if (by_stripe[stripe].empty()) continue;
+    std::shared_lock<rw_lock> lock(stripe_mutex(stripe));
+    MyHashMap &table = myHashMap[stripe];
+    for (size_t i : by_stripe[stripe]) {
+      typename MyHashMap::iterator iterator = table.find(keys[i]);
+      if (iterator != table.end())
+        values[i] = std::pair<bool, MappedType>(true, iterator->second);
+    }
+  }
+  return values;
+}
+
+/**
+ * Get many keys with one _GetBatch per server. The requests to all servers
+ * are in flight at the same time.
+ * @param keys, keys to get
+ * @return the pairs returned by Get, in the order of keys.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+std::vector<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::GetBatch(
+    std::vector<KeyType> &keys) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  typedef std::vector<std::pair<bool, MappedType>> ret_type;
+  std::vector<std::vector<KeyType>> server_keys(num_servers);
+  std::vector<std::vector<size_t>> positions(num_servers);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    size_t key_hash = keyHash(keys[i]);
+    uint16_t key_int = server_of(key_hash);
+    server_keys[key_int].push_back(keys[i]);
+    positions[key_int].push_back(i);
+  }
+  std::vector<RPCFuture<routed<ret_type>>> replies(num_servers);
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    if (server_keys[i].empty()) continue;
+    if (is_local(i)) {
+      replies[i] =
+          RPCFuture<routed<ret_type>>(LocalRoutedGetBatch(server_keys[i]));
+    } else {
+      flush_puts(i);
+      replies[i] = get_batch_rpc.async_call(i, server_keys[i]);
+    }
+  }
+  ret_type values(keys.size());
+  for (uint16_t i = 0; i < num_servers; ++i) {
+    if (!replies[i].valid()) continue;
+    auto reply = replies[i].get();
+    /* Some slots have moved: look the server's keys up again. */
+    if (!reply.moved.empty()) {
+      learn_routes(reply.moved);
+      reply.value = GetBatch(server_keys[i]);
+    }
+    auto &server = reply.value;
+    for (size_t j = 0; j < server.size(); ++j)
+      values[positions[i][j]] = std::move(server[j]);
+  }
+  return values;
+}
+
+/**
+ * Copies the entries of the next buckets of the current stripe, about
+ * COMPACTION_SLICE of them, keeps the copies that landed lower in the
+ * segment and frees their originals. The other entries stay where they
+ * are, so that a pass never cuts into the free space at the end.
+ * @param restart, start over from the first bucket of the first stripe
+ * @return bool, true if buckets remain.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator,
+                   SharedType>::compact_slice(bool restart) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (restart) {
+    compact_stripe = 0;
+    compact_bucket = 0;
+  }
+  if (compact_stripe >= num_stripes) return false;
+  MyHashMap &table = myHashMap[compact_stripe];
+  really_long slice = std::max<really_long>(1, HCL_CONF->COMPACTION_SLICE);
+  bool full = false;
+  std::unique_lock<rw_lock> lock(stripe_mutex(compact_stripe));
+  try {
+    MyHashMap fresh(static_cast<size_t>(slice), table.hash_function(),
+                    table.key_eq(), table.get_allocator());
+    try {
+      /* Whole buckets, so that a slice ends on a bucket boundary. */
+      for (really_long examined = 0;
+           compact_bucket < table.bucket_count() && examined < slice;
+           ++compact_bucket) {
+        for (auto entry = table.begin(compact_bucket);
+             entry != table.end(compact_bucket); ++entry, ++examined) {
+          auto copy = fresh.insert(*entry).first;
+          if (!moved_down(&*copy, &*entry)) fresh.erase(copy);
+        }
+      }
+    } catch (const boost::interprocess::bad_alloc &) {
+      full = true;
+    }
+    /* Neither allocates nor rehashes, so the copies always go in. */
+    for (auto &moved : fresh) table.erase(moved.first);
+    table.merge(fresh);
+  } catch (const boost::interprocess::bad_alloc &) {
+    full = true;
+  }
+  if (full) {
+    HCL_LOG_INFO("No room to compact stripe %u of %s\n", compact_stripe,
+                 backed_file.c_str());
+    return false;
+  }
+  if (compact_bucket >= table.bucket_count()) {
+    ++compact_stripe;
+    compact_bucket = 0;
+  }
+  return compact_stripe < num_stripes;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+routed<bool>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalRoutedPut(
+    KeyType &key, MappedType &data) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  /* Leases are waited for before the route locks are taken. */
+  lease_hold hold(leases.get(), key_hash);
+  uint64_t ticket = 0;
+  routed<bool> reply = serve_routed<bool>(key_hash, [&]() {
+    bool success = LocalPut(key, data);
+    std::vector<KeyType> keys(1, key);
+    ticket = hot.refresh(keys);
+    return replicate_put(key, data) && success;
+  });
+  /* The route locks are released, so the copies can be waited for. */
+  reply.value = hot.wait(ticket) && reply.value;
+  return reply;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+routed<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalRoutedGet(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  bool hot_read = false;
+  routed<std::pair<bool, MappedType>> reply =
+      serve_routed<std::pair<bool, MappedType>>(key_hash, [&]() {
+        std::pair<bool, MappedType> result = LocalGet(key);
+        hot_read = result.first && hot.count_read(key, key_hash);
+        return result;
+      });
+  reply.hot = hot_read;
+  return reply;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+routed<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalRoutedErase(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  lease_hold hold(leases.get(), key_hash);
+  uint64_t ticket = 0;
+  routed<std::pair<bool, MappedType>> reply =
+      serve_routed<std::pair<bool, MappedType>>(key_hash, [&]() {
+        std::pair<bool, MappedType> erased = LocalErase(key);
+        if (erased.first) {
+          std::vector<KeyType> keys(1, key);
+          ticket = hot.refresh(keys);
+          replicate([&](uint16_t replica) {
+            return replica_erase_rpc.async_call(replica, key);
+          });
+        }
+        return erased;
+      });
+  hot.wait(ticket);
+  return reply;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+routed<bool>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalRoutedPutBatch(
+    std::vector<std::pair<KeyType, MappedType>> &batch) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::vector<size_t> key_hashes;
+  if (route_stripes != nullptr) {
+    key_hashes.reserve(batch.size());
+    for (auto &put : batch) key_hashes.push_back(keyHash(put.first));
+  }
+  std::vector<uint64_t> leased;
+  if (leases != nullptr) {
+    leased.reserve(batch.size());
+    for (auto &put : batch) leased.push_back(keyHash(put.first));
+  }
+  lease_hold hold(leases.get(), leased);
+  uint64_t ticket = 0;
+  routed<bool> reply = serve_routed<bool>(key_hashes, [&]() {
+    bool success = LocalPutBatch(batch);
+    if (hot.counting()) {
+      std::vector<KeyType> keys;
+      keys.reserve(batch.size());
+      for (auto &put : batch) keys.push_back(put.first);
+      ticket = hot.refresh(keys);
+    }
+    return replicate_puts(batch) && success;
+  });
+  reply.value = hot.wait(ticket) && reply.value;
+  return reply;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+routed<std::vector<std::pair<bool, MappedType>>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalRoutedGetBatch(
+    std::vector<KeyType> &keys) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::vector<size_t> key_hashes;
+  if (route_stripes != nullptr) {
+    key_hashes.reserve(keys.size());
+    for (auto &key : keys) key_hashes.push_back(keyHash(key));
+  }
+  return serve_routed<std::vector<std::pair<bool, MappedType>>>(
+      key_hashes, [&]() { return LocalGetBatch(keys); });
+}
+
+/**
+ * Sends a Put applied here to the other replicas of its key.
+ * @return bool, false if a replica failed to apply it.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::replicate_put(
+    KeyType &key, MappedType &data) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (replication < 2) return true;
+  std::vector<std::pair<KeyType, MappedType>> batch(
+      1, std::pair<KeyType, MappedType>(key, data));
+  return replicate_puts(batch);
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::replicate_puts(
+    std::vector<std::pair<KeyType, MappedType>> &batch) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (replication < 2) return true;
+  return replicate([&](uint16_t replica) {
+    return replica_put_rpc.async_call(replica, batch);
+  });
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalReplicaErase(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  LocalErase(key);
+  return true;
+}
+
+/**
+ * The reads this server served from copies go to the keys' owners first,
+ * so that keys read mostly through their copies stay hot. Then the hot
+ * keys owned here that cooled down have their copies dropped.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+void unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::end_window() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::map<uint16_t, std::vector<std::pair<KeyType, uint32_t>>> counted;
+  {
+    std::shared_lock<rw_lock> lock(*mutex);
+    for (auto &entry : *hotKeys) {
+      size_t key_hash = keyHash(entry.first);
+      uint32_t count = hot.estimate(key_hash);
+      if (count > 0)
+        counted[server_of(key_hash)].emplace_back(entry.first, count);
+    }
+  }
+  std::vector<RPCFuture<bool>> sent;
+  for (auto &owner : counted) {
+    try {
+      sent.push_back(hot_reads_rpc.async_call(owner.first, owner.second));
+    } catch (const std::exception &e) {
+      HCL_LOG_ERROR("Hot key reads of %s not sent: %s\n", backed_file.c_str(),
+                    e.what());
+    }
+  }
+  for (auto &report : sent) {
+    try {
+      report.get();
+    } catch (const std::exception &e) {
+      HCL_LOG_ERROR("Hot key reads of %s not sent: %s\n", backed_file.c_str(),
+                    e.what());
+    }
+  }
+  std::vector<KeyType> cooled = hot.cool_down();
+  if (!cooled.empty())
+    share_hot(
+        [&](uint16_t server) { return hot_drop_rpc.async_call(server, cooled); });
+}
+
+/**
+ * Sends the latest value of each key, also if a concurrent write got here
+ * first, or drops its copies and demotes it if it is gone.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::share_copies(
+    std::vector<KeyType> &keys) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::vector<std::pair<KeyType, MappedType>> current;
+  std::vector<KeyType> gone;
+  for (auto &key : keys) {
+    std::pair<bool, MappedType> value = LocalGet(key);
+    if (value.first) {
+      current.emplace_back(key, value.second);
+    } else {
+      hot.demote(key);
+      gone.push_back(key);
+    }
+  }
+  bool success = true;
+  if (!current.empty())
+    success = share_hot([&](uint16_t server) {
+      return hot_put_rpc.async_call(server, current);
+    });
+  if (!gone.empty())
+    success = share_hot([&](uint16_t server) {
+                return hot_drop_rpc.async_call(server, gone);
+              }) &&
+              success;
+  return success;
+}
+
+/**
+ * Sends to every other server and waits for them.
+ * @return bool, false if one of them failed.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::share_hot(
+    std::function<RPCFuture<bool>(uint16_t)> send) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  bool success = true;
+  std::vector<RPCFuture<bool>> sent;
+  sent.reserve(num_servers);
+  for (uint16_t server = 0; server < num_servers; ++server) {
+    if (server == my_server_idx) continue;
+    try {
+      sent.push_back(send(server));
+    } catch (const std::exception &e) {
+      HCL_LOG_ERROR("Hot keys of %s not sent to server %d: %s\n",
+                    backed_file.c_str(), server, e.what());
+      success = false;
+    }
+  }
+  for (auto &copy : sent) {
+    try {
+      if (!copy.get()) success = false;
+    } catch (const std::exception &e) {
+      HCL_LOG_ERROR("Hot keys of %s not stored: %s\n", backed_file.c_str(),
+                    e.what());
+      success = false;
+    }
+  }
+  return success;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+std::pair<bool, MappedType>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::hot_copy(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::shared_lock<rw_lock> lock(*mutex);
+  typename MyHashMap::iterator iterator = hotKeys->find(key);
+  if (iterator != hotKeys->end())
+    return std::pair<bool, MappedType>(true, iterator->second);
+  return std::pair<bool, MappedType>(false, MappedType());
+}
+
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalHotPut(
+    std::vector<std::pair<KeyType, MappedType>> &entries) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    for (auto &entry : entries) {
+      auto value = GetData<Allocator, MappedType, SharedType>(entry.second);
+      hotKeys->insert_or_assign(entry.first, value);
+    }
+    return true;
+  });
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalHotDrop(
+    std::vector<KeyType> &keys) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::unique_lock<rw_lock> lock(*mutex);
+  for (auto &key : keys) hotKeys->erase(key);
+  return true;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalHotReads(
+    std::vector<std::pair<KeyType, uint32_t>> &counts) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (!hot.counting()) return false;
+  for (auto &count : counts)
+    hot.add_reads(keyHash(count.first), count.second);
+  return true;
+}
+
+/**
+ * The owner answers as for a Get. Another server answers from its copy and
+ * counts the read, to report it to the owner at the end of the window.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+routed<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalHotGet(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  if (server_of(key_hash) == my_server_idx) return LocalRoutedGet(key);
+  routed<std::pair<bool, MappedType>> reply(hot_copy(key));
+  reply.hot = reply.value.first;
+  if (reply.hot) hot.add_reads(key_hash);
+  return reply;
+}
+
+/**
+ * The lease is counted from before the request was sent, so it ends here
+ * no later than on the server, whatever the clocks of the two.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+std::pair<bool, MappedType>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::cached_get(
+    KeyType &key, size_t key_hash, uint16_t key_int) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::pair<bool, MappedType> result;
+  if (near->find(key, result)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "cache");
+    return result;
+  }
+  HCL_CPP_FUNCTION_UPDATE("access", "remote");
+  HCL_CPP_FUNCTION_UPDATE("server", key_int);
+  flush_puts(key_int);
+  std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+  routed<std::pair<bool, MappedType>> reply =
+      leased_get_rpc.call(key_int, key);
+  if (reply.moved.empty() && reply.lease_ms > 0)
+    near->insert(key, reply.value,
+                 CalculateSize<KeyType>().GetSize(key) +
+                     CalculateSize<MappedType>().GetSize(reply.value.second),
+                 sent + std::chrono::milliseconds(reply.lease_ms));
+  std::function<routed<std::pair<bool, MappedType>>(uint16_t)> resend =
+      [&](uint16_t server) { return leased_get_rpc.call(server, key); };
+  return follow_routes(key_hash, std::move(reply), resend);
+}
+
+/**
+ * The lease is granted before the key is read and withdrawn if a write
+ * started meanwhile, see lease_table.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+routed<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalLeasedGet(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  size_t key_hash = keyHash(key);
+  uint32_t lease_ms = HCL_CONF->NEAR_CACHE_LEASE_MS;
+  bool leased = false;
+  routed<std::pair<bool, MappedType>> reply =
+      serve_routed<std::pair<bool, MappedType>>(key_hash, [&]() {
+        leased = leases != nullptr && leases->grant(key_hash, lease_ms);
+        std::pair<bool, MappedType> result = LocalGet(key);
+        leased = leased && leases->still_valid(key_hash);
+        return result;
+      });
+  if (leased) reply.lease_ms = lease_ms;
+  return reply;
+}
+
+/**
+ * Stores the entries of slots handed over by their old owner and only then
+ * takes the slots, so no request for them is served before they arrived.
+ * @param routes, the slots with this server as owner and their new epoch
+ * @param entries, every entry of those slots
+ * @return bool, true if the entries were stored.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalImport(
+    std::vector<slot_route> &routes,
+    std::vector<std::pair<KeyType, MappedType>> &entries) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (!LocalPutBatch(entries)) return false;
+  learn_routes(routes);
+  return true;
+}
+
+/**
+ * Collects the entries of the group's slots that belong on another server,
+ * sends them there with one _Import per server and, once it has them,
+ * gives their slots up and erases the local copies. Requests for the group
+ * wait on its route lock meanwhile; the other groups are served as usual.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::migrate_group(
+    uint32_t group) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::unique_lock<rw_lock> route_lock(route_stripes[group].mutex);
+  std::map<uint32_t, uint16_t> moving;
+  std::map<uint16_t, std::vector<slot_route>> routes;
+  auto collect = [&]() {
+    moving.clear();
+    routes.clear();
+    for (uint32_t slot = group; slot < partition.slots();
+         slot += num_route_groups) {
+      slot_route route = partition.route_of(slot);
+      uint16_t target = target_of(slot);
+      if (route.owner != my_server_idx || target == my_server_idx) continue;
+      moving[slot] = target;
+      routes[target].push_back(slot_route{slot, target, route.epoch + 1});
+    }
+    return !moving.empty();
+  };
+  if (!collect()) return true;
+  /*
+   * The new owner knows nothing of the leases on the keys it takes, so
+   * they are let run out first. The route lock is let go meanwhile, as the
+   * writes waiting on the same leases may hold it.
+   */
+  std::unique_ptr<lease_pause> paused;
+  if (leases != nullptr) {
+    route_lock.unlock();
+    paused.reset(new lease_pause(leases.get()));
+    route_lock.lock();
+    if (!collect()) return true;
+  }
+  std::map<uint16_t, std::vector<std::pair<KeyType, MappedType>>> entries;
+  for (uint32_t stripe = 0; stripe < num_stripes; ++stripe) {
+    std::shared_lock<rw_lock> lock(stripe_mutex(stripe));
+    for (auto &entry : myHashMap[stripe]) {
+      auto found = moving.find(partition.slot_of(keyHash(entry.first)));
+      if (found != moving.end())
+        entries[found->second].emplace_back(entry.first, entry.second);
+    }
+  }
+  bool moved_all = true;
+  for (auto &target : routes) {
+    auto &batch = entries[target.first];
+    try {
+      if (!import_rpc.call(target.first, target.second, batch)) {
+        moved_all = false;
+        continue;
+      }
+    } catch (const std::exception &e) {
+      HCL_LOG_ERROR("Server %d did not take slots of %s: %s\n", target.first,
+                    backed_file.c_str(), e.what());
+      moved_all = false;
+      continue;
+    }
+    learn_routes(target.second);
+    std::vector<KeyType> keys;
+    keys.reserve(batch.size());
+    for (auto &entry : batch) {
+      LocalErase(entry.first);
+      keys.push_back(entry.first);
+    }
+    /* The new owner does not know they are hot, so drop their copies. */
+    hot.refresh(keys);
+  }
+  return moved_all;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+bool unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::Rebalance(
+    uint16_t servers) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (route_stripes == nullptr || replication > 1 || servers == 0 ||
+      servers > num_servers)
+    return false;
+  start_rebalance(servers);
+  return true;
+}
+
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+void unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::WaitForMigration() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  wait_for_migration();
+}
+
 template <typename KeyType, typename MappedType, typename Hash,
           typename Allocator, typename SharedType>
 std::pair<bool, MappedType>
@@ -162,27 +1132,17 @@ unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::LocalErase(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  if (is_server && !server_on_node) {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
-    typename MyHashMap::iterator iterator = myHashMap->find(key);
-    if (iterator != myHashMap->end()) {
-      size_occupied -= CalculateSize<KeyType>().GetSize(key) +
-                       CalculateSize<MappedType>().GetSize(iterator->second);
-      myHashMap->erase(iterator);
-      return std::pair<bool, MappedType>(true, MappedType());
-    } else
-      return std::pair<bool, MappedType>(false, MappedType());
-  } else {
-    typename MyHashMap::iterator iterator = myHashMap->find(key);
-    if (iterator != myHashMap->end()) {
-      size_occupied -= CalculateSize<KeyType>().GetSize(key) +
-                       CalculateSize<MappedType>().GetSize(iterator->second);
-      myHashMap->erase(iterator);
-      return std::pair<bool, MappedType>(true, MappedType());
-    } else
-      return std::pair<bool, MappedType>(false, MappedType());
-  }
+  uint32_t stripe = stripe_of(keyHash(key));
+  MyHashMap &table = myHashMap[stripe];
+  std::unique_lock<rw_lock> lock(stripe_mutex(stripe));
+  typename MyHashMap::iterator iterator = table.find(key);
+  if (iterator != table.end()) {
+    size_occupied -= CalculateSize<KeyType>().GetSize(key) +
+                     CalculateSize<MappedType>().GetSize(iterator->second);
+    table.erase(iterator);
+    return std::pair<bool, MappedType>(true, MappedType());
+  } else
+    return std::pair<bool, MappedType>(false, MappedType());
 }
 
 template <typename KeyType, typename MappedType, typename Hash,
@@ -191,21 +1151,57 @@ std::pair<bool, MappedType> unordered_map<KeyType, MappedType, Hash, Allocator,
                                           SharedType>::Erase(KeyType &key) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
+  if (near != nullptr) near->erase(key);
   size_t key_hash = keyHash(key);
-  uint16_t key_int = static_cast<uint16_t>(key_hash % num_servers);
-  if (is_local(key_int)) {
+  uint16_t key_int = server_of(key_hash);
+  std::function<routed<std::pair<bool, MappedType>>(uint16_t)> resend =
+      [&](uint16_t server) { return erase_rpc.call(server, key); };
+  if (writes_locally(key_int)) {
     HCL_CPP_FUNCTION_UPDATE("access", "local");
-    return LocalErase(key);
+    return follow_routes(key_hash, LocalRoutedErase(key), resend);
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Erase", key_int, ret_type, key);
+    flush_puts(key_int);
+    return follow_routes(key_hash, resend(key_int), resend);
     // return rpc->call(key_int, func_prefix+"_Erase",
     //                  key).template as<std::pair<bool, MappedType>>();
   }
 }
 
+/**
+ * Erase the key from the unordered map without waiting for the remote server.
+ * @param key, key to erase
+ * @return RPCFuture of the pair returned by Erase.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+RPCFuture<std::pair<bool, MappedType>>
+unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::AsyncErase(
+    KeyType &key) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (near != nullptr) near->erase(key);
+  size_t key_hash = keyHash(key);
+  uint16_t key_int = server_of(key_hash);
+  typedef std::pair<bool, MappedType> ret_type;
+  std::function<routed<ret_type>(uint16_t)> resend =
+      [this, key](uint16_t server) mutable {
+        return erase_rpc.call(server, key);
+      };
+  if (writes_locally(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<ret_type>(
+        follow_routes(key_hash, LocalRoutedErase(key), resend));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    flush_puts(key_int);
+    return follow_routes(key_hash, erase_rpc.async_call(key_int, key),
+                         resend);
+  }
+}
+
 template <typename KeyType, typename MappedType, typename Hash,
           typename Allocator, typename SharedType>
 std::vector<std::pair<KeyType, MappedType>>
@@ -214,22 +1210,32 @@ unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::GetAllData() {
   HCL_CPP_FUNCTION()
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
-  auto current_server = GetAllDataInServer();
-  final_values.insert(final_values.end(), current_server.begin(),
-                      current_server.end());
-  for (int i = 0; i < num_servers; ++i) {
-    if (i != my_server_idx) {
-      HCL_CPP_REGION(GetAllDataServer)
-      HCL_CPP_REGION_UPDATE(GetAllDataServer, "access", "remote");
-      HCL_CPP_REGION_UPDATE(GetAllDataServer, "server", i);
-      typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
-      auto server = RPC_CALL_WRAPPER1("_GetAllData", i, ret_type);
-      final_values.insert(final_values.end(), server.begin(), server.end());
-    }
-  }
+  GetAllData(
+      [&final_values](std::vector<std::pair<KeyType, MappedType>> &values) {
+        final_values.insert(final_values.end(), values.begin(), values.end());
+      });
   return final_values;
 }
 
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+void unordered_map<KeyType, MappedType, Hash, Allocator,
+                   SharedType>::GetAllData(
+    std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+        on_server) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  Flush();
+  scatter_gather<std::vector<std::pair<KeyType, MappedType>>>(
+      [&](uint16_t server) {
+        HCL_CPP_REGION(GetAllDataServer)
+        HCL_CPP_REGION_UPDATE(GetAllDataServer, "access", "remote");
+        HCL_CPP_REGION_UPDATE(GetAllDataServer, "server", server);
+        return get_all_data_rpc.async_call(server);
+      },
+      [&]() { return GetAllDataInServer(); }, on_server);
+}
+
 template <typename KeyType, typename MappedType, typename Hash,
           typename Allocator, typename SharedType>
 std::vector<std::pair<KeyType, MappedType>>
@@ -241,15 +1247,14 @@ unordered_map<KeyType, MappedType, Hash, Allocator,
   std::vector<std::pair<KeyType, MappedType>> final_values =
       std::vector<std::pair<KeyType, MappedType>>();
   {
-    boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex>
-        lock(*mutex);
-    typename MyHashMap::iterator lower_bound;
-    if (myHashMap->size() > 0) {
-      lower_bound = myHashMap->begin();
-      while (lower_bound != myHashMap->end()) {
-        final_values.push_back(std::pair<KeyType, MappedType>(
-            lower_bound->first, lower_bound->second));
-        lower_bound++;
+    all_stripes_lock lock(this, true);
+    for (uint32_t stripe = 0; stripe < num_stripes; ++stripe) {
+      for (auto &entry : myHashMap[stripe]) {
+        /* Copies kept for other servers are reported by their owners. */
+        if (replication > 1 && server_of(keyHash(entry.first)) != my_server_idx)
+          continue;
+        final_values.push_back(
+            std::pair<KeyType, MappedType>(entry.first, entry.second));
       }
     }
   }
@@ -266,14 +1271,50 @@ std::vector<std::pair<KeyType, MappedType>> unordered_map<
     HCL_CPP_FUNCTION_UPDATE("access", "local");
     return LocalGetAllDataInServer();
   } else {
-    typedef std::vector<std::pair<KeyType, MappedType>> ret_type;
     auto my_server_i = my_server_idx;
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("server", my_server_i);
-    return RPC_CALL_WRAPPER1("_GetAllData", my_server_i, ret_type);
+    flush_puts(my_server_i);
+    return get_all_data_rpc.call(my_server_i);
   }
 }
 
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+/**
+ * Server side of the RDMA Put. The value is pulled from the client straight
+ * into the elements the table keeps and then moved into the table, so the
+ * stripe lock is never held while the transfer is in flight and the value
+ * is not copied on the server.
+ */
+template <typename KeyType, typename MappedType, typename Hash,
+          typename Allocator, typename SharedType>
+void unordered_map<KeyType, MappedType, Hash, Allocator, SharedType>::
+    ThalliumLocalPutBulk(const tl::request &thallium_req, KeyType &key,
+                         tl::bulk &bulk) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  BulkBuffer<MappedType> buffer;
+  MappedType data;
+  buffer.Resize(data, bulk.size());
+  tl::bulk local = rpc->expose(buffer.Data(data), buffer.GetSize(data),
+                               tl::bulk_mode::write_only);
+  bulk.on(thallium_req.get_endpoint()) >> local;
+  size_t key_hash = keyHash(key);
+  lease_hold hold(leases.get(), key_hash);
+  uint64_t ticket = 0;
+  routed<bool> reply = serve_routed<bool>(key_hash, [&]() {
+    /* Replicas are sent the value before it is moved into the table. */
+    bool success = replicate_put(key, data);
+    success = put_owned(key, data) && success;
+    std::vector<KeyType> keys(1, key);
+    ticket = hot.refresh(keys);
+    return success;
+  });
+  reply.value = hot.wait(ticket) && reply.value;
+  thallium_req.respond(reply);
+}
+#endif
+
 template <typename KeyType, typename MappedType, typename Hash,
           typename Allocator, typename SharedType>
 void unordered_map<KeyType, MappedType, Hash, Allocator,
@@ -285,6 +1326,14 @@ void unordered_map<KeyType, MappedType, Hash, Allocator,
       res;
   res = segment.find<MyHashMap>(name.c_str());
   myHashMap = res.first;
+  hotKeys =
+      segment.find<MyHashMap>((std::string(name.c_str()) + "_hot").c_str())
+          .first;
+  /* A restarted server no longer forwards writes to the copies it holds. */
+  if (is_server) {
+    std::unique_lock<rw_lock> lock(*mutex);
+    hotKeys->clear();
+  }
 }
 
 template <typename KeyType, typename MappedType, typename Hash,
@@ -295,7 +1344,6 @@ void unordered_map<KeyType, MappedType, Hash, Allocator,
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
 
-  auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
     case THALLIUM:
@@ -305,35 +1353,126 @@ void unordered_map<KeyType, MappedType, Hash, Allocator,
 
       std::function<void(const tl::request &, KeyType &, MappedType &)> putFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::ThalliumLocalPut,
+                                   SharedType>::ThalliumLocalRoutedPut,
                     this, std::placeholders::_1, std::placeholders::_2,
                     std::placeholders::_3));
-      // std::function<void(const tl::request &, tl::bulk &, KeyType &)>
-      // putFunc(
-      //     std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-      //     SharedType>::ThalliumLocalPut, this,
-      //               std::placeholders::_1, std::placeholders::_2,
-      //               std::placeholders::_3));
+      std::function<void(const tl::request &, KeyType &, tl::bulk &)>
+          putBulkFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator,
+                             SharedType>::ThalliumLocalPutBulk,
+              this, std::placeholders::_1, std::placeholders::_2,
+              std::placeholders::_3));
       std::function<void(const tl::request &, KeyType &)> getFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::ThalliumLocalGet,
+                                   SharedType>::ThalliumLocalRoutedGet,
                     this, std::placeholders::_1, std::placeholders::_2));
       std::function<void(const tl::request &, KeyType &)> eraseFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
-                                   SharedType>::ThalliumLocalErase,
+                                   SharedType>::ThalliumLocalRoutedErase,
                     this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &,
+                         std::vector<std::pair<KeyType, MappedType>> &)>
+          putBatchFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator,
+                             SharedType>::ThalliumLocalRoutedPutBatch,
+              this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, std::vector<KeyType> &)>
+          getBatchFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator,
+                             SharedType>::ThalliumLocalRoutedGetBatch,
+              this, std::placeholders::_1, std::placeholders::_2));
       std::function<void(const tl::request &)> getAllDataInServerFunc(
           std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
                                    SharedType>::ThalliumLocalGetAllDataInServer,
                     this, std::placeholders::_1));
+      std::function<void(const tl::request &, std::vector<slot_route> &,
+                         std::vector<std::pair<KeyType, MappedType>> &)>
+          importFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator,
+                             SharedType>::ThalliumLocalImport,
+              this, std::placeholders::_1, std::placeholders::_2,
+              std::placeholders::_3));
+      std::function<void(const tl::request &,
+                         std::vector<std::pair<KeyType, MappedType>> &)>
+          replicaPutFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator,
+                             SharedType>::ThalliumLocalPutBatch,
+              this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, KeyType &)> replicaEraseFunc(
+          std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
+                                   SharedType>::ThalliumLocalReplicaErase,
+                    this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, KeyType &)> replicaGetFunc(
+          std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
+                                   SharedType>::ThalliumLocalGet,
+                    this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &,
+                         std::vector<std::pair<KeyType, MappedType>> &)>
+          hotPutFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator,
+                             SharedType>::ThalliumLocalHotPut,
+              this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, std::vector<KeyType> &)>
+          hotDropFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator,
+                             SharedType>::ThalliumLocalHotDrop,
+              this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &,
+                         std::vector<std::pair<KeyType, uint32_t>> &)>
+          hotReadsFunc(std::bind(
+              &unordered_map<KeyType, MappedType, Hash, Allocator,
+                             SharedType>::ThalliumLocalHotReads,
+              this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, KeyType &)> hotGetFunc(
+          std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
+                                   SharedType>::ThalliumLocalHotGet,
+                    this, std::placeholders::_1, std::placeholders::_2));
+      std::function<void(const tl::request &, KeyType &)> leasedGetFunc(
+          std::bind(&unordered_map<KeyType, MappedType, Hash, Allocator,
+                                   SharedType>::ThalliumLocalLeasedGet,
+                    this, std::placeholders::_1, std::placeholders::_2));
 
       rpc->bind(func_prefix + "_Put", putFunc);
       rpc->bind(func_prefix + "_Get", getFunc);
       rpc->bind(func_prefix + "_Erase", eraseFunc);
       rpc->bind(func_prefix + "_GetAllData", getAllDataInServerFunc);
+      rpc->bind(func_prefix + "_PutBatch", putBatchFunc);
+      rpc->bind(func_prefix + "_GetBatch", getBatchFunc);
+      rpc->bind(func_prefix + "_PutBulk", putBulkFunc);
+      rpc->bind(func_prefix + "_Import", importFunc);
+      rpc->bind(func_prefix + "_ReplicaPut", replicaPutFunc);
+      rpc->bind(func_prefix + "_ReplicaErase", replicaEraseFunc);
+      rpc->bind(func_prefix + "_ReplicaGet", replicaGetFunc);
+      rpc->bind(func_prefix + "_HotPut", hotPutFunc);
+      rpc->bind(func_prefix + "_HotDrop", hotDropFunc);
+      rpc->bind(func_prefix + "_HotReads", hotReadsFunc);
+      rpc->bind(func_prefix + "_HotGet", hotGetFunc);
+      rpc->bind(func_prefix + "_LeasedGet", leasedGetFunc);
+      break;
+    }
+#endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      bind_loopback("_Put", &unordered_map::LocalRoutedPut);
+      bind_loopback("_Get", &unordered_map::LocalRoutedGet);
+      bind_loopback("_Erase", &unordered_map::LocalRoutedErase);
+      bind_loopback("_GetAllData", &unordered_map::LocalGetAllDataInServer);
+      bind_loopback("_PutBatch", &unordered_map::LocalRoutedPutBatch);
+      bind_loopback("_GetBatch", &unordered_map::LocalRoutedGetBatch);
+      bind_loopback("_Import", &unordered_map::LocalImport);
+      bind_loopback("_ReplicaPut", &unordered_map::LocalPutBatch);
+      bind_loopback("_ReplicaErase", &unordered_map::LocalReplicaErase);
+      bind_loopback("_ReplicaGet", &unordered_map::LocalGet);
+      bind_loopback("_HotPut", &unordered_map::LocalHotPut);
+      bind_loopback("_HotDrop", &unordered_map::LocalHotDrop);
+      bind_loopback("_HotReads", &unordered_map::LocalHotReads);
+      bind_loopback("_HotGet", &unordered_map::LocalHotGet);
+      bind_loopback("_LeasedGet", &unordered_map::LocalLeasedGet);
       break;
     }
 #endif
+    default:
+      break;
   }
 }
 
@@ -18,15 +18,22 @@
  * Include Headers
  */
 #include <hcl/common/container.h>
+#include <hcl/common/hot_keys.h>
+#include <hcl/common/lease_table.h>
+#include <hcl/common/near_cache.h>
 #include <hcl/common/singleton.h>
 #include <hcl/common/typedefs.h>
 #include <hcl/communication/rpc_lib.h>
 #include <hcl/hcl_internal.h>
 
 /** Standard C++ Headers**/
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <scoped_allocator>
 #include <stdexcept>
 #include <string>
@@ -60,8 +67,8 @@ class unordered_map : public container {
  private:
   /** Class Typedefs for ease of use **/
   typedef std::pair<const KeyType, MappedType> ValueType;
-  typedef std::scoped_allocator_adaptor<boost::interprocess::allocator<
-      ValueType, boost::interprocess::managed_mapped_file::segment_manager>>
+  typedef std::scoped_allocator_adaptor<
+      node_allocator<Allocator, ValueType>>
       ShmemAllocator;
   typedef boost::interprocess::managed_mapped_file managed_segment;
   typedef boost::unordered::unordered_map<
@@ -69,10 +76,75 @@ class unordered_map : public container {
       MyHashMap;
   /** Class attributes**/
   Hash keyHash;
+  /** One table per lock stripe, so stripes never share a bucket array **/
   MyHashMap *myHashMap;
+  /** Remote procedures **/
+  rpc_handle<routed<bool>(KeyType, MappedType)> put_rpc;
+  rpc_handle<routed<std::pair<bool, MappedType>>(KeyType)> get_rpc;
+  rpc_handle<routed<std::pair<bool, MappedType>>(KeyType)> erase_rpc;
+  rpc_handle<std::vector<std::pair<KeyType, MappedType>>()> get_all_data_rpc;
+  rpc_handle<routed<bool>(std::vector<std::pair<KeyType, MappedType>>)>
+      put_batch_rpc;
+  rpc_handle<routed<std::vector<std::pair<bool, MappedType>>>(
+      std::vector<KeyType>)>
+      get_batch_rpc;
+  rpc_handle<bool(std::vector<slot_route>,
+                  std::vector<std::pair<KeyType, MappedType>>)>
+      import_rpc;
+  rpc_handle<bool(std::vector<std::pair<KeyType, MappedType>>)>
+      replica_put_rpc;
+  rpc_handle<bool(KeyType)> replica_erase_rpc;
+  rpc_handle<std::pair<bool, MappedType>(KeyType)> replica_get_rpc;
+  rpc_handle<bool(std::vector<std::pair<KeyType, MappedType>>)> hot_put_rpc;
+  rpc_handle<bool(std::vector<KeyType>)> hot_drop_rpc;
+  rpc_handle<bool(std::vector<std::pair<KeyType, uint32_t>>)> hot_reads_rpc;
+  rpc_handle<routed<std::pair<bool, MappedType>>(KeyType)> hot_get_rpc;
+  rpc_handle<routed<std::pair<bool, MappedType>>(KeyType)> leased_get_rpc;
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+  rpc_handle<routed<bool>(KeyType, tl::bulk)> put_bulk_rpc;
+#endif
+
+  /** Puts waiting to be sent to each server **/
+  request_batch<std::pair<KeyType, MappedType>> put_batch;
+  /** Next stripe to compact, and the next bucket in it **/
+  uint32_t compact_stripe;
+  size_t compact_bucket;
+  /** Copies of the hot keys of the other servers, guarded by mutex **/
+  MyHashMap *hotKeys;
+  /**
+   * Hot keys owned here, counted on servers with HOT_KEY_THRESHOLD set, and
+   * those this client was told about
+   */
+  hot_keys<KeyType, Hash> hot;
+  /** Remote Get results kept by this client, with NEAR_CACHE_BYTES set **/
+  std::unique_ptr<near_cache<KeyType, std::pair<bool, MappedType>, Hash>> near;
+  /** Read leases this server granted on its keys **/
+  std::unique_ptr<lease_table> leases;
+
+  bool use_bulk(MappedType &data);
+  bool put_owned(KeyType &key, MappedType &data);
+  bool flush_puts(uint16_t server_index);
+  bool send_puts(uint16_t server_index,
+                 std::vector<std::pair<KeyType, MappedType>> &batch);
+  /** Rebuilds one stripe's table per slice. */
+  bool compact_slice(bool restart) override;
+  /** Hands the entries of a group's outgoing slots to their new owners. */
+  bool migrate_group(uint32_t group) override;
+  /** Forward writes applied here to the other replicas of their keys. */
+  bool replicate_put(KeyType &key, MappedType &data);
+  bool replicate_puts(std::vector<std::pair<KeyType, MappedType>> &batch);
+  /** Reports the reads of copies and demotes at the end of a window. */
+  void end_window();
+  /** Sends the copies of hot keys written or promoted, for hot. */
+  bool share_copies(std::vector<KeyType> &keys);
+  bool share_hot(std::function<RPCFuture<bool>(uint16_t)> send);
+  std::pair<bool, MappedType> hot_copy(KeyType &key);
+  /** Get through the near cache, filling it under a lease on a miss. */
+  std::pair<bool, MappedType> cached_get(KeyType &key, size_t key_hash,
+                                         uint16_t key_int);
 
  public:
-  really_long size_occupied;
+  std::atomic<really_long> size_occupied;
   ~unordered_map();
 
   explicit unordered_map(
@@ -84,20 +156,43 @@ class unordered_map : public container {
       bool _is_server = HCL_CONF->IS_SERVER,
       bool _is_server_on_node = HCL_CONF->SERVER_ON_NODE,
       CharStruct _backed_file_dir = HCL_CONF->BACKED_FILE_DIR);
-  MyHashMap *data() {
+  /**
+   * @return MyHashMap *, the table of the first lock stripe, or nullptr if
+   * it is not mapped here. It holds every local key only with
+   * LOCK_STRIPES set to 1.
+   */
+  [[deprecated("holds one lock stripe only, use stripes()")]] MyHashMap *
+  data() {
     HCL_LOG_TRACE();
     HCL_CPP_FUNCTION()
-    if (server_on_node || is_server)
-      return myHashMap;
-    else
-      nullptr;
+    if (server_on_node || is_server) return myHashMap;
+    return nullptr;
+  }
+  /**
+   * @return std::vector<MyHashMap *>, the num_stripes tables that together
+   * hold the local data, one per lock stripe, or none if they are not
+   * mapped here.
+   */
+  std::vector<MyHashMap *> stripes() {
+    HCL_LOG_TRACE();
+    HCL_CPP_FUNCTION()
+    std::vector<MyHashMap *> tables;
+    if (server_on_node || is_server) {
+      for (uint32_t i = 0; i < num_stripes; ++i)
+        tables.push_back(myHashMap + i);
+    }
+    return tables;
   }
 
   void construct_shared_memory() override {
-    /* Construct unordered_map in the shared memory space. */
-    myHashMap = segment.construct<MyHashMap>(name.c_str())(
-        128, Hash(), std::equal_to<KeyType>(),
-        segment.get_allocator<ValueType>());
+    /* Construct one unordered_map per lock stripe in the shared memory. */
+    myHashMap = construct_named_array<MyHashMap>(
+        name.c_str(), num_stripes, 128, Hash(), std::equal_to<KeyType>(),
+        ShmemAllocator(allocator_of<ValueType, Allocator>()));
+    hotKeys = construct_named<MyHashMap>(
+        (std::string(name.c_str()) + "_hot").c_str(), 16, Hash(),
+        std::equal_to<KeyType>(),
+        ShmemAllocator(allocator_of<ValueType, Allocator>()));
   }
 
   void open_shared_memory() override;
@@ -108,19 +203,96 @@ class unordered_map : public container {
   std::pair<bool, MappedType> LocalGet(KeyType &key);
   std::pair<bool, MappedType> LocalErase(KeyType &key);
   std::vector<std::pair<KeyType, MappedType>> LocalGetAllDataInServer();
+  bool LocalPutBatch(std::vector<std::pair<KeyType, MappedType>> &batch);
+  std::vector<std::pair<bool, MappedType>> LocalGetBatch(
+      std::vector<KeyType> &keys);
+  /** Server side of the keyed procedures, checked against the routing. */
+  routed<bool> LocalRoutedPut(KeyType &key, MappedType &data);
+  routed<std::pair<bool, MappedType>> LocalRoutedGet(KeyType &key);
+  routed<std::pair<bool, MappedType>> LocalRoutedErase(KeyType &key);
+  routed<bool> LocalRoutedPutBatch(
+      std::vector<std::pair<KeyType, MappedType>> &batch);
+  routed<std::vector<std::pair<bool, MappedType>>> LocalRoutedGetBatch(
+      std::vector<KeyType> &keys);
+  /** Takes over slots from their old owner, with their entries. */
+  bool LocalImport(std::vector<slot_route> &routes,
+                   std::vector<std::pair<KeyType, MappedType>> &entries);
+  /** Erase forwarded by the owner of key to this replica. */
+  bool LocalReplicaErase(KeyType &key);
+  /** Copies of hot keys sent by their owner, to store or drop. */
+  bool LocalHotPut(std::vector<std::pair<KeyType, MappedType>> &entries);
+  bool LocalHotDrop(std::vector<KeyType> &keys);
+  /** Reads of the owner's hot keys served by another server. */
+  bool LocalHotReads(std::vector<std::pair<KeyType, uint32_t>> &counts);
+  /** Read of a hot key from any server; hot is unset if it has no copy. */
+  routed<std::pair<bool, MappedType>> LocalHotGet(KeyType &key);
+  /** Get that grants a lease on the key, if no write of it is waiting. */
+  routed<std::pair<bool, MappedType>> LocalLeasedGet(KeyType &key);
 
 #if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
-  THALLIUM_DEFINE(LocalPut, (key, data), KeyType &key, MappedType &data)
-  THALLIUM_DEFINE(LocalGet, (key), KeyType &key)
-  THALLIUM_DEFINE(LocalErase, (key), KeyType &key)
+  THALLIUM_DEFINE(LocalRoutedPut, (key, data), KeyType &key, MappedType &data)
+  THALLIUM_DEFINE(LocalRoutedGet, (key), KeyType &key)
+  THALLIUM_DEFINE(LocalRoutedErase, (key), KeyType &key)
   THALLIUM_DEFINE1(LocalGetAllDataInServer)
+  THALLIUM_DEFINE(LocalRoutedPutBatch, (batch),
+                  std::vector<std::pair<KeyType, MappedType>> &batch)
+  THALLIUM_DEFINE(LocalRoutedGetBatch, (keys), std::vector<KeyType> &keys)
+  THALLIUM_DEFINE(LocalImport, (routes, entries),
+                  std::vector<slot_route> &routes,
+                  std::vector<std::pair<KeyType, MappedType>> &entries)
+  THALLIUM_DEFINE(LocalPutBatch, (batch),
+                  std::vector<std::pair<KeyType, MappedType>> &batch)
+  THALLIUM_DEFINE(LocalReplicaErase, (key), KeyType &key)
+  THALLIUM_DEFINE(LocalGet, (key), KeyType &key)
+  THALLIUM_DEFINE(LocalHotPut, (entries),
+                  std::vector<std::pair<KeyType, MappedType>> &entries)
+  THALLIUM_DEFINE(LocalHotDrop, (keys), std::vector<KeyType> &keys)
+  THALLIUM_DEFINE(LocalHotReads, (counts),
+                  std::vector<std::pair<KeyType, uint32_t>> &counts)
+  THALLIUM_DEFINE(LocalHotGet, (key), KeyType &key)
+  THALLIUM_DEFINE(LocalLeasedGet, (key), KeyType &key)
+  void ThalliumLocalPutBulk(const tl::request &thallium_req, KeyType &key,
+                            tl::bulk &bulk);
 #endif
 
   bool Put(KeyType key, MappedType data);
   std::pair<bool, MappedType> Get(KeyType &key);
   std::pair<bool, MappedType> Erase(KeyType &key);
+  RPCFuture<bool> AsyncPut(KeyType &key, MappedType &data);
+  RPCFuture<std::pair<bool, MappedType>> AsyncGet(KeyType &key);
+  RPCFuture<std::pair<bool, MappedType>> AsyncErase(KeyType &key);
+  std::vector<std::pair<bool, MappedType>> GetBatch(
+      std::vector<KeyType> &keys);
+  bool Flush();
+  /**
+   * Durability barrier for write-behind mode: sends every buffered Put and
+   * waits for the servers. On a server it also waits for the writes it
+   * forwards to replicas in REPLICATION_ASYNC mode.
+   * @return bool, false if this or an earlier background send failed.
+   */
+  bool Quiesce();
   std::vector<std::pair<KeyType, MappedType>> GetAllData();
+  /**
+   * Streams the result: on_server is called once for each server, local
+   * part first and then as the concurrent requests complete.
+   */
+  void GetAllData(
+      std::function<void(std::vector<std::pair<KeyType, MappedType>> &)>
+          on_server);
   std::vector<std::pair<KeyType, MappedType>> GetAllDataInServer();
+  /**
+   * Moves slots so that the first servers own them all, e.g. after a
+   * server joined at the end of the server list or before the last one
+   * leaves. Every server must be asked; each moves the slots it owns in the
+   * background while it keeps serving the others. Clients with an old
+   * routing table are told where a slot went and follow it.
+   * @param servers, servers that own slots afterwards
+   * @return bool, false on a client, without PARTITION_SLOTS or if servers
+   * is not in [1, num_servers].
+   */
+  bool Rebalance(uint16_t servers);
+  /** Blocks until this server has moved the slots of every Rebalance. */
+  void WaitForMigration();
 };
 
 #include "unordered_map.cpp"
@@ -11,9 +11,7 @@
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 template <typename MappedType, typename Allocator, typename SharedType>
-vector<MappedType, Allocator, SharedType>::~vector() {
-  this->container::~container();
-}
+vector<MappedType, Allocator, SharedType>::~vector() {}
 template <typename MappedType, typename Allocator, typename SharedType>
 vector<MappedType, Allocator, SharedType>::vector(
     CharStruct name_, uint16_t port, uint16_t _num_servers,
@@ -25,11 +23,17 @@ vector<MappedType, Allocator, SharedType>::vector(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   if (is_server) {
-    construct_shared_memory();
+    if (attach_type(typeid(*this).name()))
+      open_shared_memory();
+    else
+      construct_shared_memory();
     bind_functions();
   } else if (!is_server && server_on_node) {
     open_shared_memory();
   }
+  define_rpc_handle(push_rpc, "_Push");
+  define_rpc_handle(get_rpc, "_Get");
+  define_rpc_handle(size_rpc, "_Size");
 }
 
 /**
@@ -43,10 +47,12 @@ bool vector<MappedType, Allocator, SharedType>::LocalPush(MappedType &data) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
-  auto value = GetData<Allocator, MappedType, SharedType>(data);
-  my_vector->push_back(std::move(value));
-  return true;
+  return growing([&]() {
+    std::unique_lock<rw_lock> lock(*mutex);
+    auto value = GetData<Allocator, MappedType, SharedType>(data);
+    my_vector->push_back(std::move(value));
+    return true;
+  });
 }
 
 /**
@@ -66,7 +72,28 @@ bool vector<MappedType, Allocator, SharedType>::Push(MappedType &data,
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    return RPC_CALL_WRAPPER("_Push", key_int, bool, data);
+    return push_rpc.call(key_int, data);
+  }
+}
+
+/**
+ * Push the data into the vector without waiting for the remote server.
+ * @param data, the value for push
+ * @param key_int, key_int to know which server
+ * @return RPCFuture<bool>, handle that yields true once Push was successful.
+ */
+template <typename MappedType, typename Allocator, typename SharedType>
+RPCFuture<bool> vector<MappedType, Allocator, SharedType>::AsyncPush(
+    MappedType &data, uint16_t &key_int) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (is_local(key_int)) {
+    HCL_CPP_FUNCTION_UPDATE("access", "local");
+    return RPCFuture<bool>(LocalPush(data));
+  } else {
+    HCL_CPP_FUNCTION_UPDATE("access", "remote");
+    HCL_CPP_FUNCTION_UPDATE("server", key_int);
+    return push_rpc.async_call(key_int, data);
   }
 }
 
@@ -82,7 +109,7 @@ std::pair<bool, MappedType> vector<MappedType, Allocator, SharedType>::LocalGet(
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   if (my_vector->size() > index) {
     MappedType value = my_vector->at(index);
     return std::pair<bool, MappedType>(true, value);
@@ -108,8 +135,7 @@ std::pair<bool, MappedType> vector<MappedType, Allocator, SharedType>::Get(
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    typedef std::pair<bool, MappedType> ret_type;
-    return RPC_CALL_WRAPPER("_Get", key_int, ret_type, index);
+    return get_rpc.call(key_int, index);
   }
 }
 
@@ -122,7 +148,7 @@ template <typename MappedType, typename Allocator, typename SharedType>
 size_t vector<MappedType, Allocator, SharedType>::LocalSize() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  bip::scoped_lock<bip::interprocess_mutex> lock(*mutex);
+  std::shared_lock<rw_lock> lock(*mutex);
   size_t value = my_vector->size();
   return value;
 }
@@ -142,7 +168,7 @@ size_t vector<MappedType, Allocator, SharedType>::Size(uint16_t &key_int) {
   } else {
     HCL_CPP_FUNCTION_UPDATE("access", "remote");
     HCL_CPP_FUNCTION_UPDATE("access", key_int);
-    return RPC_CALL_WRAPPER1("_Size", key_int, size_t);
+    return size_rpc.call(key_int);
   }
 }
 
@@ -151,9 +177,9 @@ void vector<MappedType, Allocator, SharedType>::construct_shared_memory() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  ShmemAllocator alloc_inst(segment.get_segment_manager());
+  ShmemAllocator alloc_inst(allocator_of<MappedType, Allocator>());
   /* Construct vector in the shared memory space. */
-  my_vector = segment.construct<Vector>("Vector")(alloc_inst);
+  my_vector = construct_named<Vector>("Vector", alloc_inst);
 }
 
 template <typename MappedType, typename Allocator, typename SharedType>
@@ -171,7 +197,6 @@ void vector<MappedType, Allocator, SharedType>::bind_functions() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   HCL_CPP_FUNCTION_UPDATE("access", "local");
-  auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
   /* Create a RPC server and map the methods to it. */
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
 #ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
@@ -194,6 +219,16 @@ void vector<MappedType, Allocator, SharedType>::bind_functions() {
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      bind_loopback("_Push", &vector::LocalPush);
+      bind_loopback("_Get", &vector::LocalGet);
+      bind_loopback("_Size", &vector::LocalSize);
+      break;
+    }
+#endif
+    default:
+      break;
   }
 }
 // template class vector<int>;
@@ -56,12 +56,16 @@ class vector : public container {
  private:
   /** Class Typedefs for ease of use **/
   typedef std::scoped_allocator_adaptor<
-      bip::allocator<MappedType, bip::managed_mapped_file::segment_manager>>
+      node_allocator<Allocator, MappedType>>
       ShmemAllocator;
   typedef boost::interprocess::vector<MappedType, ShmemAllocator> Vector;
 
   /** Class attributes**/
   Vector *my_vector;
+  /** Remote procedures **/
+  rpc_handle<bool(MappedType)> push_rpc;
+  rpc_handle<std::pair<bool, MappedType>(size_t)> get_rpc;
+  rpc_handle<size_t()> size_rpc;
 
  public:
   ~vector();
@@ -87,7 +91,7 @@ class vector : public container {
     if (server_on_node || is_server)
       return my_vector;
     else
-      nullptr;
+      return nullptr;
   }
   bool LocalPush(MappedType &data);
   std::pair<bool, MappedType> LocalGet(size_t index);
@@ -100,6 +104,7 @@ class vector : public container {
 #endif
 
   bool Push(MappedType &data, uint16_t &key_int);
+  RPCFuture<bool> AsyncPush(MappedType &data, uint16_t &key_int);
   std::pair<bool, MappedType> Get(size_t index, uint16_t &key_int);
   size_t Size(uint16_t &key_int);
 };
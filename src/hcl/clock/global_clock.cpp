@@ -2,7 +2,13 @@
 
 namespace hcl {
 global_clock::~global_clock() {
-  if (is_server) bip::file_mapping::remove(backed_file.c_str());
+  if (!is_server) return;
+  if (node != nullptr) {
+    node->destroy<chrono_time>(name + "_Time");
+    node->destroy<bip::interprocess_mutex>(name + "_mtx");
+  } else {
+    bip::file_mapping::remove(backed_file.c_str());
+  }
 }
 
 global_clock::global_clock(std::string name_, uint16_t _port)
@@ -11,6 +17,10 @@ global_clock::global_clock(std::string name_, uint16_t _port)
       num_servers(HCL_CONF->NUM_SERVERS),
       my_server(HCL_CONF->MY_SERVER),
       segment(),
+      /* Remote clients have no node segment to open. */
+      node(HCL_CONF->IS_SERVER || HCL_CONF->SERVER_ON_NODE
+               ? hcl::HCL::GetInstance(false)->GetNodeSegment()
+               : nullptr),
       name(name_),
       func_prefix(name_),
       port(_port),
@@ -33,14 +43,37 @@ global_clock::global_clock(std::string name_, uint16_t _port)
         break;
       }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+      case LOOPBACK: {
+        std::function<HTime()> getTimeFunction(
+            std::bind(&global_clock::LocalGetTime, this));
+        rpc->bind_loopback(my_server, func_prefix + "_GetTime",
+                           getTimeFunction);
+        break;
+      }
+#endif
+      default:
+        break;
     }
 
-    bip::file_mapping::remove(backed_file.c_str());
-    segment =
-        bip::managed_mapped_file(bip::create_only, backed_file.c_str(), 65536);
-    start = segment.construct<chrono_time>("Time")(
-        std::chrono::high_resolution_clock::now());
-    mutex = segment.construct<boost::interprocess::interprocess_mutex>("mtx")();
+    if (node != nullptr) {
+      node->destroy<chrono_time>(name + "_Time");
+      node->destroy<bip::interprocess_mutex>(name + "_mtx");
+      start = node->construct<chrono_time>(
+          name + "_Time", std::chrono::high_resolution_clock::now());
+      mutex = node->construct<bip::interprocess_mutex>(name + "_mtx");
+    } else {
+      bip::file_mapping::remove(backed_file.c_str());
+      segment = bip::managed_mapped_file(bip::create_only, backed_file.c_str(),
+                                         65536);
+      start = segment.construct<chrono_time>("Time")(
+          std::chrono::high_resolution_clock::now());
+      mutex =
+          segment.construct<boost::interprocess::interprocess_mutex>("mtx")();
+    }
+  } else if (!is_server && server_on_node && node != nullptr) {
+    start = node->find<chrono_time>(name + "_Time");
+    mutex = node->find<bip::interprocess_mutex>(name + "_mtx");
   } else if (!is_server && server_on_node) {
     segment = bip::managed_mapped_file(bip::open_only, backed_file.c_str());
     std::pair<chrono_time *, bip::managed_mapped_file::size_type> res;
@@ -51,6 +84,7 @@ global_clock::global_clock(std::string name_, uint16_t _port)
     res2 = segment.find<bip::interprocess_mutex>("mtx");
     mutex = res2.first;
   }
+  get_time_rpc = container::rpc_handle<HTime()>(rpc, func_prefix + "_GetTime");
 }
 global_clock::chrono_time *global_clock::data() {
   HCL_LOG_TRACE();
@@ -80,8 +114,7 @@ HTime global_clock::GetTime() {
   if (server_on_node) {
     return LocalGetTime();
   } else {
-    auto my_server_i = my_server;
-    return RPC_CALL_WRAPPER1("_GetTime", my_server_i, HTime);
+    return get_time_rpc.call(my_server);
   }
 }
 
@@ -95,7 +128,7 @@ HTime global_clock::GetTimeServer(uint16_t &server) {
   if (my_server == server && server_on_node) {
     return LocalGetTime();
   } else {
-    return RPC_CALL_WRAPPER1("_GetTime", server, HTime);
+    return get_time_rpc.call(server);
   }
 }
 
@@ -6,6 +6,8 @@ ConfigurationManager::ConfigurationManager()
       RPC_THREADS(1),
 #if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
       RPC_IMPLEMENTATION(THALLIUM),
+#elif defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+      RPC_IMPLEMENTATION(LOOPBACK),
 #endif
 #if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
 #if defined(HCL_COMMUNICATION_PROTOCOL_ENABLE_UCX)
@@ -22,6 +24,35 @@ ConfigurationManager::ConfigurationManager()
       SERVER_LIST_PATH(""),
       SERVER_LIST(),
       BACKED_FILE_DIR("/dev/shm"),
+      RDMA_THRESHOLD(0),
+      BATCH_SIZE(0),
+      BATCH_WINDOW_MS(10),
+      RPC_TIMEOUT_MS(0),
+      ENDPOINT_PREFETCH(false),
+      WRITE_BEHIND(false),
+      LOCK_STRIPES(16),
+      MAX_MEMORY_ALLOCATED(0),
+      PERSISTENT_SEGMENTS(false),
+      SEGMENT_HUGE_PAGES(false),
+      SEGMENT_PREFAULT(false),
+      SEGMENT_NUMA_NODE(-1),
+      SEGMENT_BACKING(BACKING_FILE),
+      NODE_SEGMENT_SIZE(0),
+      COMPACTION_INTERVAL_MS(0),
+      COMPACTION_FRAGMENTATION(0.5),
+      COMPACTION_SLICE(1024),
+      PARTITIONER(PARTITION_MODULO),
+      PARTITION_SLOTS(16384),
+      ACTIVE_SERVERS(0),
+      MIGRATION_RETRY_MS(100),
+      REPLICATION_FACTOR(1),
+      REPLICATION_MODE(REPLICATION_SYNC),
+      READ_HEDGE_MS(0),
+      HOT_KEY_THRESHOLD(0),
+      HOT_KEY_WINDOW_MS(1000),
+      HOT_KEY_MAX(64),
+      NEAR_CACHE_BYTES(0),
+      NEAR_CACHE_LEASE_MS(100),
       DYN_CONFIG(false) {
 
   HCL_LOG_TRACE();
@@ -1,10 +1,30 @@
 #include <hcl/common/container.h>
 #include <hcl/hcl_internal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <tuple>
 namespace hcl {
 bool container::is_local(uint16_t &key_int) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  return key_int == my_server_idx && server_on_node;
+  /* The routing table of an elastic server is not shared with on-node
+     clients, so they go through the server. */
+  return key_int == my_server_idx && server_on_node &&
+         (is_server || !partition.elastic());
 }
 bool container::is_local() {
   HCL_LOG_TRACE();
@@ -12,10 +32,36 @@ bool container::is_local() {
   return server_on_node;
 }
 
+uint64_t container::RoutingVersion() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::lock_guard<std::mutex> guard(routing_mutex);
+  return partition.get_version();
+}
+
 container::~container() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
-  if (is_server) boost::interprocess::file_mapping::remove(backed_file.c_str());
+  stop_compaction();
+  stop_migration();
+  if (slabs != nullptr) {
+    slabs->detach();
+    slabs = nullptr;
+  }
+#if defined(HCL_ENABLE_HEAP_SEGMENTS)
+  /* Newest first, so that the slab pool outlives the objects it holds. */
+  while (!heap_objects.empty()) heap_objects.pop_back();
+#else
+  if (is_server) {
+    if (persistent)
+      close_segment();
+    else
+      remove_backing();
+  }
+  close_backing();
+  /* Released here so that a second run of the destructor is harmless. */
+  node.reset();
+#endif
 }
 container::container(CharStruct _name, uint16_t _port, uint16_t _num_servers,
                      uint16_t _my_server_idx, really_long _memory_allocated,
@@ -23,41 +69,677 @@ container::container(CharStruct _name, uint16_t _port, uint16_t _num_servers,
                      CharStruct _backed_file_dir)
     : num_servers(_num_servers),
       my_server_idx(_my_server_idx),
+      partition(HCL_CONF->PARTITIONER, _num_servers,
+                HCL_CONF->PARTITION_SLOTS),
       memory_allocated(_memory_allocated),
       is_server(_is_server),
+      persistent(HCL_CONF->PERSISTENT_SEGMENTS &&
+                 HCL_CONF->SEGMENT_BACKING != BACKING_MEMFD),
+      reattached(false),
+      backing(HCL_CONF->SEGMENT_BACKING),
+      segment_fd(-1),
+      segment_region(),
+      node(),
+      node_region(nullptr),
+      node_region_size(0),
       segment(),
       name(_name),
       func_prefix(_name),
+      stripes(nullptr),
+      num_stripes(0),
+      slabs(nullptr),
       backed_file(_backed_file_dir + PATH_SEPARATOR + _name + "_" +
                   std::to_string(_my_server_idx)),
       port(_port),
+      rpc(hcl::HCL::GetInstance(false)->GetRPC(_port)),
+      write_behind(),
+      write_behind_mutex(),
+      write_behind_cv(),
+      write_behind_stop(false),
+      write_behind_failed(false),
+      compaction(),
+      compaction_mutex(),
+      compaction_cv(),
+      compaction_stop(false),
+      compaction_pass(),
+      route_stripes(),
+      num_route_groups(0),
+      routing_mutex(),
+      migration(),
+      migration_mutex(),
+      migration_cv(),
+      migration_stop(false),
+      active_servers(_num_servers),
+      migration_requested(0),
+      migration_finished(0),
+      replication(static_cast<uint16_t>(std::min<uint32_t>(
+          std::max<uint16_t>(HCL_CONF->REPLICATION_FACTOR, 1),
+          _num_servers))),
+      read_turn(_my_server_idx),
+      replication_mutex(),
+      replica_writes(),
+      replication_failed(false),
       server_on_node(_is_server_on_node) {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
   /* create per server name for shared memory. Needed if multiple servers are
      spawned on one node*/
   this->name += "_" + std::to_string(my_server_idx);
+  if (partition.elastic()) {
+    partition.reset_slots(HCL_CONF->ACTIVE_SERVERS);
+    if (HCL_CONF->ACTIVE_SERVERS > 0 && HCL_CONF->ACTIVE_SERVERS < num_servers)
+      active_servers = HCL_CONF->ACTIVE_SERVERS;
+    if (is_server) {
+      num_route_groups = std::max<uint32_t>(HCL_CONF->LOCK_STRIPES, 1);
+      route_stripes.reset(new lock_stripe[num_route_groups]);
+    }
+  }
   /* if current rank is a server */
-  auto rpc = hcl::HCL::GetInstance(false)->GetRPC(port);
+#if defined(HCL_ENABLE_HEAP_SEGMENTS)
   if (is_server) {
-    /* Delete existing instance of shared memory space*/
-    boost::interprocess::file_mapping::remove(backed_file.c_str());
-    /* allocate new shared memory space */
-    segment = boost::interprocess::managed_mapped_file(
-        boost::interprocess::create_only, backed_file.c_str(),
-        memory_allocated);
-    mutex = segment.construct<boost::interprocess::interprocess_mutex>("mtx")();
+    construct_common_objects();
+  } else if (server_on_node) {
+    throw std::runtime_error(
+        "on-node clients need HCL built without HCL_ENABLE_HEAP_SEGMENTS");
+  }
+#else
+  /* Remote clients map nothing, and their node may have no server. */
+  if (is_server || server_on_node)
+    node = hcl::HCL::GetInstance(false)->GetNodeSegment();
+  if (is_server) {
+    if (persistent && open_backing(false)) {
+      /* Reattach to the segment left by the previous run */
+      open_segment();
+      if (!header()->clean)
+        throw std::runtime_error(std::string(backed_file.c_str()) +
+                                 " was not closed cleanly");
+      header()->clean = 0;
+      reattached = true;
+      /* Nobody else has it mapped yet, so no lock can be held. */
+      new (mutex) rw_lock();
+      for (uint32_t i = 0; i < num_stripes; ++i)
+        new (&stripes[i].mutex) rw_lock();
+      slabs->reset();
+      slabs->attach();
+    } else {
+      /* Delete existing instance of shared memory space*/
+      remove_backing();
+      open_backing(true);
+      create_segment();
+    }
   } else if (!is_server && server_on_node) {
     /* Map the clients to their respective memory pools */
-    segment = boost::interprocess::managed_mapped_file(
-        boost::interprocess::open_only, backed_file.c_str());
-    std::pair<boost::interprocess::interprocess_mutex *,
-              boost::interprocess::managed_mapped_file::size_type>
-        res2;
-    res2 = segment.find<boost::interprocess::interprocess_mutex>("mtx");
-    mutex = res2.first;
+    if (!open_backing(false))
+      throw std::runtime_error(std::string(backed_file.c_str()) +
+                               " has no segment to map");
+    open_segment();
+  }
+#endif
+}
+
+void container::create_segment() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  really_long reserved = memory_allocated;
+  if (node == nullptr) {
+    reserved = std::max(memory_allocated, HCL_CONF->MAX_MEMORY_ALLOCATED);
+    resize_backed_file(SEGMENT_OFFSET + memory_allocated);
+    segment_region = boost::interprocess::mapped_region(
+        fd_mappable{segment_fd}, boost::interprocess::read_write, 0,
+        SEGMENT_OFFSET + reserved);
+    place_segment();
+    prefault_segment(0, SEGMENT_OFFSET + memory_allocated);
+  }
+  char *base = segment_base();
+  segment_header *created = new (base) segment_header();
+  std::memcpy(created->magic, SEGMENT_MAGIC, sizeof(created->magic));
+  created->layout_version = HCL_SEGMENT_LAYOUT_VERSION;
+  created->reserved = reserved;
+  segment = managed_segment(boost::interprocess::create_only,
+                            base + SEGMENT_OFFSET, memory_allocated);
+  construct_common_objects();
+}
+
+void container::construct_common_objects() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  mutex = construct_named<rw_lock>("mtx");
+  num_stripes = std::max<uint32_t>(HCL_CONF->LOCK_STRIPES, 1);
+  stripes = construct_named_array<lock_stripe>("stripes", num_stripes);
+#if defined(HCL_ENABLE_HEAP_SEGMENTS)
+  slab_pool::segment_manager *upstream = nullptr;
+#else
+  slab_pool::segment_manager *upstream = segment.get_segment_manager();
+#endif
+  slabs = construct_named<slab_pool>("slabs", upstream);
+  slabs->attach();
+}
+
+void container::open_segment() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  really_long reserved;
+  if (node != nullptr) {
+    check_header(header());
+    reserved = node_region_size - SEGMENT_OFFSET;
+  } else {
+    {
+      boost::interprocess::mapped_region mapped_header(
+          fd_mappable{segment_fd}, boost::interprocess::read_only, 0,
+          sizeof(segment_header));
+      auto found = static_cast<segment_header *>(mapped_header.get_address());
+      check_header(found);
+      reserved = found->reserved;
+    }
+    /* A restarted server may reserve more than the previous run did. */
+    if (is_server)
+      reserved = std::max(reserved, HCL_CONF->MAX_MEMORY_ALLOCATED);
+    segment_region = boost::interprocess::mapped_region(
+        fd_mappable{segment_fd}, boost::interprocess::read_write, 0,
+        SEGMENT_OFFSET + reserved);
+  }
+  char *base = segment_base();
+  header()->reserved = reserved;
+  segment = managed_segment(boost::interprocess::open_only,
+                            base + SEGMENT_OFFSET, reserved);
+  if (node == nullptr) {
+    place_segment();
+    prefault_segment(0, SEGMENT_OFFSET + segment.get_size());
+  }
+  std::pair<rw_lock *, boost::interprocess::managed_mapped_file::size_type>
+      res2;
+  res2 = segment.find<rw_lock>("mtx");
+  mutex = res2.first;
+  std::pair<lock_stripe *, boost::interprocess::managed_mapped_file::size_type>
+      res3;
+  res3 = segment.find<lock_stripe>("stripes");
+  stripes = res3.first;
+  num_stripes = static_cast<uint32_t>(res3.second);
+  slabs = segment.find<slab_pool>("slabs").first;
+  slabs->attach();
+}
+
+void container::check_header(const segment_header *found) {
+  if (std::memcmp(found->magic, SEGMENT_MAGIC, sizeof(found->magic)) != 0 ||
+      found->layout_version != HCL_SEGMENT_LAYOUT_VERSION)
+    throw std::runtime_error(std::string(backed_file.c_str()) +
+                             " is not an HCL segment of this version");
+}
+
+bool container::attach_type(const char *type_name) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  /* FNV-1a, so the value does not depend on the standard library. */
+  uint64_t type_hash = 14695981039346656037ULL;
+  for (const char *c = type_name; *c; ++c)
+    type_hash = (type_hash ^ static_cast<unsigned char>(*c)) * 1099511628211ULL;
+  if (!reattached) {
+    /* Heap servers have no header to record it in. */
+    if (header() != nullptr) header()->type_hash = type_hash;
+    return false;
+  }
+  if (header()->type_hash != type_hash)
+    throw std::runtime_error(std::string(backed_file.c_str()) +
+                             " holds another container type than " +
+                             type_name);
+  return true;
+}
+
+void container::close_segment() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (segment_base() == nullptr) return;
+  flush_segment(0);
+  header()->clean = 1;
+  flush_segment(sizeof(segment_header));
+  segment = managed_segment();
+  segment_region = boost::interprocess::mapped_region();
+  node_region = nullptr;
+}
+
+void container::flush_segment(really_long bytes) {
+  if (node != nullptr)
+    node->flush();
+  else
+    segment_region.flush(0, bytes, false);
+}
+void container::resize_backed_file(really_long size) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (::ftruncate(segment_fd, static_cast<off_t>(size)) != 0)
+    throw std::system_error(errno, std::generic_category(),
+                            std::string("resize ") + backed_file.c_str());
+}
+
+bool container::open_backing(bool create) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (node != nullptr) {
+    if (create) {
+      node_region_size = SEGMENT_OFFSET + memory_allocated;
+      node_region = node->create_region(name.c_str(), node_region_size);
+    } else {
+      std::tie(node_region, node_region_size) =
+          node->find_region(name.c_str());
+    }
+    return node_region != nullptr;
+  }
+  int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_TRUNC : 0);
+  switch (backing) {
+    case BACKING_FILE: {
+      segment_fd = ::open(backed_file.c_str(), flags, 0666);
+      break;
+    }
+    case BACKING_POSIX_SHM: {
+      segment_fd = ::shm_open(shm_name().c_str(), flags, 0666);
+      break;
+    }
+    case BACKING_MEMFD: {
+#if defined(__linux__)
+      if (create) {
+        segment_fd = ::memfd_create(name.c_str(), MFD_CLOEXEC);
+        if (segment_fd < 0) break;
+        std::ofstream locator(backed_file.c_str(), std::ios::trunc);
+        locator << getpid() << " " << segment_fd << std::endl;
+        if (!locator)
+          throw std::runtime_error(std::string("cannot publish memfd in ") +
+                                   backed_file.c_str());
+      } else {
+        long pid = -1, fd = -1;
+        std::ifstream locator(backed_file.c_str());
+        if (!(locator >> pid >> fd)) return false;
+        segment_fd = ::open(("/proc/" + std::to_string(pid) + "/fd/" +
+                             std::to_string(fd))
+                                .c_str(),
+                            O_RDWR | O_CLOEXEC);
+      }
+#else
+      throw std::runtime_error("memfd segments need Linux");
+#endif
+      break;
+    }
   }
+  if (segment_fd >= 0) return true;
+  if (errno == ENOENT && !create) return false;
+  throw std::system_error(errno, std::generic_category(),
+                          std::string("open ") + backed_file.c_str());
 }
+
+void container::remove_backing() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (node != nullptr) {
+    node->remove_region(name.c_str());
+    return;
+  }
+  /* A memfd goes away with its last descriptor; only the locator stays. */
+  if (backing == BACKING_POSIX_SHM)
+    ::shm_unlink(shm_name().c_str());
+  else
+    ::unlink(backed_file.c_str());
+}
+
+void container::close_backing() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (segment_fd < 0) return;
+  ::close(segment_fd);
+  segment_fd = -1;
+}
+
+void container::place_segment() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  void *base = segment_region.get_address();
+  size_t length = segment_region.get_size();
+#if defined(MADV_HUGEPAGE)
+  if (HCL_CONF->SEGMENT_HUGE_PAGES &&
+      madvise(base, length, MADV_HUGEPAGE) != 0) {
+    HCL_LOG_WARN("No huge pages for %s: %s\n", backed_file.c_str(),
+                 std::strerror(errno));
+  }
+#endif
+#if defined(__linux__)
+  int node = HCL_CONF->SEGMENT_NUMA_NODE;
+  if (node >= 0) {
+    /* MPOL_PREFERRED from linux/mempolicy.h, so libnuma is not needed. */
+    const int preferred = 1;
+    const unsigned long bits = sizeof(unsigned long) * CHAR_BIT;
+    std::vector<unsigned long> nodes(node / bits + 1, 0);
+    nodes[node / bits] = 1UL << (node % bits);
+    if (syscall(SYS_mbind, base, length, preferred, nodes.data(),
+                nodes.size() * bits, 0) != 0) {
+      HCL_LOG_WARN("Cannot bind %s to NUMA node %d: %s\n",
+                   backed_file.c_str(), node, std::strerror(errno));
+    }
+  }
+#endif
+}
+
+void container::prefault_segment(really_long from, really_long to) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (!HCL_CONF->SEGMENT_PREFAULT || from >= to) return;
+  char *base = static_cast<char *>(segment_region.get_address());
+  const long page = sysconf(_SC_PAGESIZE);
+  from -= from % page;
+#if defined(MADV_POPULATE_WRITE)
+  if (madvise(base + from, to - from, MADV_POPULATE_WRITE) == 0) return;
+#endif
+  /* Older kernels: read every page so it is at least in the page cache. */
+  for (really_long offset = from; offset < to; offset += page)
+    static_cast<void>(*static_cast<volatile char *>(base + offset));
+}
+
+bool container::grow_segment(really_long seen_size) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (!is_server && !server_on_node) return false;
+  std::unique_lock<rw_lock> whole(*mutex);
+  all_stripes_lock every_stripe(this, false);
+  really_long size = segment.get_size();
+  /* Another thread grew it while we waited for the locks. */
+  if (size != seen_size) return true;
+  really_long reserved =
+      (node != nullptr ? node_region_size : segment_region.get_size()) -
+      SEGMENT_OFFSET;
+  if (size >= reserved) {
+    HCL_LOG_ERROR("Segment %s is full at its reserved %llu bytes\n",
+                  backed_file.c_str(), static_cast<unsigned long long>(size));
+    return false;
+  }
+  really_long extra = std::min(size, reserved - size);
+  resize_backed_file(SEGMENT_OFFSET + size + extra);
+  segment.grow(extra);
+  prefault_segment(SEGMENT_OFFSET + size, SEGMENT_OFFSET + size + extra);
+  HCL_LOG_INFO("Segment %s grew to %llu bytes\n", backed_file.c_str(),
+               static_cast<unsigned long long>(size + extra));
+  return true;
+}
+
+void container::start_write_behind(uint32_t interval_ms,
+                                   std::function<bool()> drain) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (interval_ms == 0) interval_ms = 1;
+  write_behind_stop = false;
+  write_behind = std::thread([this, interval_ms, drain]() {
+    std::unique_lock<std::mutex> guard(write_behind_mutex);
+    while (!write_behind_cv.wait_for(guard,
+                                     std::chrono::milliseconds(interval_ms),
+                                     [this]() { return write_behind_stop; })) {
+      guard.unlock();
+      try {
+        if (!drain()) write_behind_failed = true;
+      } catch (const std::exception &e) {
+        HCL_LOG_ERROR("Write-behind drain failed: %s\n", e.what());
+        write_behind_failed = true;
+      }
+      guard.lock();
+    }
+  });
+}
+
+void container::stop_write_behind() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  {
+    std::lock_guard<std::mutex> guard(write_behind_mutex);
+    write_behind_stop = true;
+  }
+  write_behind_cv.notify_all();
+  if (write_behind.joinable()) write_behind.join();
+}
+
+bool container::write_behind_succeeded() {
+  return !write_behind_failed.exchange(false);
+}
+
+void container::start_compaction(uint32_t interval_ms) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+#if !defined(HCL_ENABLE_HEAP_SEGMENTS)
+  if (interval_ms == 0 || !is_server) return;
+  compaction_stop = false;
+  compaction = std::thread([this, interval_ms]() {
+    std::unique_lock<std::mutex> guard(compaction_mutex);
+    while (!compaction_cv.wait_for(guard,
+                                   std::chrono::milliseconds(interval_ms),
+                                   [this]() { return compaction_stop.load(); })) {
+      guard.unlock();
+      try {
+        if (GetSegmentUsage().fragmentation() >=
+            HCL_CONF->COMPACTION_FRAGMENTATION)
+          Compact();
+      } catch (const std::exception &e) {
+        HCL_LOG_ERROR("Compaction of %s failed: %s\n", backed_file.c_str(),
+                      e.what());
+      }
+      guard.lock();
+    }
+  });
+#endif
+}
+
+void container::stop_compaction() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  {
+    std::lock_guard<std::mutex> guard(compaction_mutex);
+    compaction_stop = true;
+  }
+  compaction_cv.notify_all();
+  if (compaction.joinable()) compaction.join();
+}
+
+void container::start_rebalance(uint16_t active) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::lock_guard<std::mutex> guard(migration_mutex);
+  active_servers = active;
+  ++migration_requested;
+  if (!migration.joinable()) {
+    migration_stop = false;
+    migration = std::thread([this]() {
+      std::unique_lock<std::mutex> guard(migration_mutex);
+      while (true) {
+        migration_cv.wait(guard, [this]() {
+          return migration_stop || migration_finished < migration_requested;
+        });
+        if (migration_stop) break;
+        uint64_t requested = migration_requested;
+        guard.unlock();
+        bool moved_all = true;
+        for (uint32_t group = 0; group < num_route_groups; ++group) {
+          try {
+            if (!migrate_group(group)) moved_all = false;
+          } catch (const std::exception &e) {
+            HCL_LOG_ERROR("Migration of %s failed: %s\n", backed_file.c_str(),
+                          e.what());
+            moved_all = false;
+          }
+        }
+        guard.lock();
+        if (moved_all) {
+          migration_finished = requested;
+          migration_cv.notify_all();
+        } else {
+          migration_cv.wait_for(
+              guard, std::chrono::milliseconds(HCL_CONF->MIGRATION_RETRY_MS),
+              [this]() { return migration_stop; });
+        }
+      }
+    });
+  }
+  migration_cv.notify_all();
+}
+
+void container::stop_migration() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  {
+    std::lock_guard<std::mutex> guard(migration_mutex);
+    migration_stop = true;
+  }
+  migration_cv.notify_all();
+  if (migration.joinable()) migration.join();
+}
+
+void container::wait_for_migration() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::unique_lock<std::mutex> guard(migration_mutex);
+  uint64_t requested = migration_requested;
+  migration_cv.wait(guard, [this, requested]() {
+    return migration_stop || migration_finished >= requested;
+  });
+}
+
+bool container::migrate_group(uint32_t group) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  return true;
+}
+
+bool container::replicate(std::function<RPCFuture<bool>(uint16_t)> send) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (replication < 2) return true;
+  std::vector<RPCFuture<bool>> sent;
+  sent.reserve(replication - 1);
+  for (uint16_t i = 1; i < replication; ++i)
+    sent.push_back(send(replica_of(my_server_idx, i)));
+  if (HCL_CONF->REPLICATION_MODE == REPLICATION_ASYNC) {
+    std::lock_guard<std::mutex> guard(replication_mutex);
+    /* Collect the forwards that are done, so that the list stays short. */
+    auto done = std::partition(
+        replica_writes.begin(), replica_writes.end(),
+        [](const RPCFuture<bool> &write) { return !write.ready(); });
+    for (auto write = done; write != replica_writes.end(); ++write) {
+      try {
+        if (!write->get()) replication_failed = true;
+      } catch (const std::exception &e) {
+        HCL_LOG_ERROR("Replica write of %s failed: %s\n", backed_file.c_str(),
+                      e.what());
+        replication_failed = true;
+      }
+    }
+    replica_writes.erase(done, replica_writes.end());
+    for (auto &write : sent) replica_writes.push_back(std::move(write));
+    return true;
+  }
+  bool success = true;
+  for (auto &write : sent) {
+    if (!write.get()) success = false;
+  }
+  return success;
+}
+
+bool container::wait_for_replicas() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::vector<RPCFuture<bool>> pending;
+  {
+    std::lock_guard<std::mutex> guard(replication_mutex);
+    pending.swap(replica_writes);
+  }
+  for (auto &write : pending) {
+    try {
+      if (!write.get()) replication_failed = true;
+    } catch (const std::exception &e) {
+      HCL_LOG_ERROR("Replica write of %s failed: %s\n", backed_file.c_str(),
+                    e.what());
+      replication_failed = true;
+    }
+  }
+  return !replication_failed.exchange(false);
+}
+
+void container::learn_routes(const std::vector<slot_route> &routes) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::lock_guard<std::mutex> guard(routing_mutex);
+  for (const slot_route &route : routes) partition.learn(route);
+}
+
+bool container::compact_slice(bool restart) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  return false;
+}
+
+std::vector<really_long> container::free_block_sizes(bool all) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::vector<really_long> sizes;
+#if !defined(HCL_ENABLE_HEAP_SEGMENTS)
+  auto *manager = segment.get_segment_manager();
+  std::vector<char *> taken;
+  while (all || taken.empty()) {
+    /* More than is free, so that the largest block is handed out whole. */
+    managed_segment::size_type received = manager->get_free_memory() + 1;
+    char *reuse = nullptr;
+    char *block = manager->allocation_command<char>(
+        boost::interprocess::allocate_new |
+            boost::interprocess::nothrow_allocation,
+        1, received, reuse);
+    if (block == nullptr) break;
+    taken.push_back(block);
+    sizes.push_back(received);
+  }
+  for (char *block : taken) manager->deallocate(block);
+#endif
+  return sizes;
+}
+
+container::segment_usage container::GetSegmentUsage(bool histogram) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  segment_usage usage{0, 0, 0, {}};
+#if !defined(HCL_ENABLE_HEAP_SEGMENTS)
+  if (!is_server && !server_on_node) return usage;
+  /* An allocation made while the free blocks are taken would fail. */
+  std::unique_lock<rw_lock> whole(*mutex);
+  all_stripes_lock every_stripe(this, false);
+  usage.size = segment.get_size();
+  usage.free_memory = segment.get_free_memory();
+  for (really_long block : free_block_sizes(histogram)) {
+    usage.largest_free_block = std::max(usage.largest_free_block, block);
+    if (!histogram) continue;
+    size_t bucket = 0;
+    while (block >> (bucket + 1)) ++bucket;
+    if (usage.free_blocks.size() <= bucket)
+      usage.free_blocks.resize(bucket + 1, 0);
+    ++usage.free_blocks[bucket];
+  }
+#endif
+  return usage;
+}
+
+std::pair<container::segment_usage, container::segment_usage>
+container::Compact() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::lock_guard<std::mutex> pass(compaction_pass);
+  segment_usage before = GetSegmentUsage();
+  if (!is_server) return std::make_pair(before, before);
+  bool more = compact_slice(true);
+  while (more && !compaction_stop) {
+    /* Let the operations that queued on the slice's locks go first. */
+    std::this_thread::yield();
+    more = compact_slice(false);
+  }
+  segment_usage after = GetSegmentUsage();
+  HCL_LOG_INFO(
+      "Compacted %s: %llu free bytes, largest block %llu, before; "
+      "%llu free bytes, largest block %llu, after\n",
+      backed_file.c_str(), static_cast<unsigned long long>(before.free_memory),
+      static_cast<unsigned long long>(before.largest_free_block),
+      static_cast<unsigned long long>(after.free_memory),
+      static_cast<unsigned long long>(after.largest_free_block));
+  return std::make_pair(before, after);
+}
+
 void container::lock() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
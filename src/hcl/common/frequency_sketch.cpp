@@ -0,0 +1,62 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#include <hcl/common/frequency_sketch.h>
+#include <hcl/common/partitioner.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace hcl {
+frequency_sketch::frequency_sketch(uint32_t _width)
+    : width(_width == 0 ? 1 : _width),
+      counters(new std::atomic<uint32_t>[DEPTH * width]) {
+  for (uint32_t i = 0; i < DEPTH * width; ++i)
+    counters[i].store(0, std::memory_order_relaxed);
+}
+
+/* Each row mixes the hash with its own seed, so keys that collide in one
+   row rarely collide in the others. */
+std::atomic<uint32_t> &frequency_sketch::counter(uint32_t row,
+                                                 uint64_t key_hash) const {
+  uint64_t mixed = partitioner::mix(key_hash + 0x9e3779b97f4a7c15ULL * (row + 1));
+  return counters[row * width + mixed % width];
+}
+
+uint32_t frequency_sketch::add(uint64_t key_hash, uint32_t count) {
+  uint32_t smallest = UINT_MAX;
+  for (uint32_t row = 0; row < DEPTH; ++row) {
+    uint32_t total =
+        counter(row, key_hash).fetch_add(count, std::memory_order_relaxed) +
+        count;
+    smallest = std::min(smallest, total);
+  }
+  return smallest;
+}
+
+uint32_t frequency_sketch::estimate(uint64_t key_hash) const {
+  uint32_t smallest = UINT_MAX;
+  for (uint32_t row = 0; row < DEPTH; ++row)
+    smallest = std::min(
+        smallest, counter(row, key_hash).load(std::memory_order_relaxed));
+  return smallest;
+}
+
+/* Concurrent adds may be lost across the halving, which only matters for
+   an estimate anyway. */
+void frequency_sketch::decay() {
+  for (uint32_t i = 0; i < DEPTH * width; ++i)
+    counters[i].store(counters[i].load(std::memory_order_relaxed) / 2,
+                      std::memory_order_relaxed);
+}
+}  // namespace hcl
@@ -0,0 +1,128 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+#include <hcl/common/lease_table.h>
+#include <hcl/common/partitioner.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace hcl {
+namespace {
+int64_t now_ticks() {
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+}  // namespace
+
+lease_table::lease_table(uint32_t _buckets,
+                         std::function<void(std::chrono::microseconds)> _sleep)
+    : buckets(_buckets == 0 ? 1 : _buckets),
+      ends(new std::atomic<int64_t>[buckets]),
+      writers(new std::atomic<uint32_t>[buckets]),
+      suspended(0),
+      sleep(std::move(_sleep)) {
+  for (uint32_t i = 0; i < buckets; ++i) {
+    ends[i].store(0, std::memory_order_relaxed);
+    writers[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+/* Sleeps may be rounded by the timer behind them, so the end is checked. */
+void lease_table::sleep_until(int64_t end) const {
+  for (int64_t now = now_ticks(); now < end; now = now_ticks())
+    sleep(std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::duration(end - now)) +
+          std::chrono::microseconds(1));
+}
+
+uint32_t lease_table::bucket_of(uint64_t key_hash) const {
+  return partitioner::mix(key_hash) % buckets;
+}
+
+/*
+ * The writer count is checked before the end is raised, so a steady stream
+ * of reads cannot keep a waiting write out; the writes that raced with it
+ * are caught by still_valid.
+ */
+bool lease_table::grant(uint64_t key_hash, uint32_t lease_ms) {
+  uint32_t bucket = bucket_of(key_hash);
+  if (suspended.load() != 0 || writers[bucket].load() != 0) return false;
+  int64_t end =
+      now_ticks() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::milliseconds(lease_ms))
+                        .count();
+  int64_t current = ends[bucket].load();
+  while (current < end && !ends[bucket].compare_exchange_weak(current, end)) {
+  }
+  return true;
+}
+
+bool lease_table::still_valid(uint64_t key_hash) const {
+  return suspended.load() == 0 && writers[bucket_of(key_hash)].load() == 0;
+}
+
+/* Raised before wait_all reads the ends, as in lease_hold::hold. */
+void lease_table::suspend() { suspended.fetch_add(1); }
+
+void lease_table::resume() { suspended.fetch_sub(1); }
+
+void lease_table::wait_all() const {
+  int64_t latest = 0;
+  for (uint32_t i = 0; i < buckets; ++i)
+    latest = std::max(latest, ends[i].load());
+  sleep_until(latest);
+}
+
+lease_hold::lease_hold(lease_table *_table, uint64_t key_hash)
+    : table(_table), held() {
+  if (table == nullptr) return;
+  held.push_back(table->bucket_of(key_hash));
+  hold();
+}
+
+lease_hold::lease_hold(lease_table *_table,
+                       const std::vector<uint64_t> &key_hashes)
+    : table(_table), held() {
+  if (table == nullptr) return;
+  held.reserve(key_hashes.size());
+  for (uint64_t key_hash : key_hashes)
+    held.push_back(table->bucket_of(key_hash));
+  std::sort(held.begin(), held.end());
+  held.erase(std::unique(held.begin(), held.end()), held.end());
+  hold();
+}
+
+/*
+ * The writer count is raised before the ends are read: a grant that raised
+ * an end after that read sees the writer in still_valid and is withdrawn.
+ */
+void lease_hold::hold() {
+  for (uint32_t bucket : held) table->writers[bucket].fetch_add(1);
+  for (uint32_t bucket : held) table->sleep_until(table->ends[bucket].load());
+}
+
+lease_hold::~lease_hold() {
+  if (table == nullptr) return;
+  for (uint32_t bucket : held) table->writers[bucket].fetch_sub(1);
+}
+
+lease_pause::lease_pause(lease_table *_table) : table(_table) {
+  if (table == nullptr) return;
+  table->suspend();
+  table->wait_all();
+}
+
+lease_pause::~lease_pause() {
+  if (table != nullptr) table->resume();
+}
+}  // namespace hcl
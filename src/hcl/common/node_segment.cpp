@@ -0,0 +1,91 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <hcl/common/constants.h>
+#include <hcl/common/logging.h>
+#include <hcl/common/node_segment.h>
+#include <hcl/common/profiler.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+namespace hcl {
+node_segment::node_segment(bool _is_server, CharStruct _backed_file,
+                           really_long size, bool _persistent)
+    : is_server(_is_server),
+      persistent(_persistent),
+      backed_file(_backed_file),
+      segment() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (!is_server) {
+    segment = boost::interprocess::managed_mapped_file(
+        boost::interprocess::open_only, backed_file.c_str());
+  } else if (persistent && access(backed_file.c_str(), F_OK) == 0) {
+    segment = boost::interprocess::managed_mapped_file(
+        boost::interprocess::open_only, backed_file.c_str());
+  } else {
+    boost::interprocess::file_mapping::remove(backed_file.c_str());
+    segment = boost::interprocess::managed_mapped_file(
+        boost::interprocess::create_only, backed_file.c_str(), size);
+  }
+}
+
+node_segment::~node_segment() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  if (!is_server) return;
+  if (persistent)
+    flush();
+  else
+    boost::interprocess::file_mapping::remove(backed_file.c_str());
+}
+
+char *node_segment::create_region(const std::string &object,
+                                  really_long size) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  char *base =
+      static_cast<char *>(segment.allocate_aligned(size, HCL_CACHE_LINE));
+  try {
+    segment.construct<region_entry>(object.c_str())(region_entry{base, size});
+  } catch (...) {
+    segment.deallocate(base);
+    throw;
+  }
+  return base;
+}
+
+std::pair<char *, really_long> node_segment::find_region(
+    const std::string &object) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  region_entry *entry = segment.find<region_entry>(object.c_str()).first;
+  if (entry == nullptr) return std::make_pair(nullptr, 0);
+  return std::make_pair(entry->base.get(), entry->size);
+}
+
+void node_segment::remove_region(const std::string &object) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  region_entry *entry = segment.find<region_entry>(object.c_str()).first;
+  if (entry == nullptr) return;
+  segment.deallocate(entry->base.get());
+  segment.destroy_ptr(entry);
+}
+
+void node_segment::flush() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  segment.flush();
+}
+}  // namespace hcl
@@ -0,0 +1,101 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <hcl/common/partitioner.h>
+
+namespace hcl {
+partitioner::partitioner(PartitionScheme _scheme, uint16_t _num_servers,
+                         uint32_t num_slots, uint64_t _domain)
+    : scheme(_scheme),
+      num_servers(_num_servers == 0 ? 1 : _num_servers),
+      domain(_domain),
+      slot_owner(),
+      slot_epoch(),
+      version(0) {
+  if (scheme != PARTITION_SLOTS) return;
+  if (num_slots == 0) num_slots = 1;
+  /* Atomics cannot be moved, so the tables are built at their final size. */
+  slot_owner = std::vector<std::atomic<uint16_t>>(num_slots);
+  slot_epoch = std::vector<std::atomic<uint32_t>>(num_slots);
+  reset_slots(num_servers);
+}
+
+void partitioner::reset_slots(uint16_t active) {
+  if (active == 0 || active > num_servers) active = num_servers;
+  for (uint32_t slot = 0; slot < slot_owner.size(); ++slot) {
+    slot_owner[slot].store(jump(slot, active), std::memory_order_relaxed);
+    slot_epoch[slot].store(0, std::memory_order_relaxed);
+  }
+}
+
+/* The epoch is stored first, so a reader never pairs a new owner with the
+   epoch it replaced. */
+bool partitioner::learn(const slot_route &route) {
+  if (route.slot >= slot_owner.size() || route.owner >= num_servers ||
+      route.epoch <= slot_epoch[route.slot].load(std::memory_order_relaxed))
+    return false;
+  slot_epoch[route.slot].store(route.epoch, std::memory_order_release);
+  slot_owner[route.slot].store(route.owner, std::memory_order_release);
+  ++version;
+  return true;
+}
+
+uint16_t partitioner::jump(uint64_t key, uint16_t buckets) {
+  int64_t bucket = -1, next = 0;
+  while (next < buckets) {
+    bucket = next;
+    key = key * 2862933555777941757ULL + 1;
+    next = static_cast<int64_t>(static_cast<double>(bucket + 1) *
+                                (static_cast<double>(1LL << 31) /
+                                 static_cast<double>((key >> 33) + 1)));
+  }
+  return static_cast<uint16_t>(bucket);
+}
+
+/*
+ * The first extra ranges hold local + 1 points and the others local. A
+ * domain of 0 stands for 2^64 points, one more than UINT64_MAX, so the
+ * split of UINT64_MAX is fixed up by one point. A single server owns the
+ * whole space and never asks, as its local would not fit in 64 bits.
+ */
+void partitioner::range_split(uint64_t &local, uint64_t &extra) const {
+  if (domain != 0) {
+    local = domain / num_servers;
+    extra = domain % num_servers;
+    return;
+  }
+  local = UINT64_MAX / num_servers;
+  extra = UINT64_MAX % num_servers + 1;
+  if (extra == num_servers) {
+    ++local;
+    extra = 0;
+  }
+}
+
+uint64_t partitioner::range_begin(uint16_t server) const {
+  if (server == 0) return 0;
+  if (server >= num_servers) return domain == 0 ? UINT64_MAX : domain;
+  uint64_t local, extra;
+  range_split(local, extra);
+  return server * local + (server < extra ? server : extra);
+}
+
+uint16_t partitioner::range_of(uint64_t key_hash) const {
+  if (num_servers == 1) return 0;
+  uint64_t local, extra;
+  range_split(local, extra);
+  uint64_t point = domain == 0 ? key_hash : key_hash % domain;
+  uint64_t offset = extra * (local + 1);
+  if (point < offset) return static_cast<uint16_t>(point / (local + 1));
+  return static_cast<uint16_t>(extra + (point - offset) / local);
+}
+}  // namespace hcl
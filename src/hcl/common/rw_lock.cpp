@@ -0,0 +1,102 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <hcl/common/rw_lock.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <climits>
+#include <thread>
+
+namespace hcl {
+void rw_lock::relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+/* The futexes are not private: the word may be mapped by other processes. */
+void rw_lock::park(uint32_t expected) {
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state), FUTEX_WAIT,
+          expected, nullptr, nullptr, 0);
+#else
+  if (state.load(std::memory_order_relaxed) == expected)
+    std::this_thread::yield();
+#endif
+}
+
+void rw_lock::wake_all() {
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state), FUTEX_WAKE,
+          INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+void rw_lock::lock_slow() {
+  uint32_t spins = 0, limit = spin_limit();
+  bool parked_once = false;
+  uint32_t current = state.load(std::memory_order_relaxed);
+  while (true) {
+    if (try_lock(current)) break;
+    /* Lost a race for a free lock; current has been reloaded. */
+    if (!(current & (WRITER | READERS))) continue;
+    if (spins < limit) {
+      ++spins;
+      relax();
+      current = state.load(std::memory_order_relaxed);
+      continue;
+    }
+    uint32_t parked = current | WAITERS | WRITER_PENDING;
+    if (parked != current &&
+        !state.compare_exchange_weak(current, parked,
+                                     std::memory_order_relaxed))
+      continue;
+    park(parked);
+    parked_once = true;
+    current = state.load(std::memory_order_relaxed);
+  }
+  /* Spinning did not pay off if we had to park, so spin less next time. */
+  learn(parked_once ? 0 : spins);
+}
+
+void rw_lock::lock_shared_slow() {
+  uint32_t spins = 0, limit = spin_limit();
+  bool parked_once = false;
+  uint32_t current = state.load(std::memory_order_relaxed);
+  while (true) {
+    if (try_lock_shared(current)) break;
+    if (!(current & (WRITER | WRITER_PENDING))) continue;
+    if (spins < limit) {
+      ++spins;
+      relax();
+      current = state.load(std::memory_order_relaxed);
+      continue;
+    }
+    uint32_t parked = current | WAITERS;
+    if (parked != current &&
+        !state.compare_exchange_weak(current, parked,
+                                     std::memory_order_relaxed))
+      continue;
+    park(parked);
+    parked_once = true;
+    current = state.load(std::memory_order_relaxed);
+  }
+  learn(parked_once ? 0 : spins);
+}
+}  // namespace hcl
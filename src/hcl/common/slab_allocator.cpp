@@ -0,0 +1,226 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <hcl/common/slab_allocator.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace hcl {
+namespace {
+/** Pools attached in this process, by id **/
+std::mutex live_mutex;
+std::unordered_map<uint64_t, slab_pool *> live_pools;
+
+uint64_t new_pool_id() {
+  std::random_device seed;
+  uint64_t id = (static_cast<uint64_t>(seed()) << 32) ^ seed();
+  return id ^ static_cast<uint64_t>(
+                  std::chrono::steady_clock::now().time_since_epoch().count());
+}
+}  // namespace
+
+struct slab_cache;
+namespace {
+/** Caches of the threads alive in this process, for detach() to drain **/
+std::mutex caches_mutex;
+std::vector<slab_cache *> caches;
+}  // namespace
+
+/**
+ * Blocks a thread holds back from the free lists, for the few pools it
+ * used last. An entry is only valid while its pool still has the same id.
+ */
+struct slab_cache {
+  static constexpr uint32_t POOLS = 4;
+  static constexpr uint32_t CAPACITY = 2 * slab_pool::BATCH;
+  struct entry {
+    slab_pool *pool = nullptr;
+    uint64_t id = 0;
+    uint32_t count[slab_pool::NUM_CLASSES] = {};
+    void *blocks[slab_pool::NUM_CLASSES][CAPACITY];
+  };
+  /** Taken by the owning thread, and by detach() in another one **/
+  std::mutex mutex;
+  entry entries[POOLS];
+  uint32_t victim = 0;
+
+  slab_cache() {
+    std::lock_guard<std::mutex> guard(caches_mutex);
+    caches.push_back(this);
+  }
+
+  ~slab_cache() {
+    {
+      std::lock_guard<std::mutex> guard(caches_mutex);
+      caches.erase(std::find(caches.begin(), caches.end(), this));
+    }
+    std::lock_guard<std::mutex> guard(mutex);
+    for (auto &cached : entries) release(cached);
+  }
+
+  entry &find(slab_pool *pool) {
+    for (auto &cached : entries)
+      if (cached.pool == pool && cached.id == pool->id) return cached;
+    entry *free_entry = nullptr;
+    for (auto &cached : entries)
+      if (cached.pool == nullptr) free_entry = &cached;
+    if (free_entry == nullptr) {
+      free_entry = &entries[victim];
+      victim = (victim + 1) % POOLS;
+      release(*free_entry);
+    }
+    free_entry->pool = pool;
+    free_entry->id = pool->id;
+    return *free_entry;
+  }
+
+  /** Gives the blocks back if the pool is still attached, else drops them. */
+  static void release(entry &cached) {
+    if (cached.pool != nullptr) {
+      std::lock_guard<std::mutex> guard(live_mutex);
+      auto live = live_pools.find(cached.id);
+      if (live != live_pools.end() && live->second == cached.pool) {
+        for (uint32_t i = 0; i < slab_pool::NUM_CLASSES; ++i)
+          cached.pool->give(i, cached.blocks[i], cached.count[i]);
+      }
+    }
+    cached.pool = nullptr;
+    cached.id = 0;
+    std::fill(cached.count, cached.count + slab_pool::NUM_CLASSES, 0);
+  }
+};
+
+namespace {
+thread_local slab_cache cache;
+}  // namespace
+
+slab_pool::slab_pool(segment_manager *_upstream)
+    : id(new_pool_id()), upstream(_upstream), classes() {}
+
+slab_pool::~slab_pool() {
+  detach();
+  for (uint32_t i = 0; i < NUM_CLASSES; ++i) {
+    size_t slab_bytes = blocks_per_slab(i) * (MIN_BLOCK << i);
+    while (classes[i].slabs != nullptr) {
+      slab_link *link = classes[i].slabs.get();
+      classes[i].slabs = link->next;
+      upstream_deallocate(reinterpret_cast<char *>(link) - slab_bytes);
+    }
+    classes[i].head = nullptr;
+  }
+}
+
+void *slab_pool::allocate(size_t bytes) {
+  if (bytes > MAX_BLOCK) return upstream_allocate(bytes);
+  uint32_t size_class = class_of(bytes);
+  std::lock_guard<std::mutex> guard(cache.mutex);
+  auto &cached = cache.find(this);
+  uint32_t &count = cached.count[size_class];
+  if (count == 0) count = take(size_class, cached.blocks[size_class], BATCH);
+  return cached.blocks[size_class][--count];
+}
+
+void slab_pool::deallocate(void *block, size_t bytes) {
+  if (bytes > MAX_BLOCK) {
+    upstream_deallocate(block);
+    return;
+  }
+  uint32_t size_class = class_of(bytes);
+  std::lock_guard<std::mutex> guard(cache.mutex);
+  auto &cached = cache.find(this);
+  uint32_t &count = cached.count[size_class];
+  if (count == slab_cache::CAPACITY) {
+    give(size_class, cached.blocks[size_class] + BATCH, BATCH);
+    count = BATCH;
+  }
+  cached.blocks[size_class][count++] = block;
+}
+
+void slab_pool::attach() {
+  std::lock_guard<std::mutex> guard(live_mutex);
+  live_pools[id] = this;
+}
+
+void slab_pool::detach() {
+  {
+    std::lock_guard<std::mutex> all(caches_mutex);
+    for (slab_cache *other : caches) {
+      std::lock_guard<std::mutex> guard(other->mutex);
+      for (auto &cached : other->entries)
+        if (cached.pool == this && cached.id == id) slab_cache::release(cached);
+    }
+  }
+  std::lock_guard<std::mutex> guard(live_mutex);
+  auto live = live_pools.find(id);
+  if (live != live_pools.end() && live->second == this) live_pools.erase(live);
+}
+
+void slab_pool::reset() {
+  std::lock_guard<std::mutex> guard(live_mutex);
+  live_pools.erase(id);
+  id = new_pool_id();
+  for (auto &entry : classes) new (&entry.mutex) rw_lock();
+}
+
+void *slab_pool::upstream_allocate(size_t bytes) {
+  if (upstream != nullptr) return upstream->allocate(bytes);
+  return ::operator new(bytes);
+}
+
+void slab_pool::upstream_deallocate(void *block) {
+  if (upstream != nullptr)
+    upstream->deallocate(block);
+  else
+    ::operator delete(block);
+}
+
+uint32_t slab_pool::take(uint32_t size_class, void **out, uint32_t count) {
+  auto &entry = classes[size_class];
+  std::unique_lock<rw_lock> guard(entry.mutex);
+  if (entry.head == nullptr) {
+    size_t block_size = MIN_BLOCK << size_class;
+    size_t blocks = blocks_per_slab(size_class);
+    char *slab = static_cast<char *>(
+        upstream_allocate(blocks * block_size + sizeof(slab_link)));
+    entry.slabs = new (slab + blocks * block_size) slab_link{entry.slabs};
+    for (size_t i = blocks; i > 0; --i) {
+      auto block = reinterpret_cast<free_block *>(slab + (i - 1) * block_size);
+      new (block) free_block{entry.head};
+      entry.head = block;
+    }
+  }
+  uint32_t taken = 0;
+  while (taken < count && entry.head != nullptr) {
+    free_block *block = entry.head.get();
+    entry.head = block->next;
+    out[taken++] = block;
+  }
+  return taken;
+}
+
+void slab_pool::give(uint32_t size_class, void **blocks, uint32_t count) {
+  if (count == 0) return;
+  auto &entry = classes[size_class];
+  std::unique_lock<rw_lock> guard(entry.mutex);
+  for (uint32_t i = 0; i < count; ++i) {
+    auto block = static_cast<free_block *>(blocks[i]);
+    new (block) free_block{entry.head};
+    entry.head = block;
+  }
+}
+}  // namespace hcl
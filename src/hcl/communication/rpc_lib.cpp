@@ -16,14 +16,73 @@ void RPC::init_engine_and_endpoints() {
   HCL_CPP_FUNCTION()
   thallium_client = hcl::Singleton<tl::engine>::GetInstance(
       uris[my_server_index].endpoint_uri.c_str(), MARGO_CLIENT_MODE);
+  /* Looking up every server here costs clients x servers lookups at job
+   * launch, so endpoints are resolved by the first call that needs them. */
   auto total_servers = uris.size();
-  thallium_endpoints.reserve(total_servers);
-  for (std::vector<CharStruct>::size_type i = 0; i < total_servers; ++i) {
-    thallium_endpoints.push_back(get_endpoint(uris[i]));
+  thallium_endpoints.assign(total_servers, nullptr);
+  endpoint_resolved.reset(new std::once_flag[total_servers]);
+  if (HCL_CONF->ENDPOINT_PREFETCH) {
+    endpoint_prefetch = std::thread(&RPC::prefetch_endpoints, this);
   }
 }
+
+tl::endpoint &RPC::resolve_endpoint(uint16_t server_index) {
+  std::call_once(endpoint_resolved[server_index], [this, server_index]() {
+    HCL_LOG_DEBUG("Resolving endpoint of server %d", server_index);
+    thallium_endpoints[server_index] =
+        std::make_shared<tl::endpoint>(get_endpoint(uris[server_index]));
+  });
+  return *thallium_endpoints[server_index];
+}
+
+void RPC::prefetch_endpoints() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  /* Start after our own index so that clients do not all hit server 0. */
+  auto total_servers = uris.size();
+  for (std::vector<URI>::size_type i = 1; i <= total_servers; ++i) {
+    if (stop_prefetch) return;
+    auto server_index =
+        static_cast<uint16_t>((my_server_index + i) % total_servers);
+    try {
+      resolve_endpoint(server_index);
+    } catch (const std::exception &e) {
+      /* Left unresolved, so the first call retries the lookup. */
+      HCL_LOG_WARN("Prefetching endpoint %d failed: %s", server_index,
+                   e.what());
+    }
+  }
+}
+
+void RPC::join_prefetch() {
+  stop_prefetch = true;
+  if (endpoint_prefetch.joinable()) endpoint_prefetch.join();
+}
+
+tl::remote_procedure RPC::define_timed(CharStruct const &func_name,
+                                       int timeout_ms) {
+  if (timeout_ms > 0)
+    return thallium_client->define(deadline_name(func_name).c_str());
+  return thallium_client->define(func_name.c_str());
+}
 #endif
 
+CharStruct RPC::deadline_name(CharStruct const &func_name) {
+  return CharStruct(func_name.string() + "_WithDeadline");
+}
+
+uint64_t RPC::budget_of(int timeout_ms) {
+  if (timeout_ms <= 0) return 0;
+  return static_cast<uint64_t>(timeout_ms) * 1000;
+}
+
+bool RPC::expired(std::chrono::steady_clock::time_point received,
+                  uint64_t budget_us) {
+  if (budget_us == 0) return false;
+  return std::chrono::steady_clock::now() - received >
+         std::chrono::microseconds(budget_us);
+}
+
 void RPC::Stop() {
   HCL_LOG_TRACE();
   HCL_CPP_FUNCTION()
@@ -36,11 +95,22 @@ void RPC::Stop() {
       {
         // Mercury addresses in endpoints must be freed before
         // finalizing Thallium
+        join_prefetch();
         thallium_endpoints.clear();
         thallium_server->finalize();
         break;
       }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+      case LOOPBACK: {
+        /* Handlers point into containers of this process. */
+        std::lock_guard<std::mutex> guard(loopback_mutex);
+        loopback_functions.clear();
+        break;
+      }
+#endif
+      default:
+        break;
     }
   }
 }
@@ -48,6 +118,9 @@ void RPC::Stop() {
 RPC::~RPC() {
   HCL_LOG_TRACE();
   Stop();
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+  join_prefetch();
+#endif
 }
 
 RPC::RPC(bool _is_server, uint16_t _my_server_index, size_t _threads,
@@ -67,6 +140,13 @@ RPC::RPC(bool _is_server, uint16_t _my_server_index, size_t _threads,
         break;
       }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+      case LOOPBACK:
+        /* Servers bind their handlers in this process; nothing to address. */
+        break;
+#endif
+      default:
+        break;
     }
   }
   run();
@@ -88,6 +168,13 @@ void RPC::run() {
         break;
       }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+      case LOOPBACK:
+        HCL_LOG_INFO("Running server %d in process\n", my_server_index);
+        break;
+#endif
+      default:
+        break;
     }
   }
   switch (HCL_CONF->RPC_IMPLEMENTATION) {
@@ -100,5 +187,94 @@ void RPC::run() {
       break;
     }
 #endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK:
+      /* Calls run the handler on the calling thread, no engine is needed. */
+      break;
+#endif
+    default:
+      break;
   }
 }
+
+void RPC::sleep(std::chrono::microseconds duration) {
+  switch (HCL_CONF->RPC_IMPLEMENTATION) {
+#ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
+    case THALLIUM: {
+      tl::thread::sleep(*thallium_client,
+                        static_cast<double>(duration.count()) / 1000.0);
+      return;
+    }
+#endif
+    default:
+      break;
+  }
+  /* Loopback handlers run on the caller's thread. */
+  std::this_thread::sleep_for(duration);
+}
+
+bool RPC::wait_until(std::function<bool()> done,
+                     std::chrono::microseconds timeout) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  bool bounded = timeout != std::chrono::microseconds::max();
+  auto deadline = std::chrono::steady_clock::now();
+  if (bounded) deadline += timeout;
+  std::chrono::microseconds pause(20);
+  while (!done()) {
+    auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (bounded && left.count() <= 0) return false;
+    sleep(bounded ? std::min(pause, left) : pause);
+    pause = std::min(pause * 2, std::chrono::microseconds(1000));
+  }
+  return true;
+}
+
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+uint16_t RPC::loopback_server(CharStruct const &server, uint16_t port) {
+  for (uint16_t i = 0; i < uris.size(); ++i) {
+    if (uris[i].ip == server && uris[i].port == port) return i;
+  }
+  HCL_LOG_ERROR("No server listed at %s:%d\n", server.c_str(), port);
+  throw std::logic_error("Unknown loopback server.");
+}
+#endif
+
+RPC::Procedure RPC::define(CharStruct const &func_name) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  Procedure procedure;
+  switch (HCL_CONF->RPC_IMPLEMENTATION) {
+#ifdef HCL_COMMUNICATION_ENABLE_THALLIUM
+    case THALLIUM: {
+      procedure.thallium_procedure = std::make_shared<tl::remote_procedure>(
+          thallium_client->define(func_name.c_str()));
+      procedure.thallium_deadline_procedure =
+          std::make_shared<tl::remote_procedure>(
+              thallium_client->define(deadline_name(func_name).c_str()));
+      break;
+    }
+#endif
+#ifdef HCL_COMMUNICATION_ENABLE_LOOPBACK
+    case LOOPBACK: {
+      /* Resolved on each call since the server may bind after the client. */
+      procedure.loopback_name = func_name;
+      break;
+    }
+#endif
+    default:
+      break;
+  }
+  return procedure;
+}
+
+#if defined(HCL_COMMUNICATION_ENABLE_THALLIUM)
+tl::bulk RPC::expose(void *data, really_long size, tl::bulk_mode mode) {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::vector<std::pair<void *, std::size_t>> segments(
+      1, std::make_pair(data, static_cast<std::size_t>(size)));
+  return thallium_client->expose(segments, mode);
+}
+#endif
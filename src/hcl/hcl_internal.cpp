@@ -86,13 +86,22 @@ int HCL::ConfigureInternal(bool initialize, uint16_t _port,
   }
   if (initialize || _server_list_path.size() != 0 || _uri.size() != 0 ||
       previous_port != conf->RPC_PORT) {
-    auto uris = LoadURI(conf->RPC_PORT, conf->SERVER_LIST_PATH, conf->URI,
-                        conf->MY_SERVER, conf->IS_SERVER);
+    std::vector<URI> uris;
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+    if (conf->RPC_IMPLEMENTATION == LOOPBACK) {
+      /* Servers live in this process, so NUM_SERVERS is taken as given. */
+      CreateRPC(conf->RPC_PORT, uris);
+      return 0;
+    }
+#endif
+    uris = LoadURI(conf->RPC_PORT, conf->SERVER_LIST_PATH, conf->URI,
+                   conf->MY_SERVER, conf->IS_SERVER);
     if (uris.size() != conf->NUM_SERVERS) {
       conf->NUM_SERVERS = uris.size();
-      if (conf->IS_SERVER == 1)
+      if (conf->IS_SERVER == 1) {
         HCL_LOG_INFO("Making number of servers match the server list to %d",
                      conf->NUM_SERVERS);
+      }
     }
     CreateRPC(conf->RPC_PORT, uris);
   }
@@ -111,7 +120,7 @@ HCL::HCL(uint16_t _port, uint16_t _num_servers, int16_t _my_server_idx,
          really_long _memory_allocated, int16_t _is_server,
          int16_t _is_server_on_node, CharStruct _backed_file_dir,
          CharStruct _server_list_path, CharStruct _uri)
-    : rpcs() {
+    : rpcs(), node_mutex(), node() {
   conf = HCL_CONF;
   ConfigureInternalEnv();
   HCL_LOGGER_INIT();
@@ -123,6 +132,7 @@ HCL::HCL(uint16_t _port, uint16_t _num_servers, int16_t _my_server_idx,
 
 int HCL::Finalize() {
   rpcs.clear();
+  node.reset();
   return 0;
 }
 
@@ -150,4 +160,18 @@ std::shared_ptr<RPC> HCL::GetRPC(uint16_t server_port) {
         "datastructure on new port.");
   }
 }
-}  // namespace hcl
\ No newline at end of file
+
+std::shared_ptr<node_segment> HCL::GetNodeSegment() {
+  HCL_LOG_TRACE();
+  HCL_CPP_FUNCTION()
+  std::lock_guard<std::mutex> guard(node_mutex);
+  if (node == nullptr && conf->NODE_SEGMENT_SIZE > 0) {
+    node = std::make_shared<node_segment>(
+        conf->IS_SERVER,
+        conf->BACKED_FILE_DIR + PATH_SEPARATOR + "hcl_node_" +
+            std::to_string(conf->MY_SERVER),
+        conf->NODE_SEGMENT_SIZE, conf->PERSISTENT_SEGMENTS);
+  }
+  return node;
+}
+}  // namespace hcl
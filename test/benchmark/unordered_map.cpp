@@ -140,6 +140,112 @@ TEMPLATE_TEST_CASE_SIG("unordered_map", "[unordered_map]",
     }
 #ifndef DISABLE_MPI
     MPI_Barrier(MPI_COMM_WORLD);
+#endif
+  }
+  SECTION("remote_async") {
+    REQUIRE(configure_hcl(false) == 0);
+    std::shared_ptr<MapType> rmap;
+    if (info.is_server) {
+      rmap = std::make_shared<MapType>("RemoteAsync" +
+                                       std::to_string(info.test_count));
+    }
+#ifndef DISABLE_MPI
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (!info.is_server) {
+      rmap = std::make_shared<MapType>("RemoteAsync" +
+                                       std::to_string(info.test_count));
+    }
+#endif
+    if (info.is_client) {
+      hcl::test::Timer put_time = hcl::test::Timer();
+
+      Value v = {10};
+      std::vector<RPCFuture<bool>> puts;
+      puts.reserve(args.num_request);
+      put_time.resumeTime();
+      for (int i = 1; i <= args.num_request; i++) {
+        Key k = Key(i);
+        puts.push_back(rmap->AsyncPut(k, v));
+      }
+      for (auto &put : puts) {
+        REQUIRE(put.get());
+      }
+      put_time.pauseTime();
+      hcl::test::Timer get_time = hcl::test::Timer();
+
+      std::vector<RPCFuture<std::pair<bool, Value>>> gets;
+      gets.reserve(args.num_request);
+      get_time.resumeTime();
+      for (int i = 1; i <= args.num_request; i++) {
+        Key k = Key(i);
+        gets.push_back(rmap->AsyncGet(k));
+      }
+      for (auto &get : gets) {
+        REQUIRE(get.get().first);
+      }
+      get_time.pauseTime();
+      AGGREGATE_TIME(put, info.client_comm);
+      AGGREGATE_TIME(get, info.client_comm);
+      if (info.client_rank == 0) {
+        HCL_LOG_PRINT("hcl remote async put throughput: %f\n",
+                      total_requests / total_put * info.client_comm_size);
+        HCL_LOG_PRINT("hcl remote async get throughput: %f\n",
+                      total_requests / total_get * info.client_comm_size);
+      }
+    }
+#ifndef DISABLE_MPI
+    MPI_Barrier(MPI_COMM_WORLD);
+#endif
+  }
+  SECTION("remote_batch") {
+    REQUIRE(configure_hcl(false) == 0);
+    HCL_CONF->BATCH_SIZE = 64;
+    std::shared_ptr<MapType> rmap;
+    if (info.is_server) {
+      rmap = std::make_shared<MapType>("RemoteBatch" +
+                                       std::to_string(info.test_count));
+    }
+#ifndef DISABLE_MPI
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (!info.is_server) {
+      rmap = std::make_shared<MapType>("RemoteBatch" +
+                                       std::to_string(info.test_count));
+    }
+#endif
+    if (info.is_client) {
+      hcl::test::Timer put_time = hcl::test::Timer();
+
+      Value v = {10};
+      put_time.resumeTime();
+      for (int i = 1; i <= args.num_request; i++) {
+        Key k = Key(i);
+        REQUIRE(rmap->Put(k, v));
+      }
+      REQUIRE(rmap->Flush());
+      put_time.pauseTime();
+      hcl::test::Timer get_time = hcl::test::Timer();
+
+      std::vector<Key> keys;
+      keys.reserve(args.num_request);
+      for (int i = 1; i <= args.num_request; i++) keys.push_back(Key(i));
+      get_time.resumeTime();
+      auto values = rmap->GetBatch(keys);
+      get_time.pauseTime();
+      for (auto &value : values) {
+        REQUIRE(value.first);
+      }
+      AGGREGATE_TIME(put, info.client_comm);
+      AGGREGATE_TIME(get, info.client_comm);
+      if (info.client_rank == 0) {
+        HCL_LOG_PRINT("hcl remote batch put throughput: %f\n",
+                      total_requests / total_put * info.client_comm_size);
+        HCL_LOG_PRINT("hcl remote batch get throughput: %f\n",
+                      total_requests / total_get * info.client_comm_size);
+      }
+    }
+    HCL_CONF->BATCH_SIZE = 0;
+#ifndef DISABLE_MPI
+    MPI_Barrier(MPI_COMM_WORLD);
 #endif
   }
   HCL_LOG_INFO("Running Post %d", info.test_count + 1);
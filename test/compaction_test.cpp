@@ -0,0 +1,154 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <hcl.h>
+
+#include <numeric>
+#include <string>
+#include <vector>
+
+/**
+ * A server whose segment was fragmented by erasing most of its entries is
+ * compacted, one small slice at a time, while its data stays readable.
+ */
+namespace hcl::test {
+struct Arguments {
+  std::string backed_file_dir = "/dev/shm";
+  int num_request = 20000;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.backed_file_dir,
+                 "backed_file_dir")["--dir"]("Directory of the segments") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Entries written first");
+}
+
+int catch_init(int* argc, char*** argv) {
+  HCL_CONF->COMPACTION_SLICE = 64;
+  hcl::HCL::GetInstance(true, 9700, 1, 0, 0, true, false,
+                        args.backed_file_dir, "");
+  return 0;
+}
+
+int catch_finalize() {
+  hcl::HCL::GetInstance(false)->Finalize();
+  return 0;
+}
+
+namespace {
+/** Every other key is kept, so no two holes are next to each other. */
+bool kept(int key) { return key % 2 == 0; }
+
+/**
+ * A value with its elements in the segment, so erasing leaves holes. The
+ * kept values are larger than those holes, so moving them all would cut
+ * into the free space at the end of the segment.
+ */
+std::vector<int> value_of(int key) {
+  return std::vector<int>(kept(key) ? 64 + key % 8 : 4 + key % 8, key);
+}
+
+/** Writes count keys and erases the ones that are not kept. */
+template <typename Server, typename ValueOf>
+bool fragment(Server& server, int count, ValueOf value_of) {
+  for (int key = 0; key < count; ++key) {
+    auto value = value_of(key);
+    if (!server.LocalPut(key, value)) return false;
+  }
+  for (int key = 0; key < count; ++key)
+    if (!kept(key) && !server.LocalErase(key).first) return false;
+  return true;
+}
+
+/** @return long, keys whose value is not the one written. */
+template <typename Server>
+long wrong_values(Server& server, int count) {
+  long wrong = 0;
+  for (int key = 0; key < count; ++key) {
+    auto found = server.LocalGet(key);
+    if (found.first != kept(key) ||
+        (found.first && found.second != value_of(key)))
+      ++wrong;
+  }
+  return wrong;
+}
+
+/** Checks that Compact() helped and made nothing worse. */
+void check_pass(hcl::container& server) {
+  auto usage = server.Compact();
+  INFO("largest free block " << usage.first.largest_free_block << " -> "
+                             << usage.second.largest_free_block);
+  REQUIRE(usage.second.free_memory > 0);
+  REQUIRE(usage.second.largest_free_block > usage.first.largest_free_block);
+  REQUIRE(usage.second.fragmentation() < usage.first.fragmentation());
+  REQUIRE(usage.first.free_blocks.empty());
+}
+}  // namespace
+
+TEST_CASE("CompactUnorderedMap", "[compaction]") {
+  typedef hcl::unordered_map<int, std::vector<int>> Map;
+  Map server("COMPACTED_HASH", 9700, 1, 0, 1ULL << 26, true, false,
+             args.backed_file_dir);
+  int count = args.num_request;
+  REQUIRE(fragment(server, count, value_of));
+  check_pass(server);
+  REQUIRE(wrong_values(server, count) == 0);
+  SECTION("the histogram is only built when asked for") {
+    auto usage = server.GetSegmentUsage(true);
+    really_long blocks = std::accumulate(usage.free_blocks.begin(),
+                                         usage.free_blocks.end(),
+                                         really_long(0));
+    REQUIRE(blocks >= 1);
+    REQUIRE(usage.largest_free_block ==
+            server.GetSegmentUsage().largest_free_block);
+  }
+  SECTION("the table stays writable") {
+    for (int key = 0; key < count; ++key) {
+      auto value = value_of(key);
+      if (!kept(key)) REQUIRE(server.LocalPut(key, value));
+    }
+    int last = count - 1;
+    REQUIRE(server.LocalGet(last).second == value_of(last));
+  }
+}
+
+TEST_CASE("CompactMap", "[compaction]") {
+  typedef hcl::map<int, std::vector<int>> Map;
+  Map server("COMPACTED_TREE", 9700, 1, 0, 1ULL << 26, true, false,
+             args.backed_file_dir);
+  int count = args.num_request;
+  REQUIRE(fragment(server, count, value_of));
+  check_pass(server);
+  REQUIRE(wrong_values(server, count) == 0);
+}
+
+TEST_CASE("CompactSet", "[compaction]") {
+  typedef hcl::set<int> Set;
+  Set server("COMPACTED_SET", 9700, 1, 0, 1ULL << 26, true, false,
+             args.backed_file_dir);
+  int count = args.num_request;
+  for (int key = 0; key < count; ++key) REQUIRE(server.LocalPut(key));
+  for (int key = 0; key < count; ++key)
+    if (!kept(key)) REQUIRE(server.LocalErase(key));
+  check_pass(server);
+  /* Still sorted, and nothing lost or duplicated. */
+  std::vector<int> held(server.data()->begin(), server.data()->end());
+  std::vector<int> expected;
+  for (int key = 0; key < count; ++key)
+    if (kept(key)) expected.push_back(key);
+  REQUIRE(held == expected);
+}
@@ -0,0 +1,194 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <hcl.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Three servers over LOOPBACK with hot keys. A client reads one key until
+ * its owner promotes it, and the Get and HotGet handlers of every server
+ * are swapped for ones that count, to see where its reads go.
+ */
+namespace hcl::test {
+struct Arguments {
+  std::string backed_file_dir = "/dev/shm";
+  int num_request = 1000;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.backed_file_dir,
+                 "backed_file_dir")["--dir"]("Directory of the segments") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Reads of the hot key");
+}
+
+int catch_init(int* argc, char*** argv) {
+  HCL_CONF->HOT_KEY_THRESHOLD = 16;
+  HCL_CONF->HOT_KEY_WINDOW_MS = 50;
+  HCL_CONF->HOT_KEY_MAX = 4;
+  hcl::HCL::GetInstance(true, 9400, 3, 0, 0, true, false,
+                        args.backed_file_dir, "");
+  return 0;
+}
+
+int catch_finalize() {
+  hcl::HCL::GetInstance(false)->Finalize();
+  return 0;
+}
+
+typedef hcl::unordered_map<int, int> Map;
+typedef hcl::routed<std::pair<bool, int>> Reply;
+
+namespace {
+const uint16_t NUM_SERVERS = 3;
+
+struct cluster {
+  std::vector<std::unique_ptr<Map>> servers;
+  std::unique_ptr<Map> client;
+  /** Reads each server answered as the owner, and from its copy **/
+  std::vector<std::atomic<long>> owner_reads, copy_reads;
+  /** A key owned by server 1 **/
+  int key;
+
+  explicit cluster(const std::string& name)
+      : owner_reads(NUM_SERVERS), copy_reads(NUM_SERVERS), key(-1) {
+    for (uint16_t i = 0; i < NUM_SERVERS; ++i)
+      servers.emplace_back(new Map(name, 9400, NUM_SERVERS, i, 1ULL << 24,
+                                   true, false, args.backed_file_dir));
+    client.reset(new Map(name, 9400, NUM_SERVERS, 0, 1ULL << 24, false, false,
+                         args.backed_file_dir));
+    auto rpc = hcl::HCL::GetInstance(false)->GetRPC(9400);
+    for (uint16_t s = 0; s < NUM_SERVERS; ++s) {
+      Map* server = servers[s].get();
+      std::atomic<long>* owner = &owner_reads[s];
+      std::atomic<long>* copy = &copy_reads[s];
+      rpc->bind_loopback(s, name + "_Get",
+                         std::function<Reply(int&)>([server, owner](int& k) {
+                           ++*owner;
+                           return server->LocalRoutedGet(k);
+                         }));
+      rpc->bind_loopback(s, name + "_HotGet",
+                         std::function<Reply(int&)>([server, copy](int& k) {
+                           ++*copy;
+                           return server->LocalHotGet(k);
+                         }));
+    }
+    for (int i = 0; key < 0; ++i) {
+      REQUIRE(client->Put(i, i));
+      if (servers[1]->LocalGet(i).first) key = i;
+    }
+  }
+
+  long total(std::vector<std::atomic<long>>& reads) {
+    long sum = 0;
+    for (auto& count : reads) sum += count;
+    return sum;
+  }
+
+  /**
+   * Reads key until the owner promotes it and every server has its copy,
+   * i.e. until a read of each server skips the owner.
+   */
+  bool promote() {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    int skipped = 0;
+    while (std::chrono::steady_clock::now() < deadline) {
+      long before = owner_reads[1];
+      client->Get(key);
+      skipped = owner_reads[1] == before ? skipped + 1 : 0;
+      if (skipped == NUM_SERVERS) return true;
+      /* The copies are sent in the background. */
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+};
+}  // namespace
+
+TEST_CASE("HotKeyPromotion", "[hot_key]") {
+  cluster keys("HOT_PROMOTED");
+  int value = keys.client->Get(keys.key).second;
+  REQUIRE(keys.promote());
+  /* Every server answers reads of the key from its copy. */
+  long owner = keys.owner_reads[1];
+  long copies = keys.total(keys.copy_reads);
+  long wrong = 0;
+  for (int i = 0; i < args.num_request; ++i) {
+    auto found = keys.client->Get(keys.key);
+    if (!found.first || found.second != value) ++wrong;
+  }
+  REQUIRE(wrong == 0);
+  REQUIRE(keys.owner_reads[1] == owner);
+  REQUIRE(keys.total(keys.copy_reads) == copies + args.num_request);
+  for (uint16_t s = 0; s < NUM_SERVERS; ++s) {
+    INFO("server " << s << " read " << keys.copy_reads[s]);
+    REQUIRE(keys.copy_reads[s] > args.num_request / 6);
+  }
+}
+
+TEST_CASE("HotKeyWrites", "[hot_key]") {
+  cluster keys("HOT_WRITTEN");
+  REQUIRE(keys.promote());
+  SECTION("a read after a write sees it") {
+    long stale = 0;
+    for (int i = 0; i < args.num_request; ++i) {
+      REQUIRE(keys.client->Put(keys.key, i));
+      /* Three reads, so each server answers one. */
+      for (int read = 0; read < NUM_SERVERS; ++read) {
+        auto found = keys.client->Get(keys.key);
+        if (!found.first || found.second != i) ++stale;
+      }
+    }
+    REQUIRE(stale == 0);
+    long owner = keys.owner_reads[1];
+    keys.client->Get(keys.key);
+    REQUIRE(keys.owner_reads[1] == owner);
+  }
+  SECTION("a read after an erase misses") {
+    REQUIRE(keys.client->Erase(keys.key).first);
+    for (int read = 0; read < NUM_SERVERS; ++read)
+      REQUIRE_FALSE(keys.client->Get(keys.key).first);
+    /* Its copies were dropped, so reads went back to the owner. */
+    long owner = keys.owner_reads[1];
+    REQUIRE_FALSE(keys.client->Get(keys.key).first);
+    REQUIRE(keys.owner_reads[1] == owner + 1);
+  }
+}
+
+TEST_CASE("HotKeyDemotion", "[hot_key]") {
+  cluster keys("HOT_DEMOTED");
+  REQUIRE(keys.promote());
+  /* Unread, its count halves every window until it cools down. */
+  std::this_thread::sleep_for(std::chrono::milliseconds(
+      20 * static_cast<int>(HCL_CONF->HOT_KEY_WINDOW_MS)));
+  keys.client->Get(keys.key);
+  long owner = keys.owner_reads[1];
+  long copies = keys.total(keys.copy_reads);
+  auto found = keys.client->Get(keys.key);
+  REQUIRE(found.first);
+  REQUIRE(keys.owner_reads[1] == owner + 1);
+  REQUIRE(keys.total(keys.copy_reads) == copies);
+  /* Read often enough again, it is promoted again. */
+  REQUIRE(keys.promote());
+}
@@ -0,0 +1,270 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <hcl.h>
+#include <hcl/common/lease_table.h>
+#include <hcl/common/near_cache.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * The client cache of remote reads and the leases servers grant on them,
+ * each on its own and then together over LOOPBACK, where a client must not
+ * read its cached value once another client overwrote it.
+ */
+namespace hcl::test {
+struct Arguments {
+  std::string backed_file_dir = "/dev/shm";
+  int num_request = 100;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.backed_file_dir,
+                 "backed_file_dir")["--dir"]("Directory of the segments") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Keys cached by each test");
+}
+
+int catch_init(int* argc, char*** argv) {
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+  hcl::HCL::GetInstance(true, 9500, 1, 0, 0, true, false,
+                        args.backed_file_dir, "");
+#endif
+  return 0;
+}
+
+int catch_finalize() {
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+  hcl::HCL::GetInstance(false)->Finalize();
+#endif
+  return 0;
+}
+
+namespace {
+typedef std::chrono::steady_clock steady;
+const auto LATER = std::chrono::hours(1);
+const uint32_t LEASE_MS = 50;
+
+std::unique_ptr<hcl::lease_table> new_table() {
+  return std::unique_ptr<hcl::lease_table>(new hcl::lease_table(
+      64, [](std::chrono::microseconds duration) {
+        std::this_thread::sleep_for(duration);
+      }));
+}
+
+/** @return uint64_t, a hash after start that the table puts elsewhere. */
+uint64_t other_bucket(hcl::lease_table& table, uint64_t start) {
+  uint64_t hash = start + 1;
+  while (table.bucket_of(hash) == table.bucket_of(start)) ++hash;
+  return hash;
+}
+
+long elapsed_ms(steady::time_point since) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(steady::now() -
+                                                               since)
+      .count();
+}
+}  // namespace
+
+TEST_CASE("NearCacheBytes", "[near_cache]") {
+  hcl::near_cache<int, int> cache(100);
+  int value = 0;
+  REQUIRE_FALSE(cache.find(1, value));
+  cache.insert(1, 10, 30, steady::now() + LATER);
+  cache.insert(2, 20, 30, steady::now() + LATER);
+  REQUIRE(cache.size() == 60);
+  REQUIRE(cache.find(1, value));
+  REQUIRE(value == 10);
+  SECTION("a new value replaces the old one and its bytes") {
+    cache.insert(1, 11, 50, steady::now() + LATER);
+    REQUIRE(cache.size() == 80);
+    REQUIRE(cache.find(1, value));
+    REQUIRE(value == 11);
+  }
+  SECTION("erase gives the bytes back") {
+    cache.erase(1);
+    cache.erase(3);
+    REQUIRE(cache.size() == 30);
+    REQUIRE_FALSE(cache.find(1, value));
+  }
+  SECTION("a value larger than the cache is not kept") {
+    cache.insert(2, 21, 101, steady::now() + LATER);
+    REQUIRE(cache.size() == 30);
+    REQUIRE_FALSE(cache.find(2, value));
+  }
+  SECTION("an ended lease is not read") {
+    cache.insert(3, 30, 10, steady::now() - std::chrono::milliseconds(1));
+    REQUIRE_FALSE(cache.find(3, value));
+    REQUIRE(cache.size() == 70);
+  }
+}
+
+TEST_CASE("NearCacheClock", "[near_cache]") {
+  int count = args.num_request;
+  hcl::near_cache<int, int> cache(count);
+  for (int i = 0; i < count; ++i) cache.insert(i, i, 1, steady::now() + LATER);
+  REQUIRE(cache.size() == static_cast<size_t>(count));
+  int value = 0;
+  SECTION("referenced entries get a second chance") {
+    for (int i = 0; i < count / 2; ++i) REQUIRE(cache.find(i, value));
+    for (int i = count; i < count + count / 2; ++i)
+      cache.insert(i, i, 1, steady::now() + LATER);
+    REQUIRE(cache.size() == static_cast<size_t>(count));
+    for (int i = 0; i < count / 2; ++i) REQUIRE(cache.find(i, value));
+    for (int i = count / 2; i < count; ++i) REQUIRE_FALSE(cache.find(i, value));
+    for (int i = count; i < count + count / 2; ++i)
+      REQUIRE(cache.find(i, value));
+  }
+  SECTION("expired entries go first, even if referenced") {
+    cache.insert(count - 1, 0, 1, steady::now() - std::chrono::milliseconds(1));
+    for (int i = 0; i < count - 1; ++i) REQUIRE(cache.find(i, value));
+    cache.insert(count, count, 1, steady::now() + LATER);
+    for (int i = 0; i <= count; ++i)
+      REQUIRE(cache.find(i, value) == (i != count - 1));
+  }
+  SECTION("without references it evicts in insertion order") {
+    for (int i = count; i < 2 * count; ++i) {
+      cache.insert(i, i, 1, steady::now() + LATER);
+      REQUIRE_FALSE(cache.find(i - count, value));
+      REQUIRE(cache.size() == static_cast<size_t>(count));
+    }
+  }
+}
+
+TEST_CASE("LeaseHold", "[lease_table]") {
+  auto table = new_table();
+  uint64_t hash = 42, other = other_bucket(*table, 42);
+  SECTION("a write waits for the lease on its bucket") {
+    auto start = steady::now();
+    REQUIRE(table->grant(hash, LEASE_MS));
+    REQUIRE(table->still_valid(hash));
+    { hcl::lease_hold hold(table.get(), other); }
+    REQUIRE(elapsed_ms(start) < LEASE_MS);
+    { hcl::lease_hold hold(table.get(), std::vector<uint64_t>{other, hash}); }
+    REQUIRE(elapsed_ms(start) >= LEASE_MS);
+  }
+  SECTION("no lease is granted while a write holds the bucket") {
+    {
+      hcl::lease_hold hold(table.get(), hash);
+      REQUIRE_FALSE(table->grant(hash, LEASE_MS));
+      REQUIRE_FALSE(table->still_valid(hash));
+      REQUIRE(table->grant(other, LEASE_MS));
+    }
+    REQUIRE(table->grant(hash, LEASE_MS));
+  }
+  SECTION("a lease granted as a write starts is withdrawn") {
+    REQUIRE(table->grant(hash, LEASE_MS));
+    auto writer = std::async(std::launch::async, [&]() {
+      hcl::lease_hold hold(table.get(), hash);
+    });
+    /* The write counts itself before it waits for the lease. */
+    auto deadline = steady::now() + std::chrono::seconds(30);
+    while (table->still_valid(hash) && steady::now() < deadline)
+      std::this_thread::yield();
+    REQUIRE_FALSE(table->still_valid(hash));
+    REQUIRE(writer.wait_for(std::chrono::seconds(30)) ==
+            std::future_status::ready);
+    REQUIRE(table->still_valid(hash));
+  }
+  SECTION("without a table nothing is held") {
+    hcl::lease_hold hold(nullptr, hash);
+    hcl::lease_pause pause(nullptr);
+    REQUIRE(table->grant(hash, LEASE_MS));
+  }
+}
+
+TEST_CASE("LeasePause", "[lease_table]") {
+  auto table = new_table();
+  uint64_t hash = 42, other = other_bucket(*table, 42);
+  auto start = steady::now();
+  REQUIRE(table->grant(hash, LEASE_MS / 2));
+  REQUIRE(table->grant(other, LEASE_MS));
+  {
+    hcl::lease_pause pause(table.get());
+    REQUIRE(elapsed_ms(start) >= LEASE_MS);
+    REQUIRE_FALSE(table->grant(hash, LEASE_MS));
+    REQUIRE_FALSE(table->still_valid(other));
+    /* Pauses nest. */
+    { hcl::lease_pause nested(table.get()); }
+    REQUIRE_FALSE(table->grant(other, LEASE_MS));
+  }
+  REQUIRE(table->grant(hash, LEASE_MS));
+  REQUIRE(table->still_valid(other));
+}
+
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+TEST_CASE("NearCacheInvalidation", "[near_cache]") {
+  typedef hcl::unordered_map<int, int> Map;
+  typedef hcl::routed<std::pair<bool, int>> Reply;
+  really_long bytes = HCL_CONF->NEAR_CACHE_BYTES;
+  uint32_t lease_ms = HCL_CONF->NEAR_CACHE_LEASE_MS;
+  HCL_CONF->NEAR_CACHE_BYTES = 1 << 20;
+  HCL_CONF->NEAR_CACHE_LEASE_MS = LEASE_MS;
+  {
+    Map server("NEAR_CACHED", 9500, 1, 0, 1ULL << 24, true, false,
+               args.backed_file_dir);
+    Map reader("NEAR_CACHED", 9500, 1, 0, 1ULL << 24, false, false,
+               args.backed_file_dir);
+    Map writer("NEAR_CACHED", 9500, 1, 0, 1ULL << 24, false, false,
+               args.backed_file_dir);
+    std::atomic<long> served(0);
+    hcl::HCL::GetInstance(false)->GetRPC(9500)->bind_loopback(
+        0, "NEAR_CACHED_LeasedGet",
+        std::function<Reply(int&)>([&](int& key) {
+          ++served;
+          return server.LocalLeasedGet(key);
+        }));
+    auto get = [](Map& client, int key) { return client.Get(key); };
+    int count = args.num_request;
+    for (int i = 0; i < count; ++i) REQUIRE(writer.Put(i, i));
+    auto leased = steady::now();
+    for (int i = 0; i < count; ++i) REQUIRE(get(reader, i).second == i);
+    REQUIRE(served == count);
+    /* Read again under the leases, from the cache. */
+    for (int i = 0; i < count; ++i) REQUIRE(get(reader, i).second == i);
+    REQUIRE(served == count);
+    SECTION("a write by another client is seen") {
+      REQUIRE(writer.Put(0, -1));
+      /* It waited for the reader's lease to end. */
+      REQUIRE(elapsed_ms(leased) >= LEASE_MS);
+      auto found = get(reader, 0);
+      REQUIRE(found.first);
+      REQUIRE(found.second == -1);
+      REQUIRE(served == count + 1);
+    }
+    SECTION("an erase by another client is seen") {
+      int key = 1;
+      REQUIRE(writer.Erase(key).first);
+      REQUIRE_FALSE(get(reader, key).first);
+    }
+    SECTION("the reader's own write drops its entry at once") {
+      REQUIRE(reader.Put(2, -2));
+      REQUIRE(get(reader, 2).second == -2);
+    }
+  }
+  HCL_CONF->NEAR_CACHE_BYTES = bytes;
+  HCL_CONF->NEAR_CACHE_LEASE_MS = lease_ms;
+}
+#endif
@@ -0,0 +1,158 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <hcl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+/**
+ * A server and an on-node client in a forked process write the same
+ * unordered_map at once. Both go straight to the segment, so they only
+ * stay consistent through the lock stripes stored in it, also while either
+ * of them grows the segment.
+ */
+namespace hcl::test {
+struct Arguments {
+  std::string backed_file_dir = "/dev/shm";
+  int num_request = 20000;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.backed_file_dir,
+                 "backed_file_dir")["--dir"]("Directory of the segments") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Puts of each process");
+}
+
+int catch_init(int* argc, char*** argv) {
+  hcl::HCL::GetInstance(true, 9000, 1, 0, 0, true, true,
+                        args.backed_file_dir, "");
+  return 0;
+}
+
+int catch_finalize() {
+  hcl::HCL::GetInstance(false)->Finalize();
+  return 0;
+}
+
+typedef hcl::unordered_map<int, int> Map;
+
+namespace {
+/** Sends a byte down fd, or waits for one to come up it. */
+bool signal_fd(int fd) {
+  char byte = 1;
+  return write(fd, &byte, 1) == 1;
+}
+bool wait_fd(int fd) {
+  char byte;
+  return read(fd, &byte, 1) == 1;
+}
+
+/**
+ * Runs writes in a forked on-node client while the server runs its own,
+ * then checks that the server finds every key of both.
+ */
+void write_from_two_processes(const std::string& name, really_long memory) {
+  int count = args.num_request;
+  Map server(name, 9000, 1, 0, memory, true, true, args.backed_file_dir);
+  int ready[2], go[2];
+  REQUIRE(pipe(ready) == 0);
+  REQUIRE(pipe(go) == 0);
+  pid_t child = fork();
+  REQUIRE(child >= 0);
+  if (child == 0) {
+    /* Catch cannot report from here, so failures end up in the status. */
+    int status = 0;
+    try {
+      Map client(name, 9000, 1, 0, memory, false, true, args.backed_file_dir);
+      if (!signal_fd(ready[1]) || !wait_fd(go[0])) _exit(2);
+      for (int i = count; i < 2 * count; ++i)
+        if (!client.Put(i, i * 7)) status = 3;
+      for (int i = count; i < 2 * count; i += 2)
+        if (!client.Erase(i).first) status = 4;
+      for (int i = count; i < 2 * count; ++i)
+        if (client.Get(i).first != (i % 2 == 1)) status = 5;
+    } catch (const std::exception& e) {
+      fprintf(stderr, "on-node client failed: %s\n", e.what());
+      status = 6;
+    }
+    /* The copy of the server must not tear down the segment. */
+    _exit(status);
+  }
+  REQUIRE(wait_fd(ready[0]));
+  REQUIRE(signal_fd(go[1]));
+  int failed = 0;
+  for (int i = 0; i < count; ++i)
+    if (!server.Put(i, i * 7)) ++failed;
+  REQUIRE(failed == 0);
+  int status = 0;
+  REQUIRE(waitpid(child, &status, 0) == child);
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(WEXITSTATUS(status) == 0);
+  int missing = 0;
+  for (int i = 0; i < 2 * count; ++i) {
+    auto result = server.Get(i);
+    bool expected = i < count || i % 2 == 1;
+    if (result.first != expected || (expected && result.second != i * 7))
+      ++missing;
+  }
+  REQUIRE(missing == 0);
+  for (int fd : {ready[0], ready[1], go[0], go[1]}) close(fd);
+}
+}  // namespace
+
+TEST_CASE("OnNodeWrites", "[on_node]") {
+  write_from_two_processes("ON_NODE", 1ULL << 26);
+}
+
+TEST_CASE("OnNodeGrowth", "[on_node]") {
+  /* Both processes run out of the first megabyte and grow the segment. */
+  really_long max_memory = HCL_CONF->MAX_MEMORY_ALLOCATED;
+  HCL_CONF->MAX_MEMORY_ALLOCATED = 1ULL << 28;
+  write_from_two_processes("ON_NODE_GROWTH", 1ULL << 20);
+  HCL_CONF->MAX_MEMORY_ALLOCATED = max_memory;
+}
+
+TEST_CASE("OnNodeBackings", "[on_node]") {
+  SegmentBacking backing = HCL_CONF->SEGMENT_BACKING;
+  for (SegmentBacking tested :
+       {BACKING_FILE, BACKING_POSIX_SHM, BACKING_MEMFD}) {
+    INFO("backing " << tested);
+    HCL_CONF->SEGMENT_BACKING = tested;
+    write_from_two_processes("ON_NODE_BACKING_" + std::to_string(tested),
+                             1ULL << 26);
+  }
+  HCL_CONF->SEGMENT_BACKING = backing;
+}
+
+TEST_CASE("RemoteClientWithNodeSegment", "[on_node]") {
+  /* A client off the server's node has no node segment to open. */
+  really_long node_size = HCL_CONF->NODE_SEGMENT_SIZE;
+  bool is_server = HCL_CONF->IS_SERVER, on_node = HCL_CONF->SERVER_ON_NODE;
+  HCL_CONF->NODE_SEGMENT_SIZE = 1ULL << 20;
+  HCL_CONF->IS_SERVER = false;
+  HCL_CONF->SERVER_ON_NODE = false;
+  std::remove((args.backed_file_dir + "/hcl_node_0").c_str());
+  REQUIRE_NOTHROW(Map("REMOTE_ONLY", 9000, 1, 0, 1ULL << 20, false, false,
+                      args.backed_file_dir));
+  REQUIRE_NOTHROW(hcl::global_clock("REMOTE_CLOCK", 9000));
+  HCL_CONF->NODE_SEGMENT_SIZE = node_size;
+  HCL_CONF->IS_SERVER = is_server;
+  HCL_CONF->SERVER_ON_NODE = on_node;
+}
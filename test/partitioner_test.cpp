@@ -0,0 +1,222 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <hcl.h>
+#include <hcl/common/partitioner.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hcl::test {
+struct Arguments {
+  std::string backed_file_dir = "/dev/shm";
+  int num_request = 100000;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.backed_file_dir,
+                 "backed_file_dir")["--dir"]("Directory of the segments") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Keys placed by each test");
+}
+
+int catch_init(int* argc, char*** argv) {
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+  hcl::HCL::GetInstance(true, 9100, 3, 0, 0, true, false,
+                        args.backed_file_dir, "");
+#endif
+  return 0;
+}
+
+int catch_finalize() {
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+  hcl::HCL::GetInstance(false)->Finalize();
+#endif
+  return 0;
+}
+
+namespace {
+/** Hashes spread over 64 bits, as keyHash() gives them. */
+uint64_t hash_of(int i) { return hcl::partitioner::mix(i + 1); }
+
+/**
+ * Places num_request hashes and checks that every server gets its share
+ * within a tenth.
+ */
+void check_balanced(const hcl::partitioner& partition) {
+  uint16_t servers = partition.servers();
+  std::vector<long> placed(servers, 0);
+  for (int i = 0; i < args.num_request; ++i) {
+    uint16_t server = partition.server_of(hash_of(i));
+    REQUIRE(server < servers);
+    ++placed[server];
+  }
+  double share = static_cast<double>(args.num_request) / servers;
+  for (uint16_t server = 0; server < servers; ++server) {
+    INFO("server " << server << " got " << placed[server]);
+    REQUIRE(placed[server] > 0.9 * share);
+    REQUIRE(placed[server] < 1.1 * share);
+  }
+}
+}  // namespace
+
+TEST_CASE("Modulo", "[partitioner]") {
+  hcl::partitioner partition(PARTITION_MODULO, 7, 0);
+  for (int i = 0; i < 1000; ++i)
+    REQUIRE(partition.server_of(hash_of(i)) == hash_of(i) % 7);
+  check_balanced(partition);
+}
+
+TEST_CASE("Jump", "[partitioner]") {
+  for (uint16_t servers : {1, 2, 5, 16}) {
+    INFO("servers " << servers);
+    hcl::partitioner partition(PARTITION_JUMP, servers, 0);
+    check_balanced(partition);
+    /* A new server only takes keys over, none move between the others. */
+    hcl::partitioner grown(PARTITION_JUMP, servers + 1, 0);
+    long moved = 0;
+    for (int i = 0; i < args.num_request; ++i) {
+      uint16_t before = partition.server_of(hash_of(i));
+      uint16_t after = grown.server_of(hash_of(i));
+      if (before != after) {
+        REQUIRE(after == servers);
+        ++moved;
+      }
+    }
+    REQUIRE(moved < 1.1 * args.num_request / (servers + 1));
+  }
+}
+
+TEST_CASE("Slots", "[partitioner]") {
+  hcl::partitioner partition(PARTITION_SLOTS, 4, 256);
+  REQUIRE(partition.elastic());
+  REQUIRE(partition.slots() == 256);
+  for (uint32_t slot = 0; slot < partition.slots(); ++slot) {
+    hcl::slot_route route = partition.route_of(slot);
+    REQUIRE(route.owner == hcl::partitioner::jump(slot, 4));
+    REQUIRE(route.epoch == 0);
+  }
+  check_balanced(partition);
+  uint64_t hash = hash_of(42);
+  uint32_t slot = partition.slot_of(hash);
+  uint16_t owner = partition.server_of(hash);
+  uint16_t next = (owner + 1) % 4;
+  SECTION("a newer route wins, an older one is ignored") {
+    REQUIRE(partition.learn(hcl::slot_route{slot, next, 2}));
+    REQUIRE(partition.server_of(hash) == next);
+    REQUIRE(partition.get_version() == 1);
+    REQUIRE_FALSE(partition.learn(hcl::slot_route{slot, owner, 1}));
+    REQUIRE_FALSE(partition.learn(hcl::slot_route{slot, owner, 2}));
+    REQUIRE(partition.server_of(hash) == next);
+    REQUIRE(partition.get_version() == 1);
+  }
+  SECTION("routes out of the table are ignored") {
+    REQUIRE_FALSE(partition.learn(hcl::slot_route{256, next, 1}));
+    REQUIRE_FALSE(partition.learn(hcl::slot_route{slot, 4, 1}));
+    REQUIRE(partition.server_of(hash) == owner);
+  }
+  SECTION("inactive servers own no slots") {
+    partition.reset_slots(2);
+    for (uint32_t s = 0; s < partition.slots(); ++s) {
+      REQUIRE(partition.route_of(s).owner < 2);
+      REQUIRE(partition.route_of(s).epoch == 0);
+    }
+  }
+}
+
+TEST_CASE("Range", "[partitioner]") {
+  for (uint16_t servers : {1, 2, 3, 7, 1000, 65535}) {
+    INFO("servers " << servers);
+    hcl::partitioner partition(PARTITION_RANGE, servers, 0);
+    /* The ranges tile all 2^64 hashes, and differ by at most one point. */
+    REQUIRE(partition.range_begin(0) == 0);
+    REQUIRE(partition.range_begin(servers) == UINT64_MAX);
+    REQUIRE(partition.server_of(0) == 0);
+    REQUIRE(partition.server_of(UINT64_MAX) == servers - 1);
+    uint64_t smallest = UINT64_MAX, largest = 0;
+    for (uint32_t server = 0; server < servers; ++server) {
+      uint64_t begin = partition.range_begin(server);
+      uint64_t end = partition.range_begin(server + 1);
+      REQUIRE(begin < end);
+      REQUIRE(partition.server_of(begin) == server);
+      REQUIRE(partition.server_of(end - 1) == server);
+      /* The last range also holds UINT64_MAX itself. */
+      uint64_t size = end - begin + (server + 1 == servers ? 1 : 0);
+      if (servers > 1) {
+        smallest = std::min(smallest, size);
+        largest = std::max(largest, size);
+      }
+    }
+    if (servers > 1) REQUIRE(largest - smallest <= 1);
+  }
+  SECTION("a bounded domain") {
+    hcl::partitioner partition(PARTITION_RANGE, 3, 0, 10);
+    REQUIRE(partition.range_begin(1) == 4);
+    REQUIRE(partition.range_begin(2) == 7);
+    REQUIRE(partition.range_begin(3) == 10);
+    REQUIRE(partition.server_of(3) == 0);
+    REQUIRE(partition.server_of(4) == 1);
+    REQUIRE(partition.server_of(9) == 2);
+    /* Hashes past the domain wrap around it. */
+    REQUIRE(partition.server_of(13) == 0);
+  }
+  SECTION("hash order is kept") {
+    hcl::partitioner partition(PARTITION_RANGE, 5, 0);
+    uint16_t previous = 0;
+    for (uint64_t point = 0; point < 64; ++point) {
+      uint16_t server = partition.server_of(point << 58);
+      REQUIRE(server >= previous);
+      previous = server;
+    }
+    REQUIRE(previous == 4);
+  }
+}
+
+#if defined(HCL_COMMUNICATION_ENABLE_LOOPBACK)
+TEST_CASE("ClientsAndServersAgree", "[partitioner]") {
+  typedef hcl::unordered_map<int, int> Map;
+  PartitionScheme scheme = HCL_CONF->PARTITIONER;
+  for (PartitionScheme tested : {PARTITION_MODULO, PARTITION_JUMP,
+                                 PARTITION_SLOTS, PARTITION_RANGE}) {
+    INFO("scheme " << tested);
+    HCL_CONF->PARTITIONER = tested;
+    std::string name = "PARTITIONED_" + std::to_string(tested);
+    std::vector<std::unique_ptr<Map>> servers;
+    for (uint16_t i = 0; i < 3; ++i)
+      servers.emplace_back(new Map(name, 9100, 3, i, 1ULL << 24, true, false,
+                                   args.backed_file_dir));
+    Map writer(name, 9100, 3, 0, 1ULL << 24, false, false,
+               args.backed_file_dir);
+    Map reader(name, 9100, 3, 1, 1ULL << 24, false, false,
+               args.backed_file_dir);
+    int count = 2000, misplaced = 0;
+    for (int i = 0; i < count; ++i) REQUIRE(writer.Put(i, i));
+    for (int i = 0; i < count; ++i) {
+      auto found = reader.Get(i);
+      if (!found.first || found.second != i) ++misplaced;
+      /* Stored once, on the server both clients picked. */
+      int holders = 0;
+      for (auto& server : servers) holders += server->LocalGet(i).first;
+      if (holders != 1) ++misplaced;
+    }
+    REQUIRE(misplaced == 0);
+  }
+  HCL_CONF->PARTITIONER = scheme;
+}
+#endif
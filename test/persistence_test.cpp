@@ -0,0 +1,186 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <fcntl.h>
+#include <hcl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+
+/**
+ * A server with PERSISTENT_SEGMENTS set restarts on the segment its
+ * previous run left, and refuses one that was not closed cleanly, was
+ * built by another layout version or holds another container type.
+ */
+namespace hcl::test {
+struct Arguments {
+  std::string backed_file_dir = "/dev/shm";
+  int num_request = 10000;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.backed_file_dir,
+                 "backed_file_dir")["--dir"]("Directory of the segments") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Keys kept across restarts");
+}
+
+int catch_init(int* argc, char*** argv) {
+  hcl::HCL::GetInstance(true, 9600, 1, 0, 0, true, false,
+                        args.backed_file_dir, "");
+  return 0;
+}
+
+int catch_finalize() {
+  hcl::HCL::GetInstance(false)->Finalize();
+  return 0;
+}
+
+typedef hcl::unordered_map<int, int> Map;
+
+namespace {
+/** Offsets in the segment_header at the start of a backing file. */
+const off_t LAYOUT_VERSION_OFFSET = 8;
+
+/** A server of name that keeps its segment when it goes away. */
+Map* persistent_server(const std::string& name) {
+  bool persistent = HCL_CONF->PERSISTENT_SEGMENTS;
+  HCL_CONF->PERSISTENT_SEGMENTS = true;
+  Map* server = nullptr;
+  try {
+    server = new Map(name, 9600, 1, 0, 1ULL << 24, true, false,
+                     args.backed_file_dir);
+  } catch (...) {
+    HCL_CONF->PERSISTENT_SEGMENTS = persistent;
+    throw;
+  }
+  HCL_CONF->PERSISTENT_SEGMENTS = persistent;
+  return server;
+}
+
+/** Removes the segment a persistent server of name left behind. */
+void discard(const std::string& name) {
+  Map server(name, 9600, 1, 0, 1ULL << 20, true, false, args.backed_file_dir);
+}
+
+long missing(Map& server, int count) {
+  long lost = 0;
+  for (int i = 0; i < count; ++i) {
+    auto found = server.Get(i);
+    if (!found.first || found.second != i * 3) ++lost;
+  }
+  return lost;
+}
+
+bool write_at(const std::string& path, off_t offset, uint32_t value) {
+  int fd = open(path.c_str(), O_WRONLY);
+  if (fd < 0) return false;
+  bool written = pwrite(fd, &value, sizeof(value), offset) == sizeof(value);
+  close(fd);
+  return written;
+}
+}  // namespace
+
+TEST_CASE("Reopen", "[persistence]") {
+  SegmentBacking backing = HCL_CONF->SEGMENT_BACKING;
+  for (SegmentBacking tested : {BACKING_FILE, BACKING_POSIX_SHM}) {
+    INFO("backing " << tested);
+    HCL_CONF->SEGMENT_BACKING = tested;
+    std::string name = "REOPENED_" + std::to_string(tested);
+    int count = args.num_request;
+    {
+      std::unique_ptr<Map> server(persistent_server(name));
+      for (int i = 0; i < count; ++i) REQUIRE(server->Put(i, i * 3));
+    }
+    {
+      std::unique_ptr<Map> server(persistent_server(name));
+      REQUIRE(missing(*server, count) == 0);
+      /* Still writable, and kept again by the next restart. */
+      for (int i = count; i < 2 * count; ++i) REQUIRE(server->Put(i, i * 3));
+      int key = 0;
+      REQUIRE(server->Erase(key).first);
+    }
+    {
+      std::unique_ptr<Map> server(persistent_server(name));
+      REQUIRE(missing(*server, 2 * count) == 1);
+      int key = 0;
+      REQUIRE_FALSE(server->Get(key).first);
+    }
+    discard(name);
+  }
+  HCL_CONF->SEGMENT_BACKING = backing;
+}
+
+TEST_CASE("UncleanClose", "[persistence]") {
+  std::string name = "UNCLEAN";
+  pid_t child = fork();
+  REQUIRE(child >= 0);
+  if (child == 0) {
+    /* Ends without closing the segment, as a crashed server would. */
+    int status = 0;
+    try {
+      Map* server = persistent_server(name);
+      for (int i = 0; i < args.num_request; ++i)
+        if (!server->Put(i, i * 3)) status = 1;
+    } catch (const std::exception&) {
+      status = 2;
+    }
+    _exit(status);
+  }
+  int status = 0;
+  REQUIRE(waitpid(child, &status, 0) == child);
+  REQUIRE(WIFEXITED(status));
+  REQUIRE(WEXITSTATUS(status) == 0);
+  REQUIRE_THROWS_AS(persistent_server(name), std::runtime_error);
+  /* Without persistence the segment is rebuilt from scratch. */
+  discard(name);
+  std::unique_ptr<Map> server(persistent_server(name));
+  REQUIRE(missing(*server, 1) == 1);
+  server.reset();
+  discard(name);
+}
+
+TEST_CASE("LayoutVersion", "[persistence]") {
+  SegmentBacking backing = HCL_CONF->SEGMENT_BACKING;
+  HCL_CONF->SEGMENT_BACKING = BACKING_FILE;
+  std::string name = "OLD_LAYOUT";
+  delete persistent_server(name);
+  std::string path = args.backed_file_dir + "/" + name + "_0";
+  REQUIRE(write_at(path, LAYOUT_VERSION_OFFSET,
+                   HCL_SEGMENT_LAYOUT_VERSION - 1));
+  REQUIRE_THROWS_AS(persistent_server(name), std::runtime_error);
+  REQUIRE(write_at(path, LAYOUT_VERSION_OFFSET, HCL_SEGMENT_LAYOUT_VERSION));
+  delete persistent_server(name);
+  discard(name);
+  HCL_CONF->SEGMENT_BACKING = backing;
+}
+
+TEST_CASE("TypeHash", "[persistence]") {
+  std::string name = "TYPED";
+  delete persistent_server(name);
+  bool persistent = HCL_CONF->PERSISTENT_SEGMENTS;
+  HCL_CONF->PERSISTENT_SEGMENTS = true;
+  REQUIRE_THROWS_AS((hcl::unordered_map<int, double>(
+                        name, 9600, 1, 0, 1ULL << 24, true, false,
+                        args.backed_file_dir)),
+                    std::runtime_error);
+  HCL_CONF->PERSISTENT_SEGMENTS = persistent;
+  /* The failed attempt left the segment as it was. */
+  delete persistent_server(name);
+  discard(name);
+}
@@ -0,0 +1,157 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <hcl.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Three servers over LOOPBACK with PARTITION_SLOTS, of which two own slots
+ * at first. A client keeps writing while every server rebalances onto all
+ * three and back onto two, and every key is checked afterwards.
+ */
+namespace hcl::test {
+struct Arguments {
+  std::string backed_file_dir = "/dev/shm";
+  int num_request = 5000;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.backed_file_dir,
+                 "backed_file_dir")["--dir"]("Directory of the segments") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Puts of each phase");
+}
+
+int catch_init(int* argc, char*** argv) {
+  HCL_CONF->PARTITIONER = PARTITION_SLOTS;
+  HCL_CONF->PARTITION_SLOTS = 64;
+  HCL_CONF->ACTIVE_SERVERS = 2;
+  hcl::HCL::GetInstance(true, 9200, 3, 0, 0, true, false,
+                        args.backed_file_dir, "");
+  return 0;
+}
+
+int catch_finalize() {
+  hcl::HCL::GetInstance(false)->Finalize();
+  return 0;
+}
+
+typedef hcl::unordered_map<int, int> Map;
+
+namespace {
+const uint16_t NUM_SERVERS = 3;
+
+struct cluster {
+  std::vector<std::unique_ptr<Map>> servers;
+  std::unique_ptr<Map> client;
+
+  explicit cluster(const std::string& name) {
+    for (uint16_t i = 0; i < NUM_SERVERS; ++i)
+      servers.emplace_back(new Map(name, 9200, NUM_SERVERS, i, 1ULL << 26,
+                                   true, false, args.backed_file_dir));
+    client.reset(new Map(name, 9200, NUM_SERVERS, 0, 1ULL << 26, false, false,
+                         args.backed_file_dir));
+  }
+
+  /** @return long, keys in [0, count) held by server. */
+  long held_by(uint16_t server, int count) {
+    long held = 0;
+    for (int i = 0; i < count; ++i) held += servers[server]->LocalGet(i).first;
+    return held;
+  }
+
+  /**
+   * Rebalances every server onto active while a client writes [from, to),
+   * erasing every tenth key it wrote.
+   * @return long, writes that failed.
+   */
+  long rebalance_while_writing(uint16_t active, int from, int to) {
+    std::atomic<long> failed(0);
+    std::thread writer([&]() {
+      for (int i = from; i < to; ++i) {
+        if (!client->Put(i, i)) ++failed;
+        if (i % 10 == 0 && !client->Erase(i).first) ++failed;
+      }
+    });
+    for (auto& server : servers) REQUIRE(server->Rebalance(active));
+    for (auto& server : servers) server->WaitForMigration();
+    writer.join();
+    return failed;
+  }
+
+  /**
+   * Checks every key in [0, count) through reader and that it is stored
+   * exactly once, on one of the first active servers.
+   * @return long, keys that were wrong.
+   */
+  long check(Map& reader, int count, uint16_t active) {
+    long wrong = 0;
+    for (int i = 0; i < count; ++i) {
+      bool kept = i % 10 != 0;
+      auto found = reader.Get(i);
+      if (found.first != kept || (kept && found.second != i)) ++wrong;
+      int holders = 0;
+      for (uint16_t server = 0; server < NUM_SERVERS; ++server) {
+        bool held = servers[server]->LocalGet(i).first;
+        holders += held;
+        if (held && server >= active) ++wrong;
+      }
+      if (holders != (kept ? 1 : 0)) ++wrong;
+    }
+    return wrong;
+  }
+};
+}  // namespace
+
+TEST_CASE("RebalanceWhileWriting", "[rebalance]") {
+  cluster keys("REBALANCED");
+  int count = args.num_request;
+  for (int i = 0; i < count; ++i) {
+    REQUIRE(keys.client->Put(i, i));
+    if (i % 10 == 0) REQUIRE(keys.client->Erase(i).first);
+  }
+  REQUIRE(keys.held_by(2, count) == 0);
+  /* Knows only the routes from before the rebalances. */
+  Map stale("REBALANCED", 9200, NUM_SERVERS, 1, 1ULL << 26, false, false,
+            args.backed_file_dir);
+  uint64_t version = keys.client->RoutingVersion();
+
+  SECTION("grow and shrink") {
+    REQUIRE(keys.rebalance_while_writing(3, count, 2 * count) == 0);
+    REQUIRE(keys.held_by(2, 2 * count) > 0);
+    REQUIRE(keys.check(*keys.client, 2 * count, 3) == 0);
+    /* Routes came back in moved replies and were kept. */
+    REQUIRE(keys.client->RoutingVersion() > version);
+    REQUIRE(stale.RoutingVersion() == 0);
+    REQUIRE(keys.check(stale, 2 * count, 3) == 0);
+    REQUIRE(stale.RoutingVersion() > 0);
+
+    REQUIRE(keys.rebalance_while_writing(2, 2 * count, 3 * count) == 0);
+    REQUIRE(keys.held_by(2, 3 * count) == 0);
+    REQUIRE(keys.check(*keys.client, 3 * count, 2) == 0);
+    REQUIRE(keys.check(stale, 3 * count, 2) == 0);
+  }
+  SECTION("servers reject a bad target") {
+    REQUIRE_FALSE(keys.servers[0]->Rebalance(0));
+    REQUIRE_FALSE(keys.servers[0]->Rebalance(NUM_SERVERS + 1));
+    REQUIRE_FALSE(keys.client->Rebalance(NUM_SERVERS));
+  }
+}
@@ -0,0 +1,219 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <hcl.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Three servers over LOOPBACK keep two copies of every key. A client writes
+ * through them in both replication modes and reads from either copy. The
+ * replica handlers of one server are swapped for ones that count or fail,
+ * to see which replica a read went to.
+ */
+namespace hcl::test {
+struct Arguments {
+  std::string backed_file_dir = "/dev/shm";
+  int num_request = 2000;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.backed_file_dir,
+                 "backed_file_dir")["--dir"]("Directory of the segments") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Keys written by each test");
+}
+
+int catch_init(int* argc, char*** argv) {
+  HCL_CONF->REPLICATION_FACTOR = 2;
+  hcl::HCL::GetInstance(true, 9300, 3, 0, 0, true, false,
+                        args.backed_file_dir, "");
+  return 0;
+}
+
+int catch_finalize() {
+  hcl::HCL::GetInstance(false)->Finalize();
+  return 0;
+}
+
+typedef hcl::unordered_map<int, int> Map;
+typedef std::pair<bool, int> Found;
+
+namespace {
+const uint16_t NUM_SERVERS = 3;
+
+struct cluster {
+  std::string name;
+  std::vector<std::unique_ptr<Map>> servers;
+  std::unique_ptr<Map> client;
+
+  explicit cluster(const std::string& _name) : name(_name) {
+    for (uint16_t i = 0; i < NUM_SERVERS; ++i)
+      servers.emplace_back(new Map(name, 9300, NUM_SERVERS, i, 1ULL << 24,
+                                   true, false, args.backed_file_dir));
+    client.reset(new Map(name, 9300, NUM_SERVERS, 0, 1ULL << 24, false, false,
+                         args.backed_file_dir));
+  }
+
+  /** Writes [0, count) through the client and erases every tenth key. */
+  long write(int count) {
+    long failed = 0;
+    for (int i = 0; i < count; ++i) {
+      if (!client->Put(i, i)) ++failed;
+      if (i % 10 == 0 && !client->Erase(i).first) ++failed;
+    }
+    return failed;
+  }
+
+  /**
+   * Checks that the kept keys are on two servers next to each other and the
+   * erased ones on none.
+   * @return long, keys that were wrong.
+   */
+  long check_copies(int count) {
+    long wrong = 0;
+    for (int i = 0; i < count; ++i) {
+      std::vector<bool> held;
+      int holders = 0;
+      for (auto& server : servers) {
+        held.push_back(server->LocalGet(i).first);
+        holders += held.back();
+      }
+      if (i % 10 == 0) {
+        if (holders != 0) ++wrong;
+        continue;
+      }
+      bool adjacent = false;
+      for (uint16_t s = 0; s < NUM_SERVERS; ++s)
+        adjacent |= held[s] && held[(s + 1) % NUM_SERVERS];
+      if (holders != 2 || !adjacent) ++wrong;
+    }
+    return wrong;
+  }
+
+  /** Replaces what server runs for a read sent to one replica. */
+  void bind_replica_get(uint16_t server, std::function<Found(int&)> get) {
+    hcl::HCL::GetInstance(false)->GetRPC(9300)->bind_loopback(
+        server, name + "_ReplicaGet", get);
+  }
+};
+}  // namespace
+
+TEST_CASE("ReplicatedWrites", "[replication]") {
+  ReplicationMode mode = HCL_CONF->REPLICATION_MODE;
+  for (ReplicationMode tested : {REPLICATION_SYNC, REPLICATION_ASYNC}) {
+    INFO("mode " << tested);
+    HCL_CONF->REPLICATION_MODE = tested;
+    cluster keys("REPLICATED_" + std::to_string(tested));
+    REQUIRE(keys.write(args.num_request) == 0);
+    for (auto& server : keys.servers) REQUIRE(server->Quiesce());
+    REQUIRE(keys.check_copies(args.num_request) == 0);
+    long wrong = 0;
+    for (int i = 0; i < args.num_request; ++i) {
+      Found found = keys.client->Get(i);
+      if (found.first != (i % 10 != 0) || (found.first && found.second != i))
+        ++wrong;
+    }
+    REQUIRE(wrong == 0);
+  }
+  HCL_CONF->REPLICATION_MODE = mode;
+}
+
+TEST_CASE("FailedReplicaWrites", "[replication]") {
+  ReplicationMode mode = HCL_CONF->REPLICATION_MODE;
+  cluster keys("FAILED_REPLICA");
+  /* Server 1 holds the copies of server 0 and refuses them. */
+  std::function<bool(std::vector<std::pair<int, int>>&)> refuse(
+      [](std::vector<std::pair<int, int>>&) { return false; });
+  hcl::HCL::GetInstance(false)->GetRPC(9300)->bind_loopback(
+      1, keys.name + "_ReplicaPut", refuse);
+  SECTION("sync writes fail") {
+    HCL_CONF->REPLICATION_MODE = REPLICATION_SYNC;
+    long failed = 0;
+    for (int i = 0; i < args.num_request; ++i)
+      failed += !keys.client->Put(i, i);
+    REQUIRE(failed > 0);
+    REQUIRE(failed < args.num_request);
+  }
+  SECTION("async writes report it when quiesced") {
+    HCL_CONF->REPLICATION_MODE = REPLICATION_ASYNC;
+    for (int i = 0; i < args.num_request; ++i)
+      REQUIRE(keys.client->Put(i, i));
+    REQUIRE_FALSE(keys.servers[0]->Quiesce());
+    REQUIRE(keys.servers[0]->Quiesce());
+    REQUIRE(keys.servers[1]->Quiesce());
+    REQUIRE(keys.servers[2]->Quiesce());
+  }
+  HCL_CONF->REPLICATION_MODE = mode;
+}
+
+TEST_CASE("ReadsFromReplicas", "[replication]") {
+  uint32_t hedge = HCL_CONF->READ_HEDGE_MS;
+  cluster keys("READ_REPLICAS");
+  REQUIRE(keys.write(args.num_request) == 0);
+  std::vector<std::atomic<long>> reads(NUM_SERVERS);
+  for (uint16_t s = 0; s < NUM_SERVERS; ++s)
+    keys.bind_replica_get(s, [&keys, &reads, s](int& key) {
+      ++reads[s];
+      return keys.servers[s]->LocalGet(key);
+    });
+  auto read_all = [&]() {
+    long wrong = 0;
+    for (int i = 0; i < args.num_request; ++i) {
+      Found found = keys.client->Get(i);
+      if (found.first != (i % 10 != 0) || (found.first && found.second != i))
+        ++wrong;
+    }
+    return wrong;
+  };
+  SECTION("reads take turns over the copies") {
+    HCL_CONF->READ_HEDGE_MS = 0;
+    REQUIRE(read_all() == 0);
+    long total = 0;
+    for (uint16_t s = 0; s < NUM_SERVERS; ++s) {
+      INFO("server " << s << " read " << reads[s]);
+      REQUIRE(reads[s] > args.num_request / 6);
+      total += reads[s];
+    }
+    REQUIRE(total == args.num_request);
+  }
+  SECTION("a hedged read skips a failed replica") {
+    keys.bind_replica_get(1, [&reads](int&) -> Found {
+      ++reads[1];
+      throw std::runtime_error("replica lost");
+    });
+    HCL_CONF->READ_HEDGE_MS = 0;
+    long failed = 0;
+    for (int i = 0; i < args.num_request; ++i) {
+      try {
+        keys.client->Get(i);
+      } catch (const std::exception&) {
+        ++failed;
+      }
+    }
+    /* Without hedging a read sent to server 1 fails. */
+    REQUIRE(failed > 0);
+    HCL_CONF->READ_HEDGE_MS = 50;
+    REQUIRE(read_all() == 0);
+  }
+  HCL_CONF->READ_HEDGE_MS = hedge;
+}
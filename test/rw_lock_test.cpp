@@ -0,0 +1,229 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <hcl/common/rw_lock.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace hcl::test {
+struct Arguments {
+  int num_threads = 4;
+  int num_request = 20000;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.num_threads,
+                 "num_threads")["--num_threads"]("Readers and writers") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Locks taken by each");
+}
+
+int catch_init(int* argc, char*** argv) { return 0; }
+int catch_finalize() { return 0; }
+
+namespace {
+const auto TIMEOUT = std::chrono::seconds(30);
+
+/** Two counters that writers move together and readers compare. */
+struct guarded {
+  hcl::rw_lock lock;
+  long first = 0;
+  long second = 0;
+};
+
+/**
+ * Writers bump both counters under the lock, readers check they agree.
+ * @return long, the number of readers that saw them apart.
+ */
+long hammer(guarded& shared, bool writer, int rounds) {
+  long torn = 0;
+  for (int i = 0; i < rounds; ++i) {
+    if (writer) {
+      std::unique_lock<hcl::rw_lock> lock(shared.lock);
+      ++shared.first;
+      ++shared.second;
+    } else {
+      std::shared_lock<hcl::rw_lock> lock(shared.lock);
+      if (shared.first != shared.second) ++torn;
+    }
+  }
+  return torn;
+}
+
+/** Polls done for up to TIMEOUT. */
+template <typename Done>
+bool eventually(Done done) {
+  auto deadline = std::chrono::steady_clock::now() + TIMEOUT;
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+}  // namespace
+
+TEST_CASE("ReadersShare", "[rw_lock]") {
+  hcl::rw_lock lock;
+  std::atomic<int> inside(0);
+  std::vector<std::future<bool>> readers;
+  for (int i = 0; i < args.num_threads; ++i)
+    readers.push_back(std::async(std::launch::async, [&]() {
+      std::shared_lock<hcl::rw_lock> shared(lock);
+      ++inside;
+      /* Only returns if every reader holds the lock at once. */
+      return eventually([&]() { return inside == args.num_threads; });
+    }));
+  for (auto& reader : readers) REQUIRE(reader.get());
+  REQUIRE(lock.try_lock());
+  lock.unlock();
+}
+
+TEST_CASE("WriterExcludes", "[rw_lock]") {
+  hcl::rw_lock lock;
+  lock.lock();
+  REQUIRE_FALSE(lock.try_lock());
+  REQUIRE_FALSE(lock.try_lock_shared());
+  lock.unlock();
+  lock.lock_shared();
+  REQUIRE_FALSE(lock.try_lock());
+  REQUIRE(lock.try_lock_shared());
+  lock.unlock_shared();
+  lock.unlock_shared();
+  REQUIRE(lock.try_lock());
+  lock.unlock();
+}
+
+TEST_CASE("PendingWriterBlocksReaders", "[rw_lock]") {
+  hcl::rw_lock lock;
+  lock.lock_shared();
+  std::atomic<bool> written(false);
+  auto writer = std::async(std::launch::async, [&]() {
+    std::unique_lock<hcl::rw_lock> exclusive(lock);
+    written = true;
+  });
+  /* Once the writer parks behind the reader, new readers stay out. */
+  REQUIRE(eventually([&]() {
+    if (!lock.try_lock_shared()) return true;
+    lock.unlock_shared();
+    return false;
+  }));
+  REQUIRE_FALSE(written);
+  lock.unlock_shared();
+  REQUIRE(writer.wait_for(TIMEOUT) == std::future_status::ready);
+  REQUIRE(written);
+  REQUIRE(lock.try_lock_shared());
+  lock.unlock_shared();
+}
+
+TEST_CASE("ParkedWaitersWake", "[rw_lock]") {
+  hcl::rw_lock lock;
+  lock.lock();
+  std::atomic<int> done(0);
+  std::vector<std::future<void>> waiters;
+  for (int i = 0; i < args.num_threads; ++i) {
+    bool writer = i % 2 == 0;
+    waiters.push_back(std::async(std::launch::async, [&, writer]() {
+      if (writer) {
+        std::unique_lock<hcl::rw_lock> exclusive(lock);
+        ++done;
+      } else {
+        std::shared_lock<hcl::rw_lock> shared(lock);
+        ++done;
+      }
+    }));
+  }
+  /* Held long enough for every waiter to give up spinning and park. */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  REQUIRE(done == 0);
+  lock.unlock();
+  for (auto& waiter : waiters)
+    REQUIRE(waiter.wait_for(TIMEOUT) == std::future_status::ready);
+  REQUIRE(done == args.num_threads);
+}
+
+TEST_CASE("ReadersAgainstWriters", "[rw_lock]") {
+  guarded shared;
+  std::vector<std::future<long>> workers;
+  int writers = 0;
+  for (int i = 0; i < 2 * args.num_threads; ++i) {
+    bool writer = i % 2 == 0;
+    writers += writer;
+    workers.push_back(std::async(std::launch::async, hammer, std::ref(shared),
+                                 writer, args.num_request));
+  }
+  long torn = 0;
+  for (auto& worker : workers) torn += worker.get();
+  REQUIRE(torn == 0);
+  REQUIRE(shared.first == static_cast<long>(writers) * args.num_request);
+  REQUIRE(shared.second == shared.first);
+}
+
+TEST_CASE("ForkedProcessesShare", "[rw_lock]") {
+  /* Shared mapping, as a container segment would be. */
+  void* memory = mmap(nullptr, sizeof(guarded), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  REQUIRE(memory != MAP_FAILED);
+  guarded* shared = new (memory) guarded();
+  SECTION("readers against writers") {
+    std::vector<pid_t> children;
+    int writers = 0;
+    for (int i = 0; i < 2 * args.num_threads; ++i) {
+      bool writer = i % 2 == 0;
+      writers += writer;
+      pid_t child = fork();
+      REQUIRE(child >= 0);
+      if (child == 0) _exit(hammer(*shared, writer, args.num_request) ? 1 : 0);
+      children.push_back(child);
+    }
+    for (pid_t child : children) {
+      int status = 0;
+      REQUIRE(waitpid(child, &status, 0) == child);
+      REQUIRE(WIFEXITED(status));
+      REQUIRE(WEXITSTATUS(status) == 0);
+    }
+    REQUIRE(shared->first == static_cast<long>(writers) * args.num_request);
+    REQUIRE(shared->second == shared->first);
+  }
+  SECTION("a parked process is woken") {
+    shared->lock.lock();
+    pid_t child = fork();
+    REQUIRE(child >= 0);
+    if (child == 0) {
+      std::unique_lock<hcl::rw_lock> exclusive(shared->lock);
+      ++shared->first;
+      _exit(0);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(shared->first == 0);
+    shared->lock.unlock();
+    int status = 0;
+    REQUIRE(waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(shared->first == 1);
+  }
+  shared->~guarded();
+  munmap(memory, sizeof(guarded));
+}
@@ -0,0 +1,179 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <catch_config.h>
+#include <hcl/common/slab_allocator.h>
+
+#include <boost/interprocess/containers/string.hpp>
+#include <boost/interprocess/managed_heap_memory.hpp>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * slab_pool over a segment manager, whose free memory tells when the pool
+ * went upstream, and slab_allocator under strings churned by many threads.
+ */
+namespace hcl::test {
+struct Arguments {
+  int num_threads = 4;
+  int num_request = 20000;
+};
+}  // namespace hcl::test
+
+hcl::test::Arguments args;
+
+cl::Parser define_options() {
+  return cl::Opt(args.num_threads,
+                 "num_threads")["--num_threads"]("Threads sharing a pool") |
+         cl::Opt(args.num_request,
+                 "num_request")["--num_request"]("Allocations by each");
+}
+
+int catch_init(int* argc, char*** argv) { return 0; }
+int catch_finalize() { return 0; }
+
+namespace {
+/** On the heap, with the segment manager of managed_mapped_file **/
+typedef boost::interprocess::basic_managed_heap_memory<
+    char,
+    boost::interprocess::rbtree_best_fit<boost::interprocess::mutex_family>,
+    boost::interprocess::iset_index>
+    heap_segment;
+typedef boost::interprocess::basic_string<char, std::char_traits<char>,
+                                          hcl::slab_allocator<char>>
+    slab_string;
+
+/** A pool built in a segment, which it takes its slabs from. */
+struct pooled {
+  heap_segment segment;
+  /** Free before the pool was built **/
+  size_t empty;
+  hcl::slab_pool* pool;
+
+  pooled() : segment(64 << 20), empty(segment.get_free_memory()) {
+    pool = segment.construct<hcl::slab_pool>(
+        boost::interprocess::anonymous_instance)(segment.get_segment_manager());
+    pool->attach();
+  }
+  ~pooled() {
+    if (pool != nullptr) segment.destroy_ptr(pool);
+  }
+  size_t free_memory() { return segment.get_free_memory(); }
+};
+}  // namespace
+
+TEST_CASE("SlabSizeClasses", "[slab_allocator]") {
+  REQUIRE(hcl::slab_pool::class_of(1) == 0);
+  REQUIRE(hcl::slab_pool::class_of(hcl::slab_pool::MIN_BLOCK) == 0);
+  REQUIRE(hcl::slab_pool::class_of(hcl::slab_pool::MIN_BLOCK + 1) == 1);
+  REQUIRE(hcl::slab_pool::class_of(hcl::slab_pool::MAX_BLOCK) ==
+          hcl::slab_pool::NUM_CLASSES - 1);
+}
+
+TEST_CASE("SlabBlocks", "[slab_allocator]") {
+  pooled slabs;
+  size_t before = slabs.free_memory();
+  int count = 1000;
+  std::vector<char*> blocks;
+  std::set<char*> distinct;
+  for (int i = 0; i < count; ++i) {
+    blocks.push_back(static_cast<char*>(slabs.pool->allocate(24)));
+    distinct.insert(blocks.back());
+    REQUIRE(reinterpret_cast<uintptr_t>(blocks.back()) % 16 == 0);
+    std::memset(blocks.back(), i & 0xff, 24);
+  }
+  REQUIRE(distinct.size() == blocks.size());
+  long overwritten = 0;
+  for (int i = 0; i < count; ++i)
+    for (int b = 0; b < 24; ++b)
+      if (blocks[i][b] != static_cast<char>(i & 0xff)) ++overwritten;
+  REQUIRE(overwritten == 0);
+  size_t used = slabs.free_memory();
+  REQUIRE(used < before);
+  SECTION("freed blocks are reused without new slabs") {
+    for (char* block : blocks) slabs.pool->deallocate(block, 24);
+    for (int i = 0; i < count; ++i) slabs.pool->allocate(32);
+    REQUIRE(slabs.free_memory() == used);
+  }
+  SECTION("large blocks go to the segment manager") {
+    void* large = slabs.pool->allocate(hcl::slab_pool::MAX_BLOCK + 1);
+    REQUIRE(slabs.free_memory() < used);
+    slabs.pool->deallocate(large, hcl::slab_pool::MAX_BLOCK + 1);
+    REQUIRE(slabs.free_memory() == used);
+  }
+  SECTION("destroying the pool gives its slabs back") {
+    for (size_t size = 1; size <= hcl::slab_pool::MAX_BLOCK; size *= 2)
+      slabs.pool->allocate(size);
+    slabs.segment.destroy_ptr(slabs.pool);
+    slabs.pool = nullptr;
+    REQUIRE(slabs.free_memory() == slabs.empty);
+  }
+}
+
+TEST_CASE("SlabDetach", "[slab_allocator]") {
+  pooled slabs;
+  size_t before = slabs.free_memory();
+  /* Another thread frees some blocks into its cache, and stays alive. */
+  std::promise<void> freed, done;
+  std::thread other([&]() {
+    std::vector<void*> blocks;
+    for (uint32_t i = 0; i < hcl::slab_pool::BATCH; ++i)
+      blocks.push_back(slabs.pool->allocate(16));
+    for (void* block : blocks) slabs.pool->deallocate(block, 16);
+    freed.set_value();
+    done.get_future().wait();
+  });
+  freed.get_future().wait();
+  size_t one_slab = slabs.free_memory();
+  REQUIRE(one_slab < before);
+  slabs.pool->detach();
+  slabs.pool->attach();
+  /* Its blocks are back on the free list, so one slab is still enough. */
+  size_t blocks = hcl::slab_pool::SLAB_SIZE / 16;
+  for (size_t i = 0; i < blocks; ++i) slabs.pool->allocate(16);
+  REQUIRE(slabs.free_memory() == one_slab);
+  done.set_value();
+  other.join();
+}
+
+TEST_CASE("SlabAllocatorStrings", "[slab_allocator]") {
+  pooled slabs;
+  std::vector<std::future<long>> threads;
+  for (int t = 0; t < args.num_threads; ++t)
+    threads.push_back(std::async(std::launch::async, [&slabs, t]() {
+      hcl::slab_allocator<char> alloc(slabs.pool);
+      std::vector<slab_string> kept;
+      long wrong = 0;
+      /* Every string holds one repeated letter. */
+      auto torn = [](const slab_string& held) {
+        return held.find_first_not_of(held[0]) != slab_string::npos;
+      };
+      for (int i = 0; i < args.num_request; ++i) {
+        /* Lengths over every class, and past the largest. */
+        std::string value(static_cast<size_t>((i * 37 + t) % 5000) + 1,
+                          static_cast<char>('a' + (i + t) % 26));
+        kept.emplace_back(value.c_str(), alloc);
+        if (kept.size() > 64) {
+          for (auto& held : kept) wrong += torn(held);
+          kept.erase(kept.begin(), kept.begin() + 32);
+        }
+      }
+      for (auto& held : kept) wrong += torn(held);
+      return wrong;
+    }));
+  for (auto& thread : threads) REQUIRE(thread.get() == 0);
+}